@@ -38,6 +38,10 @@
 #include "system.h"
 #include "access.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 /* a few atomic operation definitions */
 /*
 
@@ -106,6 +110,8 @@ struct histogram_64 {
 
 extern const struct sys_timestamp* get_tsops(void);
 
+uint32_t (*access_write_value)(uint32_t *ptr) = NULL;
+
 static
 _code 
 uint32_t measure_read(uint32_t *ptr)
@@ -132,7 +138,8 @@ uint32_t measure_write(uint32_t *ptr)
     uint32_t val_to_write;
     struct stopwatch sw;
 
-    val_to_write = (uint32_t)(uintptr_t)(ptr); // let's write the ptr value
+    if (access_write_value) val_to_write = access_write_value(ptr);
+    else val_to_write = (uint32_t)(uintptr_t)(ptr); // let's write the ptr value
 
     sw_reset(&sw, get_tsops());
     sw_start(&sw);
@@ -172,11 +179,164 @@ uint32_t measure_write_after_read(uint32_t *ptr)
     return sw_get_nsec(&sw);
 }
 
+size_t access_span = 0;
+size_t access_page_size = 4096;
+
+static volatile uint32_t span_sink;
+
+/* the span holding ptr: cache line aligned, and kept within its page */
+static inline
+char* span_start(uint32_t *ptr)
+{
+    uintptr_t page = (uintptr_t)ptr & ~(uintptr_t)(access_page_size - 1);
+    uintptr_t start = (uintptr_t)ptr & ~(uintptr_t)63;
+
+    if (start + access_span > page + access_page_size) start = page + access_page_size - access_span;
+    return (char*)start;
+}
+
+/*
+ * Span accesses go a cache line per iteration, with 16 byte vectors
+ * when the target has them. Writes store each word's own address, as a
+ * word write does, unless a content profile gives the values.
+ */
+static
+_code 
+uint32_t measure_read_span(uint32_t *ptr)
+{
+    char* p = span_start(ptr);
+    const size_t n = access_span;
+    struct stopwatch sw;
+    size_t i;
+#ifdef __SSE2__
+    __m128i a0 = _mm_setzero_si128(), a1 = a0, a2 = a0, a3 = a0;
+
+    sw_reset(&sw, get_tsops());
+    sw_start(&sw);
+    for (i = 0; i < n; i += 64) {
+	a0 = _mm_xor_si128(a0, _mm_load_si128((const __m128i*)(p + i)));
+	a1 = _mm_xor_si128(a1, _mm_load_si128((const __m128i*)(p + i + 16)));
+	a2 = _mm_xor_si128(a2, _mm_load_si128((const __m128i*)(p + i + 32)));
+	a3 = _mm_xor_si128(a3, _mm_load_si128((const __m128i*)(p + i + 48)));
+    }
+    sw_stop(&sw);
+    span_sink = _mm_cvtsi128_si32(_mm_xor_si128(_mm_xor_si128(a0, a1), _mm_xor_si128(a2, a3)));
+#else
+    uint64_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+
+    sw_reset(&sw, get_tsops());
+    sw_start(&sw);
+    for (i = 0; i < n; i += 32) {
+	a0 ^= *(const uint64_t*)(p + i);
+	a1 ^= *(const uint64_t*)(p + i + 8);
+	a2 ^= *(const uint64_t*)(p + i + 16);
+	a3 ^= *(const uint64_t*)(p + i + 24);
+    }
+    sw_stop(&sw);
+    span_sink = (uint32_t)(a0 ^ a1 ^ a2 ^ a3);
+#endif
+    return sw_get_nsec(&sw);
+}
+
+static
+_code 
+uint32_t measure_write_span(uint32_t *ptr)
+{
+    char* p = span_start(ptr);
+    const size_t n = access_span;
+    struct stopwatch sw;
+    size_t i;
+
+    if (access_write_value) {
+	sw_reset(&sw, get_tsops());
+	sw_start(&sw);
+	for (i = 0; i < n; i += sizeof(uint32_t)) {
+	    *(uint32_t*)(p + i) = access_write_value((uint32_t*)(p + i));
+	}
+	sw_stop(&sw);
+	return sw_get_nsec(&sw);
+    }
+#ifdef __SSE2__
+    {
+	const __m128i step = _mm_set1_epi32(16);
+	__m128i v0 = _mm_set_epi32((uint32_t)(uintptr_t)(p + 12), (uint32_t)(uintptr_t)(p + 8),
+		(uint32_t)(uintptr_t)(p + 4), (uint32_t)(uintptr_t)p);
+	__m128i v1 = _mm_add_epi32(v0, step);
+	__m128i v2 = _mm_add_epi32(v1, step);
+	__m128i v3 = _mm_add_epi32(v2, step);
+	const __m128i line = _mm_set1_epi32(64);
+
+	sw_reset(&sw, get_tsops());
+	sw_start(&sw);
+	for (i = 0; i < n; i += 64) {
+	    _mm_store_si128((__m128i*)(p + i), v0);
+	    _mm_store_si128((__m128i*)(p + i + 16), v1);
+	    _mm_store_si128((__m128i*)(p + i + 32), v2);
+	    _mm_store_si128((__m128i*)(p + i + 48), v3);
+	    v0 = _mm_add_epi32(v0, line);
+	    v1 = _mm_add_epi32(v1, line);
+	    v2 = _mm_add_epi32(v2, line);
+	    v3 = _mm_add_epi32(v3, line);
+	}
+	sw_stop(&sw);
+    }
+#else
+    sw_reset(&sw, get_tsops());
+    sw_start(&sw);
+    for (i = 0; i < n; i += sizeof(uint32_t)) {
+	*(uint32_t*)(p + i) = (uint32_t)(uintptr_t)(p + i);
+    }
+    sw_stop(&sw);
+#endif
+    return sw_get_nsec(&sw);
+}
+
+static
+_code 
+uint32_t measure_write_after_read_span(uint32_t *ptr)
+{
+    char* p = span_start(ptr);
+    const size_t n = access_span;
+    struct stopwatch sw;
+    size_t i;
+
+    sw_reset(&sw, get_tsops());
+    sw_start(&sw);
+#ifdef __SSE2__
+    for (i = 0; i < n; i += 64) {
+	__m128i v0 = _mm_load_si128((const __m128i*)(p + i));
+	__m128i v1 = _mm_load_si128((const __m128i*)(p + i + 16));
+	__m128i v2 = _mm_load_si128((const __m128i*)(p + i + 32));
+	__m128i v3 = _mm_load_si128((const __m128i*)(p + i + 48));
+	_mm_store_si128((__m128i*)(p + i), v0);
+	_mm_store_si128((__m128i*)(p + i + 16), v1);
+	_mm_store_si128((__m128i*)(p + i + 32), v2);
+	_mm_store_si128((__m128i*)(p + i + 48), v3);
+    }
+#else
+    for (i = 0; i < n; i += sizeof(uint64_t)) {
+	*(volatile uint64_t*)(p + i) = *(volatile uint64_t*)(p + i);
+    }
+#endif
+    sw_stop(&sw);
+    return sw_get_nsec(&sw);
+}
+
 _code 
 uint32_t access_histogram(uint32_t *ptr, int is_write)
 {
     uint32_t latency;
 
+    if (access_span) {
+	switch (is_write) {
+	case 1:
+	    return measure_write_span(ptr);
+	case 2:
+	    return measure_write_after_read_span(ptr);
+	}
+	return measure_read_span(ptr);
+    }
+
     switch (is_write) {
     case 0:
 	latency = measure_read(ptr);
@@ -298,6 +458,60 @@ void __attribute__((cold)) dump_histogram_64(const struct histogram_64 *bin)
    printf("Total samples: %"PRIu64"\n\n", sum_all);
 }
 
+/*
+ * Summary of a histogram: sample count, mean and percentiles.
+ * Mean and percentiles are estimated from the bin midpoints.
+ */
+static
+void histogram_bin(const struct histogram_64 *bin, int n, uint64_t *count, double *mid)
+{
+    int bucket = n >> 4, hex = n & 0xf;
+
+    if (n == 0) {		// [0, 2^8)
+	*count = bin->buckets[0].hex[0];
+	*mid = 128.0;
+    } else if (n < 16) {	// unused bucket_sub[0].hex[1-15]. long latencies go last
+	*count = 0;
+	*mid = 0.0;
+    } else if (n < 256) {	// [2^(b+7) + h*2^(b+3), +2^(b+3))
+	*count = bin->buckets[bucket].hex[hex];
+	*mid = (double)(1u << (bucket + 7)) + (hex + 0.5) * (1u << (bucket + 3));
+    } else if (n < 256 + 7) {	// [2^(23+k), 2^(24+k))
+	*count = bin->buckets[0].hex[8 + n - 256];
+	*mid = 1.5 * (double)(1u << (23 + n - 256));
+    } else {			// [2^30, 2^32)
+	*count = bin->buckets[0].hex[8 + 7];
+	*mid = 2.5 * (double)(1u << 30);
+    }
+}
+
+void get_histogram_summary(char *buf, int is_write, struct histogram_summary *hs)
+{
+    const struct histogram_64 *bin = &((struct histogram_64*)buf)[is_write ? 1 : 0];
+    uint64_t count, sum = 0, p50_at, p99_at;
+    double mid, total = 0.0;
+    int n;
+
+    memset(hs, 0, sizeof(*hs));
+    for (n = 0; n < 256 + 8; n++) {
+	histogram_bin(bin, n, &count, &mid);
+	hs->count += count;
+	total += mid * count;
+    }
+    if (hs->count == 0) return;
+    hs->mean_ns = total / hs->count;
+
+    p50_at = (hs->count + 1) / 2;
+    p99_at = hs->count - hs->count / 100;
+    for (n = 0; n < 256 + 8; n++) {
+	histogram_bin(bin, n, &count, &mid);
+	if (count == 0) continue;
+	if (sum < p50_at && sum + count >= p50_at) hs->p50_ns = mid;
+	if (sum < p99_at && sum + count >= p99_at) hs->p99_ns = mid;
+	sum += count;
+    }
+}
+
 static void histogram_report(char* buf, int ratio)
 {
     struct histogram_64 *result = (struct histogram_64*)(buf);
@@ -48,6 +48,23 @@ extern access_fn_set histogram_access;
 
 extern access_fn_set* get_access_from_name(const char* str);
 
+/* value a write access stores at @ptr. NULL stores the pointer value */
+extern uint32_t (*access_write_value)(uint32_t *ptr);
+
+/* bytes an access reads or writes, within the page (--granularity).
+ * 0 touches one word. access_page_size bounds the span */
+extern size_t access_span;
+extern size_t access_page_size;
+
 extern uint64_t * get_histogram_bucket(char *buf, int is_write, int bucketnum);
 
+struct histogram_summary {
+    uint64_t count;	// number of samples
+    double mean_ns;	// estimated from bin midpoints
+    double p50_ns;
+    double p99_ns;
+};
+
+extern void get_histogram_summary(char *buf, int is_write, struct histogram_summary *hs);
+
 #endif
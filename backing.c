@@ -0,0 +1,828 @@
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <time.h>
+#endif
+
+#include "system.h"
+#include "pmbench.h"
+#include "backing.h"
+#include "pager.h"
+
+static struct backing_info binfo = {
+    .path = NULL,
+    .file_size = 0,
+    .prepopulated = 0,
+};
+
+const struct backing_info* get_backing_info(void)
+{
+    return &binfo;
+}
+
+static
+int generic_setup_noarg(const char* arg)
+{
+    if (arg && *arg) {
+	printf("this backing takes no argument: %s\n", arg);
+	return -1;
+    }
+    return 0;
+}
+
+static
+void generic_report_none(void)
+{
+    return;
+}
+
+/*
+ * huge page modes
+ */
+static const char* hugepage_names[] = {
+    "default", "thp", "nothp", "2m", "1g", 0
+};
+
+int get_hugepage_mode_from_name(const char* str)
+{
+    int i;
+    if (!str) return -1;
+    for (i = 0; hugepage_names[i]; i++) {
+	if (!my_strncmp(hugepage_names[i], str, 16)) return i;
+    }
+    return -1;
+}
+
+const char* hugepage_mode_name(int mode)
+{
+    if (mode < 0 || mode > HUGEPAGE_HUGETLB_1G) return "unknown";
+    return hugepage_names[mode];
+}
+
+#ifdef _WIN32
+int hugepage_shift(int mode)
+{
+    return 21;
+}
+
+int hugepage_map_flags(int mode)
+{
+    return 0;
+}
+
+int hugepage_advise(char* buf, size_t size, int mode)
+{
+    return 0;
+}
+#else
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+#ifndef MAP_HUGE_1GB
+#define MAP_HUGE_1GB (30 << MAP_HUGE_SHIFT)
+#endif
+
+/*
+ * THP size is the PMD size, which is 2MiB on x86_64 but we ask the kernel
+ */
+static
+int thp_shift(void)
+{
+    static int shift = 0;
+    char str[32];
+    int fd, n;
+    long long sz;
+
+    if (shift) return shift;
+    shift = 21;
+    fd = open("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", O_RDONLY);
+    if (fd == -1) return shift;
+    n = read(fd, str, sizeof(str) - 1);
+    close(fd);
+    if (n <= 0) return shift;
+    str[n] = '\0';
+    sz = atoll(str);
+    if (sz > 0 && !(sz & (sz - 1))) shift = __builtin_ctzll(sz);
+    return shift;
+}
+
+int hugepage_shift(int mode)
+{
+    switch (mode) {
+    case HUGEPAGE_HUGETLB_2M: return 21;
+    case HUGEPAGE_HUGETLB_1G: return 30;
+    default: return thp_shift();
+    }
+}
+
+int hugepage_map_flags(int mode)
+{
+    switch (mode) {
+    case HUGEPAGE_HUGETLB_2M: return MAP_HUGETLB | MAP_HUGE_2MB;
+    case HUGEPAGE_HUGETLB_1G: return MAP_HUGETLB | MAP_HUGE_1GB;
+    default: return 0;
+    }
+}
+
+/*
+ * returns non-zero upon failure
+ */
+int hugepage_advise(char* buf, size_t size, int mode)
+{
+    int advice;
+
+    switch (mode) {
+    case HUGEPAGE_THP: advice = MADV_HUGEPAGE; break;
+    case HUGEPAGE_NOTHP: advice = MADV_NOHUGEPAGE; break;
+    default: return 0;
+    }
+    if (madvise(buf, size, advice)) {
+	perror("huge page madvise failed");
+	return 1;
+    }
+    return 0;
+}
+#endif
+
+/*
+ * anonymous memory - the original pmbench map
+ */
+#ifdef _WIN32
+static
+char* anon_map(size_t size, int prot)
+{
+    char* buf = VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (buf == NULL) {
+	printf("VirtualAlloc failed. Error:%d\n", (int)GetLastError());
+	return NULL;
+    }
+    return buf;
+}
+
+static
+int anon_unmap(char* buf, size_t size)
+{
+    // VirtualFree requires dwSize to be 0 when memory region is released
+    if (!VirtualFree(buf, 0, MEM_RELEASE)) {
+	printf("VirtualFree failed. Error:%d\n", (int)GetLastError());
+	return 1;
+    }
+    return 0;
+}
+#else
+static
+char* anon_map(size_t size, int prot)
+{
+    char* buf;
+    int flags = MAP_ANONYMOUS;
+
+    flags |= (params.map_shared ? MAP_SHARED : MAP_PRIVATE);
+    flags |= hugepage_map_flags(params.hugepage);
+    buf = mmap(NULL, size, prot, flags, -1, 0);
+    if (buf == MAP_FAILED) {
+	perror("buf mmap failed");
+	if (flags & MAP_HUGETLB) {
+	    printf("Check that enough huge pages are reserved (e.g., /proc/sys/vm/nr_hugepages)\n");
+	}
+	return NULL;
+    }
+    if (hugepage_advise(buf, size, params.hugepage)) {
+	munmap(buf, size);
+	return NULL;
+    }
+    return buf;
+}
+
+static
+int anon_unmap(char* buf, size_t size)
+{
+    if (munmap(buf, size)) {
+	perror("munmap failed");
+	return 1;
+    }
+    return 0;
+}
+#endif
+
+map_backing anon_backing = {
+    .setup = generic_setup_noarg,
+    .map = anon_map,
+    .unmap = anon_unmap,
+    .report = generic_report_none,
+    .name = "anon",
+    .description = "Anonymous memory (swap backed)"
+};
+
+#ifndef _WIN32
+/*
+ * file backed map - page cache, eviction and readahead
+ *
+ * The file is created and sized to the map if it is missing. A new or empty
+ * file is filled with garbage so that evicted pages must be read back from
+ * the disk. An existing file that is short or sparse is someone's data, so
+ * it's only extended and filled with the overwrite flag.
+ * Page cache of the file is dropped before the run so every run starts cold.
+ */
+static int file_fd = -1;
+static int file_overwrite = 0;
+
+static
+int file_setup(const char* arg)
+{
+    char* path;
+    char* flag;
+
+    if (!arg || !*arg) {
+	printf("file backing needs a path: --backing=file:PATH[:overwrite]\n");
+	return -1;
+    }
+    path = strdup(arg);
+    flag = strrchr(path, ':');
+    if (flag && !strcmp(flag + 1, "overwrite")) {
+	file_overwrite = 1;
+	*flag = 0;
+    }
+    binfo.path = path;
+    return 0;
+}
+
+#define FILL_CHUNK (1 << 20)
+static
+int file_fill(int fd, size_t size)
+{
+    uint64_t state = 0x0ddfadedbeefd00d;
+    uint32_t* chunk;
+    size_t done, len, i;
+    ssize_t ret;
+
+    chunk = malloc(FILL_CHUNK);
+    if (!chunk) return -1;
+
+    for (done = 0; done < size; done += len) {
+	len = (size - done < FILL_CHUNK) ? size - done : FILL_CHUNK;
+	for (i = 0; i < len / sizeof(uint32_t); i++) {
+	    state = state * 6364136223846793005ull + 1442695040888963407ull;
+	    chunk[i] = (uint32_t)(state >> 33);
+	}
+	ret = pwrite(fd, chunk, len, (off_t)done);
+	if (ret != (ssize_t)len) {
+	    perror("backing file fill failed");
+	    free(chunk);
+	    return -1;
+	}
+    }
+    free(chunk);
+    return 0;
+}
+#undef FILL_CHUNK
+
+static
+char* file_map(size_t size, int prot)
+{
+    struct stat st;
+    char* buf;
+    int flags = (params.map_shared ? MAP_SHARED : MAP_PRIVATE);
+    int created = 1;
+
+    file_fd = open(binfo.path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (file_fd == -1 && errno == EEXIST) {
+	created = 0;
+	file_fd = open(binfo.path, O_RDWR);
+    }
+    if (file_fd == -1) {
+	perror("backing file open failed");
+	return NULL;
+    }
+    /* worker processes (--procs) map the same file. one of them fills it */
+    if (flock(file_fd, LOCK_EX)) {
+	perror("backing file lock failed");
+	goto out_close;
+    }
+    if (fstat(file_fd, &st)) {
+	perror("backing file stat failed");
+	goto out_close;
+    }
+    binfo.prepopulated = (st.st_size >= (off_t)size) &&
+	((int64_t)st.st_blocks * 512 >= (int64_t)size);
+
+    if (!binfo.prepopulated && !created && st.st_size > 0 && !file_overwrite) {
+	printf("backing file %s is %s. refusing to overwrite it, use file:PATH:overwrite\n",
+		binfo.path, st.st_size < (off_t)size ? "smaller than the map" : "sparse");
+	goto out_close;
+    }
+    if (st.st_size < (off_t)size) {
+	if (ftruncate(file_fd, (off_t)size)) {
+	    perror("backing file ftruncate failed");
+	    goto out_close;
+	}
+    }
+    if (!binfo.prepopulated) {
+	printf("Populating backing file %s...\n", binfo.path);
+	if (file_fill(file_fd, size)) goto out_close;
+    }
+    if (fstat(file_fd, &st)) {
+	perror("backing file stat failed");
+	goto out_close;
+    }
+    binfo.file_size = st.st_size;
+    flock(file_fd, LOCK_UN);
+
+    /* clean pages are dropped so the map starts with nothing cached */
+    if (fdatasync(file_fd)) perror("backing file fdatasync failed");
+    if (posix_fadvise(file_fd, 0, 0, POSIX_FADV_DONTNEED)) {
+	printf("backing file: posix_fadvise(DONTNEED) failed\n");
+    }
+
+    buf = mmap(NULL, size, prot, flags, file_fd, 0);
+    if (buf == MAP_FAILED) {
+	perror("buf mmap failed");
+	goto out_close;
+    }
+    if (hugepage_advise(buf, size, params.hugepage)) {
+	munmap(buf, size);
+	goto out_close;
+    }
+    return buf;
+
+out_close:
+    close(file_fd);
+    file_fd = -1;
+    return NULL;
+}
+
+static
+int file_unmap(char* buf, size_t size)
+{
+    int ret = 0;
+    if (munmap(buf, size)) {
+	perror("munmap failed");
+	ret = 1;
+    }
+    if (file_fd != -1) {
+	close(file_fd);
+	file_fd = -1;
+    }
+    return ret;
+}
+
+static
+void print_cache_delta(const char* tag, const sys_mem_item* before, const sys_mem_item* after)
+{
+    printf("  %-19s: %+"PRId64" KiB page cache, %+"PRId64" major faults\n", tag,
+	    sys_stat_mem_get_delta(before, after, 2),
+	    sys_stat_mem_get_delta(before, after, 9));
+}
+
+static
+void file_report(void)
+{
+    printf("backing file   : %s\n", binfo.path);
+    printf("mapping type   : %s\n", params.map_shared ? "MAP_SHARED" : "MAP_PRIVATE");
+    printf("file size      : %"PRId64" bytes (%"PRId64" MiB)\n",
+	    binfo.file_size, binfo.file_size >> 20);
+    printf("prepopulated   : %s\n", binfo.prepopulated ? "yes" : "no (filled by pmbench)");
+    printf("page cache     : (Cached in meminfo, system wide)\n");
+    if (!params.cold) {
+	print_cache_delta("during warmup", &mem_info_before_warmup, &mem_info_before_run);
+	print_cache_delta("during benchmark", &mem_info_before_run, &mem_info_after_run);
+    } else {
+	print_cache_delta("during benchmark", &mem_info_before_warmup, &mem_info_after_run);
+    }
+}
+
+map_backing file_backing = {
+    .setup = file_setup,
+    .map = file_map,
+    .unmap = file_unmap,
+    .report = file_report,
+    .name = "file",
+    .description = "Shared or private mapping of a regular file (page cache)"
+};
+
+
+/*
+ * memfd backing
+ *
+ * The map is a MAP_SHARED mapping of a memfd, i.e., shmem pages that are
+ * swapped out through the shmem path rather than the anonymous one.
+ * With --hugepage=2m/1g the memfd is created with MFD_HUGETLB.
+ */
+#ifndef MFD_HUGETLB
+#define MFD_HUGETLB 0x0004U
+#endif
+#ifndef MFD_HUGE_SHIFT
+#define MFD_HUGE_SHIFT 26
+#endif
+
+static int memfd_fd = -1;
+
+static
+char* memfd_map(size_t size, int prot)
+{
+    char* buf;
+    unsigned int flags = MFD_CLOEXEC;
+
+    if (params.hugepage >= HUGEPAGE_HUGETLB_2M) {
+	flags |= MFD_HUGETLB | (hugepage_shift(params.hugepage) << MFD_HUGE_SHIFT);
+    }
+    memfd_fd = memfd_create("pmbench", flags);
+    if (memfd_fd == -1) {
+	perror("memfd_create failed");
+	return NULL;
+    }
+    if (ftruncate(memfd_fd, (off_t)size)) {
+	perror("memfd ftruncate failed");
+	goto out_close;
+    }
+    buf = mmap(NULL, size, prot, MAP_SHARED, memfd_fd, 0);
+    if (buf == MAP_FAILED) {
+	perror("buf mmap failed");
+	if (flags & MFD_HUGETLB) {
+	    printf("Check that enough huge pages are reserved (e.g., /proc/sys/vm/nr_hugepages)\n");
+	}
+	goto out_close;
+    }
+    if (hugepage_advise(buf, size, params.hugepage)) {
+	munmap(buf, size);
+	goto out_close;
+    }
+    return buf;
+
+out_close:
+    close(memfd_fd);
+    memfd_fd = -1;
+    return NULL;
+}
+
+static
+int memfd_unmap(char* buf, size_t size)
+{
+    int ret = 0;
+    if (munmap(buf, size)) {
+	perror("munmap failed");
+	ret = 1;
+    }
+    if (memfd_fd != -1) {
+	close(memfd_fd);
+	memfd_fd = -1;
+    }
+    return ret;
+}
+
+static
+void memfd_report(void)
+{
+    printf("memfd          : %s\n",
+	    params.hugepage >= HUGEPAGE_HUGETLB_2M ? "MFD_HUGETLB" : "shmem");
+}
+
+map_backing memfd_backing = {
+    .setup = generic_setup_noarg,
+    .map = memfd_map,
+    .unmap = memfd_unmap,
+    .report = memfd_report,
+    .name = "memfd",
+    .description = "Shared mapping of a memfd (shmem)"
+};
+
+
+/*
+ * persistent backing - a named object that keeps the map across runs
+ *
+ * The map is a MAP_SHARED mapping of PATH, meant to be on tmpfs (e.g.,
+ * /dev/shm) or hugetlbfs so the contents stay in memory between runs.
+ * A state header follows the map in the object. At unmap the working set
+ * is checksummed and the header marked valid. The next run with the same
+ * map, working set and contents attaches to it: the map is not initialized
+ * again, and with skip-warmup not warmed up either. The header is marked
+ * invalid while a run owns the object, so a crashed run leaves no state.
+ */
+#define PERSIST_MAGIC "PMBSTATE"
+#define PERSIST_VERSION 1
+
+struct persist_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t valid;		// saved cleanly by the last run
+    uint64_t map_bytes;
+    uint64_t ws_bytes;		// checksummed bytes from the start of the map
+    uint64_t checksum;
+    int32_t initialized;	// 0 = left as touched, 1 = garbage, 2 = content profile
+    double content[3];		// ratio, dup_pct, zero_pct of the content profile
+    int64_t saved_time;
+};
+
+static int persist_fd = -1;
+static int persist_verify = 1;
+static struct persist_header* persist_hdr;
+static size_t persist_hdr_len;
+static int persist_init;		// what the contents are initialized with
+static double persist_content[3];
+
+static
+int persist_setup(const char* arg)
+{
+    char* path;
+    char* flag;
+
+    if (!arg || !*arg) {
+	printf("persist backing needs a path: --backing=persist:PATH[:skip-warmup][:no-verify]\n");
+	return -1;
+    }
+    path = strdup(arg);
+    for (flag = strrchr(path, ':'); flag; flag = strrchr(path, ':')) {
+	if (!strcmp(flag + 1, "skip-warmup")) binfo.skip_warmup = 1;
+	else if (!strcmp(flag + 1, "no-verify")) persist_verify = 0;
+	else break;
+	*flag = 0;
+    }
+    binfo.path = path;
+    binfo.state = "none";
+    binfo.verify_clock = -1;
+    return 0;
+}
+
+/* 64 bit checksum of @len bytes, four lanes to keep up with memory */
+static
+uint64_t persist_checksum(const char* buf, size_t len)
+{
+    const uint64_t* w = (const uint64_t*)buf;
+    const uint64_t k = 0x9e3779b97f4a7c15ULL;
+    uint64_t a = 1, b = 2, c = 3, d = 4;
+    size_t i, n = len / sizeof(uint64_t);
+
+    for (i = 0; i + 4 <= n; i += 4) {
+	a = (a ^ w[i]) * k;
+	b = (b ^ w[i + 1]) * k;
+	c = (c ^ w[i + 2]) * k;
+	d = (d ^ w[i + 3]) * k;
+    }
+    for (; i < n; i++) a = (a ^ w[i]) * k;
+    return ((a ^ (b >> 17)) * k) ^ ((c ^ (d >> 31)) * k) ^ len;
+}
+
+static
+int persist_initialized(void)
+{
+    if (!params.init_garbage) return 0;
+    return params.content ? 2 : 1;
+}
+
+/* the reason the saved state can't be used, NULL if it can */
+static
+const char* persist_mismatch(const struct persist_header* h, size_t size)
+{
+    const int init = persist_initialized();
+
+    if (memcmp(h->magic, PERSIST_MAGIC, 8) || h->version != PERSIST_VERSION) return "none";
+    if (!h->valid) return "not saved cleanly";
+    if (h->map_bytes != size || h->ws_bytes != ((uint64_t)params.setsize_mib << 20)) {
+	return "different map or working set size";
+    }
+    if (init && (h->initialized != init || (params.content &&
+		    (h->content[0] != params.content->ratio ||
+		     h->content[1] != params.content->dup_pct ||
+		     h->content[2] != params.content->zero_pct)))) {
+	return "different contents";
+    }
+    return NULL;
+}
+
+static
+char* persist_map(size_t size, int prot)
+{
+    const size_t ws = (uint64_t)params.setsize_mib << 20;
+    const char* mismatch;
+    struct stat st;
+    uint64_t clk;
+    char* buf;
+
+    persist_fd = open(binfo.path, O_RDWR | O_CREAT, 0644);
+    if (persist_fd == -1) {
+	perror("persist object open failed");
+	return NULL;
+    }
+    if (fstat(persist_fd, &st)) {
+	perror("persist object stat failed");
+	goto out_close;
+    }
+    /* the header takes one block, a huge page on hugetlbfs */
+    persist_hdr_len = st.st_blksize > PAGE_SIZE ? st.st_blksize : PAGE_SIZE;
+    if (st.st_size != (off_t)(size + persist_hdr_len)) {
+	if (st.st_size) binfo.state = "different map size";
+	if (ftruncate(persist_fd, (off_t)(size + persist_hdr_len))) {
+	    perror("persist object ftruncate failed");
+	    goto out_close;
+	}
+    }
+    binfo.file_size = size + persist_hdr_len;
+
+    persist_hdr = mmap(NULL, persist_hdr_len, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    persist_fd, (off_t)size);
+    if (persist_hdr == MAP_FAILED) {
+	perror("persist header mmap failed");
+	persist_hdr = NULL;
+	goto out_close;
+    }
+    buf = mmap(NULL, size, prot | PROT_READ, MAP_SHARED, persist_fd, 0);
+    if (buf == MAP_FAILED) {
+	perror("buf mmap failed");
+	goto out_hdr;
+    }
+    if (hugepage_advise(buf, size, params.hugepage)) goto out_unmap;
+
+    mismatch = (st.st_size == (off_t)(size + persist_hdr_len)) ? persist_mismatch(persist_hdr, size) : binfo.state;
+    if (!mismatch) {
+	binfo.checksum = persist_hdr->checksum;
+	binfo.saved_time = persist_hdr->saved_time;
+	binfo.warm = 1;
+	binfo.state = "attached";
+	if (persist_verify) {
+	    printf("Verifying the saved state of %s...\n", binfo.path);
+	    clk = params.tsops->timestamp();
+	    if (persist_checksum(buf, ws) != persist_hdr->checksum) {
+		binfo.warm = 0;
+		binfo.state = "checksum mismatch";
+	    }
+	    binfo.verify_clock = params.tsops->timestamp() - clk;
+	}
+    } else {
+	binfo.state = mismatch;
+    }
+    if (binfo.warm) {
+	persist_init = persist_hdr->initialized;
+	memcpy(persist_content, persist_hdr->content, sizeof(persist_content));
+    } else {
+	persist_init = persist_initialized();
+	if (params.content) {
+	    persist_content[0] = params.content->ratio;
+	    persist_content[1] = params.content->dup_pct;
+	    persist_content[2] = params.content->zero_pct;
+	}
+    }
+    /* the run changes the contents. the state is valid again once saved */
+    persist_hdr->valid = 0;
+    if (msync(persist_hdr, persist_hdr_len, MS_SYNC)) perror("persist header msync failed");
+    return buf;
+
+out_unmap:
+    munmap(buf, size);
+out_hdr:
+    munmap(persist_hdr, persist_hdr_len);
+    persist_hdr = NULL;
+out_close:
+    close(persist_fd);
+    persist_fd = -1;
+    return NULL;
+}
+
+static
+int persist_unmap(char* buf, size_t size)
+{
+    struct persist_header* h = persist_hdr;
+    uint64_t clk;
+    int ret = 0;
+
+    if (h) {
+	clk = params.tsops->timestamp();
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, PERSIST_MAGIC, 8);
+	h->version = PERSIST_VERSION;
+	h->map_bytes = size;
+	h->ws_bytes = (uint64_t)params.setsize_mib << 20;
+	h->checksum = persist_checksum(buf, h->ws_bytes);
+	h->initialized = persist_init;
+	memcpy(h->content, persist_content, sizeof(h->content));
+	h->saved_time = time(NULL);
+	h->valid = 1;
+	if (msync(h, persist_hdr_len, MS_SYNC)) perror("persist header msync failed");
+	printf("Saved the state of %s (checksum %016"PRIx64", %0.1f ms)\n", binfo.path,
+		h->checksum, (double)(params.tsops->timestamp() - clk) / freq_khz);
+	munmap(h, persist_hdr_len);
+	persist_hdr = NULL;
+    }
+    if (munmap(buf, size)) {
+	perror("munmap failed");
+	ret = 1;
+    }
+    if (persist_fd != -1) {
+	close(persist_fd);
+	persist_fd = -1;
+    }
+    return ret;
+}
+
+static
+void persist_report(void)
+{
+    char when[64];
+    time_t t = (time_t)binfo.saved_time;
+
+    printf("persist object : %s\n", binfo.path);
+    printf("object size    : %"PRId64" bytes (map and a %zu byte header)\n",
+	    binfo.file_size, persist_hdr_len);
+    if (binfo.saved_time) {
+	strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&t));
+	printf("saved state    : %s, saved %s, checksum %016"PRIx64"\n", binfo.state, when, binfo.checksum);
+    } else {
+	printf("saved state    : %s\n", binfo.state);
+    }
+    if (binfo.verify_clock >= 0) {
+	printf("verification   : %s in %0.1f ms\n", binfo.warm ? "passed" : "failed",
+		(double)binfo.verify_clock / freq_khz);
+    }
+    if (binfo.warm) {
+	printf("warm start     : initialization skipped%s\n",
+		binfo.skip_warmup ? ", warmup skipped" : "");
+    }
+}
+
+map_backing persist_backing = {
+    .setup = persist_setup,
+    .map = persist_map,
+    .unmap = persist_unmap,
+    .report = persist_report,
+    .name = "persist",
+    .description = "Shared mapping of a named tmpfs or hugetlbfs object kept across runs"
+};
+#endif
+
+/*
+ * all backings
+ */
+static map_backing* all_backing[] = {
+    &anon_backing,
+#ifndef _WIN32
+    &file_backing,
+    &memfd_backing,
+    &persist_backing,
+    &uffd_backing,
+#endif
+    0
+};
+
+map_backing* get_backing_from_arg(const char* arg)
+{
+    int i = 0;
+    size_t len;
+    const char* sep;
+
+    if (!arg) return NULL;
+
+    sep = strchr(arg, ':');
+    len = sep ? (size_t)(sep - arg) : strlen(arg);
+
+    while (all_backing[i]) {
+	if (strlen(all_backing[i]->name) == len &&
+		!my_strncmp(all_backing[i]->name, arg, len)) {
+	    if (all_backing[i]->setup(sep ? sep + 1 : NULL)) return NULL;
+	    return all_backing[i];
+	}
+	i++;
+    }
+    return NULL;
+}
@@ -0,0 +1,94 @@
+#ifndef __BACKING_H__
+#define __BACKING_H__
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/*
+ * A map backing decides what kind of memory the benchmark map is made of.
+ * The default is private anonymous memory, which exercises the swap path.
+ * Other backings exercise e.g. the page cache (file).
+ *
+ * Backings are selected with --backing=NAME[:ARG]. setup() receives ARG
+ * (or NULL) at option parsing time, map() and unmap() are called from main().
+ */
+typedef struct map_backing {
+    int (*setup)(const char* arg);		// parse backing-specific argument. 0 on success
+    char* (*map)(size_t size, int prot);	// returns NULL upon failure
+    int (*unmap)(char* buf, size_t size);	// returns non-zero upon failure
+    void (*report)(void);			// print backing-specific report
+    const char* name;
+    const char* description;
+} map_backing;
+
+extern map_backing anon_backing;
+#ifndef _WIN32
+extern map_backing file_backing;
+extern map_backing memfd_backing;
+extern map_backing persist_backing;
+#endif
+
+/*
+ * huge page modes (--hugepage). These apply on top of the backing.
+ */
+enum {
+    HUGEPAGE_DEFAULT = 0,	// leave it to the system THP policy
+    HUGEPAGE_THP,		// madvise(MADV_HUGEPAGE)
+    HUGEPAGE_NOTHP,		// madvise(MADV_NOHUGEPAGE)
+    HUGEPAGE_HUGETLB_2M,	// MAP_HUGETLB with 2MiB pages
+    HUGEPAGE_HUGETLB_1G,	// MAP_HUGETLB with 1GiB pages
+};
+
+extern int get_hugepage_mode_from_name(const char* str);    // -1 if unknown
+extern const char* hugepage_mode_name(int mode);
+extern int hugepage_shift(int mode);	// log2 of the huge page size of the mode
+extern int hugepage_map_flags(int mode);	// extra mmap flags of the mode
+extern int hugepage_advise(char* buf, size_t size, int mode);
+
+/* parses "NAME[:ARG]", calls setup() and returns the backing. NULL on error */
+extern map_backing* get_backing_from_arg(const char* arg);
+
+/* backing information exported for the xml report */
+struct backing_info {
+    const char* path;	    // backing file path or NULL
+    int64_t file_size;	    // file size in bytes at map time
+    int prepopulated;	    // file already had its blocks allocated
+    int warm;		    // persist: attached a saved state, already initialized
+    int skip_warmup;	    // persist: warmup is skipped when warm
+    const char* state;	    // persist: what was found in the object
+    uint64_t checksum;	    // persist: working set checksum found or saved
+    int64_t verify_clock;   // persist: time to verify the checksum. -1 if not verified
+    int64_t saved_time;	    // persist: when the attached state was saved (time_t)
+};
+
+extern const struct backing_info* get_backing_info(void);
+
+#endif
@@ -0,0 +1,688 @@
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#ifdef __NR_io_uring_setup
+#include <linux/io_uring.h>
+#define BUFPOOL_HAVE_URING 1
+#endif
+#endif
+
+#include "system.h"
+#include "pmbench.h"
+#include "bufpool.h"
+
+static struct bufpool_config config;
+static int config_set = 0;
+
+static const char* policy_names[] = { "clock", "lru" };
+static const char* io_names[] = { "pread", "io_uring" };
+
+const char* bufpool_policy_name(int policy)
+{
+    return policy_names[policy];
+}
+
+const char* bufpool_io_name(int io)
+{
+    if (io < 0) return "auto";
+    return io_names[io];
+}
+
+const struct bufpool_config* get_bufpool_config(void)
+{
+    return config_set ? &config : NULL;
+}
+
+int bufpool_setup(const char* arg)
+{
+    char* s;
+    char* path;
+    char* policy;
+    char* io;
+
+    if (!arg) return -1;
+    config.pool_mib = atoi(arg);
+    if (config.pool_mib < 1) return -1;
+    s = strchr(arg, ':');
+    if (!s || !s[1]) return -1;
+
+    /* PATH ends at the next colon. paths with colons aren't supported */
+    path = strdup(s + 1);
+    policy = strchr(path, ':');
+    if (policy) *policy++ = 0;
+    io = policy ? strchr(policy, ':') : NULL;
+    if (io) *io++ = 0;
+    config.path = path;
+
+    config.policy = BUFPOOL_CLOCK;
+    if (policy && *policy) {
+	for (config.policy = BUFPOOL_CLOCK; config.policy <= BUFPOOL_LRU; config.policy++) {
+	    if (!strcmp(policy, policy_names[config.policy])) break;
+	}
+	if (config.policy > BUFPOOL_LRU) return -1;
+    }
+    config.io = -1;
+    if (io && *io) {
+	if (!strcmp(io, "pread")) config.io = BUFPOOL_IO_PREAD;
+	else if (!strcmp(io, "uring") || !strcmp(io, "io_uring")) config.io = BUFPOOL_IO_URING;
+	else return -1;
+    }
+    config_set = 1;
+    return 0;
+}
+
+#ifndef _WIN32
+
+#define pool_clock() (params.tsops->timestamp())
+#define clock_to_usec(c) ((double)(c) * 1000.0 / freq_khz)
+
+#define BUFPOOL_MAX_PARTS (16)
+#define BUFPOOL_NONE ((uint32_t)-1)
+#define BUFPOOL_FILL_PAGES (256)	// pages written per call when filling the file
+
+struct bp_frame {
+    size_t pfn;		// page held. -1 if the frame is free
+    uint32_t prev;	// lru list, most recent first
+    uint32_t next;
+    int pin;		// fix count
+    uint8_t ref;	// clock reference bit
+    uint8_t dirty;
+};
+
+#ifdef BUFPOOL_HAVE_URING
+/* one io_uring per partition, driven with raw system calls */
+struct bp_ring {
+    int fd;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_array;
+    struct io_uring_sqe* sqes;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_cqe* cqes;
+    void* sq_ptr;
+    size_t sq_len;
+    void* cq_ptr;
+    size_t cq_len;
+    size_t sqes_len;
+};
+#endif
+
+struct bp_part {
+    pthread_mutex_t lock;
+    uint32_t first;	// frames [first, first + count)
+    uint32_t count;
+    uint32_t used;	// frames handed out so far. the rest are free
+    uint32_t hand;	// clock hand, relative to first
+    uint32_t lru_head;
+    uint32_t lru_tail;
+#ifdef BUFPOOL_HAVE_URING
+    struct bp_ring ring;
+#endif
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks;
+    uint64_t pin_waits;
+    uint64_t service_clock;
+    uint64_t service_clock_max;
+    uint64_t io_errors;
+} __attribute__((aligned(64)));
+
+static struct {
+    int fd;
+    int direct;
+    int io;
+    size_t page_size;
+    size_t npages;
+    size_t nframes;
+    int nparts;
+    char* frames;		// nframes page frames
+    struct bp_frame* meta;
+    uint32_t* where;		// page -> frame. BUFPOOL_NONE if not in the pool
+    struct bp_part* parts;
+    int failed;			// a miss failed its io. not reset after the warmup
+} pool = { .fd = -1 };
+
+/*
+ * io_uring
+ */
+#ifdef BUFPOOL_HAVE_URING
+static
+int ring_setup(struct bp_ring* r)
+{
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(__NR_io_uring_setup, 2, &p);
+    if (r->fd < 0) return -1;
+
+    r->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_ptr = mmap(NULL, r->sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) goto fail_close;
+    r->cq_ptr = mmap(NULL, r->cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ptr == MAP_FAILED) goto fail_sq;
+    r->sqes = mmap(NULL, r->sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	    r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) goto fail_cq;
+
+    r->sq_head = (unsigned*)((char*)r->sq_ptr + p.sq_off.head);
+    r->sq_tail = (unsigned*)((char*)r->sq_ptr + p.sq_off.tail);
+    r->sq_mask = (unsigned*)((char*)r->sq_ptr + p.sq_off.ring_mask);
+    r->sq_array = (unsigned*)((char*)r->sq_ptr + p.sq_off.array);
+    r->cq_head = (unsigned*)((char*)r->cq_ptr + p.cq_off.head);
+    r->cq_tail = (unsigned*)((char*)r->cq_ptr + p.cq_off.tail);
+    r->cq_mask = (unsigned*)((char*)r->cq_ptr + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)((char*)r->cq_ptr + p.cq_off.cqes);
+    return 0;
+
+fail_cq:
+    munmap(r->cq_ptr, r->cq_len);
+fail_sq:
+    munmap(r->sq_ptr, r->sq_len);
+fail_close:
+    close(r->fd);
+    r->fd = -1;
+    return -1;
+}
+
+static
+void ring_exit(struct bp_ring* r)
+{
+    if (r->fd < 0) return;
+    munmap(r->sqes, r->sqes_len);
+    munmap(r->cq_ptr, r->cq_len);
+    munmap(r->sq_ptr, r->sq_len);
+    close(r->fd);
+    r->fd = -1;
+}
+
+static
+void ring_prep(struct bp_ring* r, int opcode, char* frame, size_t pfn, int link)
+{
+    unsigned tail = *r->sq_tail;
+    unsigned i = tail & *r->sq_mask;
+    struct io_uring_sqe* sqe = &r->sqes[i];
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = opcode;
+    sqe->fd = pool.fd;
+    sqe->addr = (uint64_t)(uintptr_t)frame;
+    sqe->len = pool.page_size;
+    sqe->off = (uint64_t)pfn * pool.page_size;
+    if (link) sqe->flags = IOSQE_IO_LINK;
+    r->sq_array[i] = i;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* submits what was prepared and waits for all of it. 0 if every transfer completed */
+static
+int ring_submit(struct bp_ring* r, unsigned n)
+{
+    unsigned head, done = 0;
+    int ret = 0;
+
+    if (syscall(__NR_io_uring_enter, r->fd, n, n, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+	return -1;
+    }
+    while (done < n) {
+	head = *r->cq_head;
+	if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+	    if (syscall(__NR_io_uring_enter, r->fd, 0, n - done, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+		    errno != EINTR) return -1;
+	    continue;
+	}
+	if (r->cqes[head & *r->cq_mask].res != (int)pool.page_size) ret = -1;
+	__atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+	done++;
+    }
+    return ret;
+}
+#endif
+
+/*
+ * miss service. the frame's old page @old_pfn is written back first if @dirty
+ */
+static
+int pool_io(struct bp_part* part, char* frame, size_t old_pfn, int dirty, size_t pfn)
+{
+    const off_t ps = pool.page_size;
+
+#ifdef BUFPOOL_HAVE_URING
+    if (pool.io == BUFPOOL_IO_URING) {
+	if (dirty) ring_prep(&part->ring, IORING_OP_WRITE, frame, old_pfn, 1);
+	ring_prep(&part->ring, IORING_OP_READ, frame, pfn, 0);
+	return ring_submit(&part->ring, dirty ? 2 : 1);
+    }
+#endif
+    if (dirty && pwrite(pool.fd, frame, ps, (off_t)old_pfn * ps) != ps) return -1;
+    if (pread(pool.fd, frame, ps, (off_t)pfn * ps) != ps) return -1;
+    return 0;
+}
+
+/*
+ * replacement
+ */
+static inline
+void lru_unlink(struct bp_part* part, uint32_t f)
+{
+    struct bp_frame* m = &pool.meta[f];
+
+    if (m->prev != BUFPOOL_NONE) pool.meta[m->prev].next = m->next;
+    else part->lru_head = m->next;
+    if (m->next != BUFPOOL_NONE) pool.meta[m->next].prev = m->prev;
+    else part->lru_tail = m->prev;
+}
+
+static inline
+void lru_push(struct bp_part* part, uint32_t f)
+{
+    struct bp_frame* m = &pool.meta[f];
+
+    m->prev = BUFPOOL_NONE;
+    m->next = part->lru_head;
+    if (part->lru_head != BUFPOOL_NONE) pool.meta[part->lru_head].prev = f;
+    else part->lru_tail = f;
+    part->lru_head = f;
+}
+
+/* a frame for a new page. BUFPOOL_NONE if every frame is fixed */
+static
+uint32_t pick_victim(struct bp_part* part)
+{
+    uint32_t f, n;
+
+    if (part->used < part->count) return part->first + part->used++;
+
+    if (config.policy == BUFPOOL_LRU) {
+	for (f = part->lru_tail; f != BUFPOOL_NONE; f = pool.meta[f].prev) {
+	    if (!pool.meta[f].pin) return f;
+	}
+	return BUFPOOL_NONE;
+    }
+    /* two sweeps clear every reference bit, so a third finds nothing new */
+    for (n = 0; n < 2 * part->count + 1; n++) {
+	f = part->first + part->hand;
+	if (++part->hand == part->count) part->hand = 0;
+	if (pool.meta[f].pin) continue;
+	if (pool.meta[f].ref) {
+	    pool.meta[f].ref = 0;
+	    continue;
+	}
+	return f;
+    }
+    return BUFPOOL_NONE;
+}
+
+char* bufpool_fix(size_t pfn, int* miss)
+{
+    struct bp_part* part = &pool.parts[pfn % pool.nparts];
+    struct bp_frame* m;
+    uint32_t f;
+    uint64_t clk;
+    size_t old_pfn;
+    int dirty, waited = 0;
+
+    pthread_mutex_lock(&part->lock);
+    for (;;) {
+	f = pool.where[pfn];
+	if (f != BUFPOOL_NONE) {
+	    m = &pool.meta[f];
+	    m->pin++;
+	    if (config.policy == BUFPOOL_LRU) {
+		lru_unlink(part, f);
+		lru_push(part, f);
+	    } else {
+		m->ref = 1;
+	    }
+	    part->hits++;
+	    pthread_mutex_unlock(&part->lock);
+	    if (miss) *miss = 0;
+	    return pool.frames + (size_t)f * pool.page_size;
+	}
+	f = pick_victim(part);
+	if (f != BUFPOOL_NONE) break;
+	/* every frame is fixed by the other workers. let them finish */
+	if (!waited++) part->pin_waits++;
+	pthread_mutex_unlock(&part->lock);
+	sched_yield();
+	pthread_mutex_lock(&part->lock);
+    }
+
+    m = &pool.meta[f];
+    old_pfn = m->pfn;
+    dirty = 0;
+    if (old_pfn != (size_t)-1) {
+	pool.where[old_pfn] = BUFPOOL_NONE;
+	part->evictions++;
+	dirty = m->dirty;
+	if (dirty) part->writebacks++;
+	if (config.policy == BUFPOOL_LRU) lru_unlink(part, f);
+    }
+    clk = pool_clock();
+    if (pool_io(part, pool.frames + (size_t)f * pool.page_size, old_pfn, dirty, pfn)) {
+	part->io_errors++;
+	pool.failed = 1;
+    }
+    clk = pool_clock() - clk;
+    part->service_clock += clk;
+    if (clk > part->service_clock_max) part->service_clock_max = clk;
+
+    m->pfn = pfn;
+    m->pin = 1;
+    m->ref = 1;
+    m->dirty = 0;
+    if (config.policy == BUFPOOL_LRU) lru_push(part, f);
+    pool.where[pfn] = f;
+    part->misses++;
+    pthread_mutex_unlock(&part->lock);
+    if (miss) *miss = 1;
+    return pool.frames + (size_t)f * pool.page_size;
+}
+
+void bufpool_unfix(void* ptr, int dirty)
+{
+    uint32_t f = ((char*)ptr - pool.frames) / pool.page_size;
+    struct bp_part* part = &pool.parts[pool.meta[f].pfn % pool.nparts];
+
+    pthread_mutex_lock(&part->lock);
+    if (dirty) pool.meta[f].dirty = 1;
+    pool.meta[f].pin--;
+    pthread_mutex_unlock(&part->lock);
+}
+
+/*
+ * setup and teardown
+ */
+static
+int pool_fill_file(void)
+{
+    const size_t chunk = BUFPOOL_FILL_PAGES * pool.page_size;
+    uint64_t* buf;
+    size_t pfn, n, i;
+    ssize_t len;
+
+    /* O_DIRECT wants an aligned buffer */
+    buf = mmap(NULL, chunk, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+	perror("bufpool fill buffer mmap failed");
+	return -1;
+    }
+    for (pfn = 0; pfn < pool.npages; pfn += n) {
+	n = pool.npages - pfn;
+	if (n > BUFPOOL_FILL_PAGES) n = BUFPOOL_FILL_PAGES;
+	len = n * pool.page_size;
+	/* garbage that differs per word, like the map gets with -i */
+	for (i = 0; i < len / sizeof(uint64_t); i++) {
+	    buf[i] = ((uint64_t)pfn * pool.page_size + i * sizeof(uint64_t)) * 0x9e3779b97f4a7c15ULL;
+	}
+	if (pwrite(pool.fd, buf, len, (off_t)pfn * pool.page_size) != len) {
+	    perror("bufpool file fill failed");
+	    munmap(buf, chunk);
+	    return -1;
+	}
+    }
+    munmap(buf, chunk);
+    if (!pool.direct) {
+	/* start from the device, not from the page cache */
+	fdatasync(pool.fd);
+	posix_fadvise(pool.fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    return 0;
+}
+
+int bufpool_init(size_t npages, int jobs)
+{
+    size_t per_part;
+    size_t i;
+    int p;
+
+    pool.page_size = (size_t)1 << params.unit_shift;
+    pool.npages = npages;
+    pool.nframes = ((uint64_t)config.pool_mib << 20) / pool.page_size;
+    if (pool.nframes > npages) pool.nframes = npages;
+    if (pool.nframes >= BUFPOOL_NONE) {
+	printf("buffer pool too large\n");
+	return -1;
+    }
+    /* every worker may hold a frame fixed. keep a few times that per partition */
+    for (pool.nparts = BUFPOOL_MAX_PARTS; pool.nparts > 1; pool.nparts >>= 1) {
+	if (pool.nframes / pool.nparts >= 4 * (size_t)jobs) break;
+    }
+    if (pool.nframes < 2 * (size_t)jobs) {
+	printf("buffer pool needs at least 2 frames per job\n");
+	return -1;
+    }
+
+    /* the file is ours for the run. an existing one may be someone's data */
+    pool.fd = open(config.path, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (pool.fd == -1) {
+	if (errno == EEXIST) printf("bufpool file %s exists. remove it or pick another path\n", config.path);
+	else perror("bufpool file open failed");
+	return -1;
+    }
+    /* bypass the page cache where the file system allows it */
+    pool.direct = !fcntl(pool.fd, F_SETFL, O_DIRECT);
+    if (ftruncate(pool.fd, (off_t)(npages * pool.page_size))) {
+	perror("bufpool file ftruncate failed");
+	goto fail_close;
+    }
+    if (pool_fill_file()) goto fail_close;
+
+    pool.frames = mmap(NULL, pool.nframes * pool.page_size, PROT_READ | PROT_WRITE,
+	    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pool.frames == MAP_FAILED) {
+	perror("bufpool frames mmap failed");
+	goto fail_close;
+    }
+    pool.meta = calloc(pool.nframes, sizeof(*pool.meta));
+    pool.where = malloc(npages * sizeof(*pool.where));
+    pool.parts = aligned_alloc(64, pool.nparts * sizeof(*pool.parts));
+    if (!pool.meta || !pool.where || !pool.parts) {
+	printf("bufpool allocation failed\n");
+	goto fail_free;
+    }
+    memset(pool.where, 0xff, npages * sizeof(*pool.where));
+    for (i = 0; i < pool.nframes; i++) {
+	pool.meta[i].pfn = (size_t)-1;
+	pool.meta[i].prev = pool.meta[i].next = BUFPOOL_NONE;
+    }
+
+    pool.io = (config.io < 0) ? BUFPOOL_IO_URING : config.io;
+    per_part = pool.nframes / pool.nparts;
+    memset(pool.parts, 0, pool.nparts * sizeof(*pool.parts));
+    for (p = 0; p < pool.nparts; p++) {
+	struct bp_part* part = &pool.parts[p];
+
+	pthread_mutex_init(&part->lock, NULL);
+	part->first = p * per_part;
+	part->count = (p == pool.nparts - 1) ? pool.nframes - part->first : per_part;
+	part->lru_head = part->lru_tail = BUFPOOL_NONE;
+#ifdef BUFPOOL_HAVE_URING
+	part->ring.fd = -1;
+	if (pool.io == BUFPOOL_IO_URING && ring_setup(&part->ring)) {
+	    if (config.io == BUFPOOL_IO_URING) {
+		perror("io_uring setup failed");
+		goto fail_rings;
+	    }
+	    pool.io = BUFPOOL_IO_PREAD;
+	}
+#endif
+    }
+#ifndef BUFPOOL_HAVE_URING
+    if (config.io == BUFPOOL_IO_URING) {
+	printf("this build has no io_uring support\n");
+	goto fail_free;
+    }
+    pool.io = BUFPOOL_IO_PREAD;
+#else
+    /* kernels before 5.6 set up the ring but fail IORING_OP_READ */
+    if (pool.io == BUFPOOL_IO_URING) {
+	ring_prep(&pool.parts[0].ring, IORING_OP_READ, pool.frames, 0, 0);
+	if (ring_submit(&pool.parts[0].ring, 1)) {
+	    if (config.io == BUFPOOL_IO_URING) {
+		printf("io_uring can't read the bufpool file\n");
+		goto fail_rings;
+	    }
+	    pool.io = BUFPOOL_IO_PREAD;
+	}
+    }
+    /* an auto fallback may have left the rings set up */
+    if (pool.io == BUFPOOL_IO_PREAD) {
+	for (p = 0; p < pool.nparts; p++) ring_exit(&pool.parts[p].ring);
+    }
+#endif
+    return 0;
+
+#ifdef BUFPOOL_HAVE_URING
+fail_rings:
+    for (p = 0; p < pool.nparts; p++) ring_exit(&pool.parts[p].ring);
+#endif
+fail_free:
+    free(pool.parts);
+    free(pool.where);
+    free(pool.meta);
+    munmap(pool.frames, pool.nframes * pool.page_size);
+fail_close:
+    close(pool.fd);
+    pool.fd = -1;
+    unlink(config.path);
+    return -1;
+}
+
+void bufpool_exit(void)
+{
+    int p;
+
+    if (pool.fd == -1) return;
+    for (p = 0; p < pool.nparts; p++) {
+#ifdef BUFPOOL_HAVE_URING
+	ring_exit(&pool.parts[p].ring);
+#endif
+	pthread_mutex_destroy(&pool.parts[p].lock);
+    }
+    munmap(pool.frames, pool.nframes * pool.page_size);
+    free(pool.parts);
+    free(pool.where);
+    free(pool.meta);
+    close(pool.fd);
+    pool.fd = -1;
+    unlink(config.path);
+}
+
+int bufpool_failed(void)
+{
+    return pool.failed;
+}
+
+void get_bufpool_stat(struct bufpool_stat* bs)
+{
+    int p;
+
+    memset(bs, 0, sizeof(*bs));
+    bs->io = pool.io;
+    bs->direct = pool.direct;
+    bs->partitions = pool.nparts;
+    bs->frames = pool.nframes;
+    for (p = 0; p < pool.nparts; p++) {
+	const struct bp_part* part = &pool.parts[p];
+
+	bs->hits += part->hits;
+	bs->misses += part->misses;
+	bs->evictions += part->evictions;
+	bs->writebacks += part->writebacks;
+	bs->pin_waits += part->pin_waits;
+	bs->service_clock += part->service_clock;
+	if (part->service_clock_max > bs->service_clock_max) {
+	    bs->service_clock_max = part->service_clock_max;
+	}
+	bs->io_errors += part->io_errors;
+    }
+}
+
+void bufpool_stat_reset(void)
+{
+    int p;
+
+    for (p = 0; p < pool.nparts; p++) {
+	struct bp_part* part = &pool.parts[p];
+
+	pthread_mutex_lock(&part->lock);
+	part->hits = part->misses = part->evictions = part->writebacks = 0;
+	part->pin_waits = part->service_clock = part->service_clock_max = 0;
+	part->io_errors = 0;
+	pthread_mutex_unlock(&part->lock);
+    }
+}
+
+void bufpool_report(void)
+{
+    struct bufpool_stat bs;
+    uint64_t total;
+
+    get_bufpool_stat(&bs);
+    total = bs.hits + bs.misses;
+    printf("pool           : %"PRIu64" frames (%d MiB) in %d partitions, %s replacement\n",
+	    bs.frames, config.pool_mib, bs.partitions, bufpool_policy_name(config.policy));
+    printf("pool file      : %s (%s, %s)\n", config.path,
+	    bs.direct ? "O_DIRECT" : "buffered", bufpool_io_name(bs.io));
+    printf("hits           : %"PRIu64" (%0.2f%%)\n", bs.hits, total ? 100.0 * bs.hits / total : 0.0);
+    printf("misses         : %"PRIu64" (%"PRIu64" evictions, %"PRIu64" written back)\n",
+	    bs.misses, bs.evictions, bs.writebacks);
+    if (bs.misses) {
+	printf("miss service   : %0.3f us avg, %0.3f us max\n",
+		clock_to_usec(bs.service_clock) / bs.misses, clock_to_usec(bs.service_clock_max));
+    }
+    if (bs.pin_waits) printf("pin waits      : %"PRIu64" misses found every frame fixed\n", bs.pin_waits);
+    if (bs.io_errors) printf("io errors      : %"PRIu64"\n", bs.io_errors);
+}
+
+#endif
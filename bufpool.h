@@ -0,0 +1,110 @@
+#ifndef __BUFPOOL_H__
+#define __BUFPOOL_H__
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/*
+ * Application-managed buffer pool (--bufpool=MIB:PATH[:POLICY[:IO]]).
+ *
+ * The working set lives in a file at PATH and the workers reach it through
+ * a pool of MIB worth of page frames instead of through the benchmark map.
+ * A miss picks a victim frame with the replacement POLICY, writes it back to
+ * the file if dirty, and reads the wanted page in with IO. This is what a
+ * database buffer manager does in place of the kernel paging, so a run with
+ * the pool and a run with a map under the same memory budget compare the
+ * two on one pattern.
+ *
+ * The pool is split into partitions, each with its own lock, frames and
+ * replacement state. Misses are served with the partition lock held.
+ */
+enum {
+    BUFPOOL_CLOCK = 0,	// second chance on a reference bit
+    BUFPOOL_LRU,	// least recently fixed frame
+};
+
+enum {
+    BUFPOOL_IO_PREAD = 0,	// pread()/pwrite()
+    BUFPOOL_IO_URING,		// io_uring, write back and read linked in one submission
+};
+
+struct bufpool_config {
+    int pool_mib;	// frames the pool holds, in MiB
+    const char* path;	// file holding the working set
+    int policy;		// BUFPOOL_* replacement policy
+    int io;		// BUFPOOL_IO_* miss service. -1 = io_uring if the kernel has it
+};
+
+/* parses the option argument. 0 on success */
+extern int bufpool_setup(const char* arg);
+
+/* NULL if no buffer pool was given */
+extern const struct bufpool_config* get_bufpool_config(void);
+
+extern const char* bufpool_policy_name(int policy);
+extern const char* bufpool_io_name(int io);
+
+/* creates and fills the file of @npages pages, and allocates the frames.
+ * PATH must not exist yet. @jobs workers may each hold a frame fixed at once. 0 on success */
+extern int bufpool_init(size_t npages, int jobs);
+extern void bufpool_exit(void);	// removes the file
+
+/* nonzero if a miss failed its io, which makes the run invalid */
+extern int bufpool_failed(void);
+
+/* returns the frame holding page @pfn, fixed until bufpool_unfix().
+ * *@miss is set if the page had to be read in */
+extern char* bufpool_fix(size_t pfn, int* miss);
+
+/* releases the frame holding @ptr. @dirty marks it for write back */
+extern void bufpool_unfix(void* ptr, int dirty);
+
+struct bufpool_stat {
+    int io;			// BUFPOOL_IO_* in use
+    int direct;			// the file is opened with O_DIRECT
+    int partitions;
+    uint64_t frames;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;		// valid pages dropped for a miss
+    uint64_t writebacks;	// of which were dirty
+    uint64_t pin_waits;		// misses that found every frame fixed
+    uint64_t service_clock;	// write back and read of a miss, summed
+    uint64_t service_clock_max;
+    uint64_t io_errors;
+};
+
+extern void get_bufpool_stat(struct bufpool_stat* bs);
+extern void bufpool_stat_reset(void);	// at the end of the warmup
+extern void bufpool_report(void);
+
+#endif
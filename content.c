@@ -0,0 +1,238 @@
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#ifdef PMB_ZLIB
+#include <zlib.h>
+#endif
+
+#include "pmbench.h"
+#include "content.h"
+
+static struct content_profile profile;
+static int profile_set = 0;
+
+/* page selection thresholds in 1/65536 units, and random words per page */
+static uint32_t zero_thresh;
+static uint32_t dup_thresh;
+static int rand_words;
+
+#define CONTENT_SEED (0x5eedc0debadcafeULL)
+#define CONTENT_DUP_VPN (~(uint64_t)0)		// page number of the shared page
+#define WORDS_PER_PAGE (PAGE_SIZE / sizeof(uint32_t))
+#define DEFLATE_OVERHEAD (24)		// bytes deflate adds to a page, roughly
+
+static inline
+uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+enum { PAGE_UNIQUE = 0, PAGE_DUP, PAGE_ZERO };
+
+static inline
+int page_kind(uint64_t vpn)
+{
+    uint32_t u = mix64(vpn ^ CONTENT_SEED) & 0xffff;
+
+    if (u < zero_thresh) return PAGE_ZERO;
+    if (u < dup_thresh) return PAGE_DUP;
+    return PAGE_UNIQUE;
+}
+
+static inline
+uint32_t page_word(uint64_t vpn, int idx)
+{
+    if (idx >= rand_words) return 0;
+    return (uint32_t)mix64((vpn << 10) + idx + CONTENT_SEED);
+}
+
+static void fill_page(uint32_t* page, uint64_t vpn);
+
+#ifdef PMB_ZLIB
+static
+uLongf deflate_size(const uint32_t* page)
+{
+    unsigned char zbuf[PAGE_SIZE + 128];
+    uLongf zlen = sizeof(zbuf);
+
+    if (compress2(zbuf, &zlen, (const unsigned char*)page, PAGE_SIZE, Z_DEFAULT_COMPRESSION) != Z_OK) {
+	return PAGE_SIZE;
+    }
+    return zlen;
+}
+
+/* bisect the random words so that a unique page deflates to PAGE_SIZE/RATIO */
+static
+void calibrate_rand_words(void)
+{
+    uint32_t page[WORDS_PER_PAGE];
+    const uLongf target = (uLongf)(PAGE_SIZE / profile.ratio);
+    int lo = 0, hi = WORDS_PER_PAGE;
+    uint32_t zt = zero_thresh, dt = dup_thresh;
+
+    zero_thresh = dup_thresh = 0;	// every page unique while calibrating
+    while (lo < hi) {
+	rand_words = (lo + hi + 1) / 2;
+	fill_page(page, 0);
+	if (deflate_size(page) <= target) lo = rand_words;
+	else hi = rand_words - 1;
+    }
+    rand_words = lo;
+    zero_thresh = zt;
+    dup_thresh = dt;
+}
+#endif
+
+int content_setup(const char* arg)
+{
+    char* end;
+    double rnd;
+
+    if (!arg) return -1;
+    profile.ratio = strtod(arg, &end);
+    profile.dup_pct = 0.0;
+    profile.zero_pct = 0.0;
+    if (*end == ':') profile.dup_pct = strtod(end + 1, &end);
+    if (*end == ':') profile.zero_pct = strtod(end + 1, &end);
+    if (*end) return -1;
+    if (profile.ratio < 1.0 || profile.dup_pct < 0.0 || profile.zero_pct < 0.0 ||
+	    profile.dup_pct + profile.zero_pct > 100.0) return -1;
+
+    zero_thresh = (uint32_t)(profile.zero_pct * 65536 / 100);
+    dup_thresh = (uint32_t)((profile.zero_pct + profile.dup_pct) * 65536 / 100);
+
+    /* random words don't compress, zero words compress to almost nothing.
+     * without zlib this estimate is all we have */
+    rnd = (double)PAGE_SIZE / profile.ratio - DEFLATE_OVERHEAD;
+    rand_words = (rnd <= 0.0 ? 0 : (int)(rnd / sizeof(uint32_t)));
+    if (rand_words > WORDS_PER_PAGE) rand_words = WORDS_PER_PAGE;
+#ifdef PMB_ZLIB
+    calibrate_rand_words();
+#endif
+
+    profile_set = 1;
+    return 0;
+}
+
+const struct content_profile* get_content_profile(void)
+{
+    return profile_set ? &profile : NULL;
+}
+
+static
+void fill_page(uint32_t* page, uint64_t vpn)
+{
+    int i;
+
+    switch (page_kind(vpn)) {
+    case PAGE_ZERO:
+	memset(page, 0, PAGE_SIZE);
+	return;
+    case PAGE_DUP:
+	vpn = CONTENT_DUP_VPN;
+	break;
+    }
+    for (i = 0; i < rand_words; i++) page[i] = page_word(vpn, i);
+    memset(page + rand_words, 0, (WORDS_PER_PAGE - rand_words) * sizeof(uint32_t));
+}
+
+void content_fill(char* buf, size_t len)
+{
+    size_t off;
+
+    for (off = 0; off + PAGE_SIZE <= len; off += PAGE_SIZE) {
+	fill_page((uint32_t*)(buf + off), (uintptr_t)(buf + off) >> PAGE_SHIFT);
+    }
+}
+
+uint32_t content_word(uint32_t* ptr)
+{
+    uint64_t vpn = (uintptr_t)ptr >> PAGE_SHIFT;
+    int idx = ((uintptr_t)ptr & (PAGE_SIZE - 1)) / sizeof(uint32_t);
+
+    switch (page_kind(vpn)) {
+    case PAGE_ZERO:
+	return 0;
+    case PAGE_DUP:
+	return page_word(CONTENT_DUP_VPN, idx);
+    }
+    return page_word(vpn, idx);
+}
+
+#define CONTENT_SAMPLE_PAGES (4096)
+
+void get_content_stat(struct content_stat* cs)
+{
+    uint64_t vpn, in = 0, out = 0;
+#ifdef PMB_ZLIB
+    uint32_t page[WORDS_PER_PAGE];
+#endif
+
+    memset(cs, 0, sizeof(*cs));
+    cs->ratio = -1.0;
+    for (vpn = 0; vpn < CONTENT_SAMPLE_PAGES; vpn++) {
+	cs->pages++;
+	switch (page_kind(vpn)) {
+	case PAGE_ZERO:
+	    cs->zero_pages++;
+	    continue;
+	case PAGE_DUP:
+	    cs->dup_pages++;
+	    break;
+	}
+#ifdef PMB_ZLIB
+	fill_page(page, vpn);
+	in += PAGE_SIZE;
+	out += deflate_size(page);
+#endif
+    }
+    if (out) cs->ratio = (double)in / out;
+}
+
+void content_report(void)
+{
+    struct content_stat cs;
+
+    get_content_stat(&cs);
+    printf("target profile : %0.2fx compressible, %0.1f%% identical, %0.1f%% zero pages\n",
+	    profile.ratio, profile.dup_pct, profile.zero_pct);
+    printf("generated      : ");
+    if (cs.ratio > 0) printf("%0.2fx (deflate), ", cs.ratio);
+    printf("%0.1f%% identical, %0.1f%% zero pages (%"PRIu64" pages sampled)\n",
+	    100.0 * cs.dup_pages / cs.pages, 100.0 * cs.zero_pages / cs.pages, cs.pages);
+}
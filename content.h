@@ -0,0 +1,77 @@
+#ifndef __CONTENT_H__
+#define __CONTENT_H__
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stddef.h>
+#include <inttypes.h>
+
+/*
+ * Content profile (--content=RATIO[:DUP_PCT[:ZERO_PCT]]).
+ *
+ * Decides what the pages of the map contain, for the benefit of memory
+ * compression (zswap, zram) and deduplication (KSM). ZERO_PCT percent of
+ * the pages are zero-filled, DUP_PCT percent share one identical page, and
+ * the rest are unique. Non-zero pages compress by about RATIO with deflate.
+ *
+ * The content of a page is a function of its virtual page number, so
+ * content_word() can tell what any word should hold without looking at the
+ * page. Write accesses store that word, which dirties the page while
+ * keeping it on profile.
+ */
+struct content_profile {
+    double ratio;	// target compression ratio of non-zero pages
+    double dup_pct;	// percentage of pages with identical contents
+    double zero_pct;	// percentage of zero-filled pages
+};
+
+/* parses the option argument. 0 on success */
+extern int content_setup(const char* arg);
+
+/* NULL if no content profile was given */
+extern const struct content_profile* get_content_profile(void);
+
+/* fills page aligned @buf of @len bytes according to the profile */
+extern void content_fill(char* buf, size_t len);
+
+/* the value the word at @ptr has under the profile */
+extern uint32_t content_word(uint32_t* ptr);
+
+/* profile as generated, measured over a sample of pages */
+struct content_stat {
+    uint64_t pages;		// pages sampled
+    uint64_t zero_pages;
+    uint64_t dup_pages;
+    double ratio;		// deflate ratio of non-zero pages. -1 if unknown
+};
+
+extern void get_content_stat(struct content_stat* cs);
+extern void content_report(void);
+
+#endif
@@ -0,0 +1,720 @@
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <math.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/userfaultfd.h>
+#ifdef PMB_ZLIB
+#include <zlib.h>
+#endif
+#endif
+
+#include "system.h"
+#include "pattern.h"
+#include "pmbench.h"
+#include "pager.h"
+
+/* shared with forked worker processes (--procs), so they all add up here */
+static struct pager_stat* pstat;
+
+const struct pager_stat* get_pager_stat(void)
+{
+    return pstat;
+}
+
+#ifndef _WIN32
+
+#define pager_clock() (params.tsops->timestamp())
+#define clock_to_usec(c) ((double)(c) * 1000.0 / freq_khz)
+
+/*
+ * file backend - pages live in a regular file, one page per page slot.
+ */
+static const char* pf_path;
+static int pf_fd = -1;
+static size_t pf_page_size;
+
+static
+int pfile_setup(const char* arg)
+{
+    if (!arg || !*arg) {
+	printf("file pager backend needs a path: --backing=uffd:file:PATH\n");
+	return -1;
+    }
+    pf_path = strdup(arg);
+    return 0;
+}
+
+static
+int pfile_init(size_t npages, size_t page_size)
+{
+    pf_page_size = page_size;
+    pf_fd = open(pf_path, O_RDWR | O_CREAT, 0644);
+    if (pf_fd == -1) {
+	perror("pager file open failed");
+	return -1;
+    }
+    if (ftruncate(pf_fd, (off_t)(npages * page_size))) {
+	perror("pager file ftruncate failed");
+	close(pf_fd);
+	pf_fd = -1;
+	return -1;
+    }
+    return 0;
+}
+
+static
+int pfile_fetch(size_t pfn, char* page)
+{
+    if (pread(pf_fd, page, pf_page_size, (off_t)(pfn * pf_page_size)) != (ssize_t)pf_page_size) {
+	return -1;
+    }
+    return 0;
+}
+
+static
+int pfile_store(size_t pfn, const char* page)
+{
+    if (pwrite(pf_fd, page, pf_page_size, (off_t)(pfn * pf_page_size)) != (ssize_t)pf_page_size) {
+	return -1;
+    }
+    return 0;
+}
+
+static
+void pfile_report(void)
+{
+    printf("pager file     : %s\n", pf_path);
+}
+
+static pager_backend pfile_backend = {
+    .setup = pfile_setup,
+    .init = pfile_init,
+    .fetch = pfile_fetch,
+    .store = pfile_store,
+    .report = pfile_report,
+    .name = "file",
+    .description = "Pages are read from and written to a regular file"
+};
+
+#ifdef PMB_ZLIB
+/*
+ * zstore backend - in-process compressed store, in the spirit of zram/zswap.
+ * Pages that never were stored are zero-filled.
+ */
+struct zslot {
+    unsigned char* data;    // NULL if never stored
+    uint32_t len;	    // compressed length. == page size if stored raw
+};
+
+static struct zslot* zs_slots;
+static size_t zs_page_size;
+static int zs_level = 1;
+static pthread_mutex_t zs_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread z_stream zs_stream;
+static __thread int zs_stream_ready;
+
+static
+int zstore_setup(const char* arg)
+{
+    if (arg && *arg) {
+	zs_level = atoi(arg);
+	if (zs_level < 1 || zs_level > 9) {
+	    printf("zstore compression level must be from 1-9\n");
+	    return -1;
+	}
+    }
+    return 0;
+}
+
+static
+int zstore_init(size_t npages, size_t page_size)
+{
+    zs_page_size = page_size;
+    zs_slots = calloc(npages, sizeof(struct zslot));
+    if (!zs_slots) {
+	perror("zstore calloc failed");
+	return -1;
+    }
+    return 0;
+}
+
+static
+int zstore_fetch(size_t pfn, char* page)
+{
+    struct zslot slot;
+    uLongf len = zs_page_size;
+    int ret = 0;
+
+    /* the slot can't change under us: a page is stored only while resident,
+     * and it is fetched only while not */
+    pthread_mutex_lock(&zs_lock);
+    slot = zs_slots[pfn];
+    pthread_mutex_unlock(&zs_lock);
+
+    if (!slot.data) return 1;
+    if (slot.len == zs_page_size) {
+	memcpy(page, slot.data, zs_page_size);
+    } else if (uncompress((Bytef*)page, &len, slot.data, slot.len) != Z_OK || len != zs_page_size) {
+	ret = -1;
+    }
+    return ret;
+}
+
+static
+int zstore_store(size_t pfn, const char* page)
+{
+    uLongf len = compressBound(zs_page_size);
+    unsigned char* data;
+    unsigned char* old;
+    uint32_t old_len;
+
+    /* deflate state is per pager thread. setting it up per page would
+     * dominate the store time */
+    if (!zs_stream_ready) {
+	if (deflateInit(&zs_stream, zs_level) != Z_OK) return -1;
+	zs_stream_ready = 1;
+    } else {
+	deflateReset(&zs_stream);
+    }
+    data = malloc(len);
+    if (!data) return -1;
+    zs_stream.next_in = (Bytef*)page;
+    zs_stream.avail_in = zs_page_size;
+    zs_stream.next_out = data;
+    zs_stream.avail_out = len;
+    if (deflate(&zs_stream, Z_FINISH) != Z_STREAM_END || zs_stream.total_out >= zs_page_size) {
+	len = zs_page_size;
+	memcpy(data, page, zs_page_size);
+    } else {
+	len = zs_stream.total_out;
+    }
+    data = realloc(data, len);
+
+    pthread_mutex_lock(&zs_lock);
+    old = zs_slots[pfn].data;
+    old_len = zs_slots[pfn].len;
+    zs_slots[pfn].data = data;
+    zs_slots[pfn].len = len;
+    pthread_mutex_unlock(&zs_lock);
+    if (!old) __sync_fetch_and_add(&pstat->stored_pages, 1);
+    __sync_fetch_and_add(&pstat->stored_bytes, (int64_t)len - (old ? old_len : 0));
+
+    free(old);
+    return 0;
+}
+
+static
+void zstore_report(void)
+{
+    printf("zstore level   : %d\n", zs_level);
+    printf("zstore size    : %"PRIu64" pages in %"PRIu64" KiB", pstat->stored_pages,
+	    pstat->stored_bytes >> 10);
+    if (pstat->stored_bytes) {
+	printf(" (ratio %0.2f)", (double)pstat->stored_pages * zs_page_size / pstat->stored_bytes);
+    }
+    printf("\n");
+}
+
+static pager_backend zstore_backend = {
+    .setup = zstore_setup,
+    .init = zstore_init,
+    .fetch = zstore_fetch,
+    .store = zstore_store,
+    .report = zstore_report,
+    .name = "zstore",
+    .description = "In-process compressed page store (zlib)"
+};
+#endif
+
+/*
+ * delay backend - stands in for a remote memory server.
+ * Each fetch spins for a fixed or exponentially distributed time and
+ * returns a zero page. Stores are free and their data is dropped.
+ */
+enum { DELAY_FIXED = 0, DELAY_EXP };
+static int delay_dist = DELAY_FIXED;
+static int delay_usec = 10;
+static __thread uint64_t delay_rand;
+
+static
+int delay_setup(const char* arg)
+{
+    const char* sep;
+
+    if (!arg || !*arg) return 0;
+    delay_usec = atoi(arg);
+    if (delay_usec < 0) {
+	printf("delay pager backend: delay must not be negative\n");
+	return -1;
+    }
+    sep = strchr(arg, ':');
+    if (!sep) return 0;
+    if (!my_strncmp(sep + 1, "fixed", 8)) delay_dist = DELAY_FIXED;
+    else if (!my_strncmp(sep + 1, "exp", 8)) delay_dist = DELAY_EXP;
+    else {
+	printf("delay pager backend: distribution must be fixed or exp\n");
+	return -1;
+    }
+    return 0;
+}
+
+static
+int delay_init(size_t npages, size_t page_size)
+{
+    return 0;
+}
+
+static
+int delay_fetch(size_t pfn, char* page)
+{
+    double usec = delay_usec;
+    uint64_t end;
+
+    if (delay_dist == DELAY_EXP) {
+	if (!delay_rand) delay_rand = (uint64_t)(uintptr_t)&delay_rand;
+	usec = -log(1.0 - (roll_dice(&delay_rand) + 0.5) / 2147483648.0) * delay_usec;
+    }
+    end = pager_clock() + (uint64_t)(usec * freq_khz / 1000);
+    while (pager_clock() < end) ;
+    return 1;
+}
+
+static
+int delay_store(size_t pfn, const char* page)
+{
+    return 0;
+}
+
+static
+void delay_report(void)
+{
+    printf("delay          : %d us (%s)\n", delay_usec,
+	    delay_dist == DELAY_EXP ? "exponential" : "fixed");
+}
+
+static pager_backend delay_backend = {
+    .setup = delay_setup,
+    .init = delay_init,
+    .fetch = delay_fetch,
+    .store = delay_store,
+    .report = delay_report,
+    .name = "delay",
+    .description = "Synthetic fixed or exponential delay, zero-filled pages"
+};
+
+static pager_backend* all_pager_backend[] = {
+    &pfile_backend,
+#ifdef PMB_ZLIB
+    &zstore_backend,
+#endif
+    &delay_backend,
+    0
+};
+
+/*
+ * the pager
+ */
+static pager_backend* backend;
+static int uffd = -1;
+static int stop_pipe[2] = { -1, -1 };
+static char* map_base;
+static size_t map_npages;
+static size_t page_size;
+static pthread_t* pager_tid;
+static int uffd_wp;	// evictions write-protect the victim first
+
+/*
+ * residency: one state byte per page, and a fifo of resident pages for
+ * eviction. Only placed pages are evicted. Touching a page that is still
+ * being faulted in would block the pager on its own map.
+ */
+enum { RES_ABSENT = 0, RES_PLACING, RES_PLACED, RES_EVICTING };
+
+static pthread_mutex_t res_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char* resident;
+static size_t* fifo;
+static size_t fifo_head, fifo_count;
+
+static
+int uffd_setup(const char* arg)
+{
+    int i = 0;
+    size_t len;
+    const char* sep;
+
+    if (!arg || !*arg) {
+	printf("uffd backing needs a pager backend: --backing=uffd:BACKEND[:ARG]\n");
+	return -1;
+    }
+    pstat = mmap(NULL, sizeof(*pstat), PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (pstat == MAP_FAILED) {
+	perror("pager stat mmap failed");
+	pstat = NULL;
+	return -1;
+    }
+    sep = strchr(arg, ':');
+    len = sep ? (size_t)(sep - arg) : strlen(arg);
+
+    while (all_pager_backend[i]) {
+	if (strlen(all_pager_backend[i]->name) == len &&
+		!my_strncmp(all_pager_backend[i]->name, arg, len)) {
+	    backend = all_pager_backend[i];
+	    pstat->backend = backend->name;
+	    return backend->setup(sep ? sep + 1 : NULL);
+	}
+	i++;
+    }
+    printf("pager backend unrecognized: %s\n", arg);
+    return -1;
+}
+
+/*
+ * claims @pfn as resident. returns the page to evict, or -1 if none.
+ * Pages still being placed go back to the tail of the fifo.
+ */
+static
+ssize_t residency_claim(size_t pfn, int* already)
+{
+    ssize_t victim = -1;
+    uint64_t peak;
+    size_t cand, n;
+
+    pthread_mutex_lock(&res_lock);
+    /* another pager thread is storing it. it can be fetched once stored */
+    while (resident[pfn] == RES_EVICTING) {
+	pthread_mutex_unlock(&res_lock);
+	sched_yield();
+	pthread_mutex_lock(&res_lock);
+    }
+    *already = resident[pfn] != RES_ABSENT;
+    if (!*already) {
+	resident[pfn] = RES_PLACING;
+	fifo[(fifo_head + fifo_count) % map_npages] = pfn;
+	fifo_count++;
+	for (n = fifo_count; n && pstat->resident_limit && fifo_count > pstat->resident_limit; n--) {
+	    cand = fifo[fifo_head];
+	    fifo_head = (fifo_head + 1) % map_npages;
+	    if (resident[cand] == RES_PLACED) {
+		fifo_count--;
+		resident[cand] = RES_EVICTING;
+		victim = cand;
+		break;
+	    }
+	    fifo[(fifo_head + fifo_count - 1) % map_npages] = cand;
+	}
+	for (peak = pstat->resident_peak; fifo_count > peak; peak = pstat->resident_peak) {
+	    if (__sync_bool_compare_and_swap(&pstat->resident_peak, peak, fifo_count)) break;
+	}
+    }
+    pthread_mutex_unlock(&res_lock);
+    return victim;
+}
+
+static
+void pager_wake(uint64_t addr)
+{
+    struct uffdio_range range = { .start = addr, .len = page_size };
+    if (ioctl(uffd, UFFDIO_WAKE, &range)) perror("pager UFFDIO_WAKE");
+}
+
+/*
+ * stores a placed page back and drops it. Writers block on the write
+ * protection until the page is gone, then fault it back in with their
+ * write intact.
+ */
+static
+void pager_evict(size_t pfn)
+{
+    char* addr = map_base + pfn * page_size;
+    struct uffdio_writeprotect wp = {
+	.range = { .start = (uint64_t)(uintptr_t)addr, .len = page_size },
+	.mode = UFFDIO_WRITEPROTECT_MODE_WP };
+    uint64_t t = pager_clock();
+
+    if (uffd_wp && ioctl(uffd, UFFDIO_WRITEPROTECT, &wp)) perror("pager UFFDIO_WRITEPROTECT");
+    if (backend->store(pfn, addr)) {
+	printf("pager: backend store failed for page %zu\n", pfn);
+    }
+    __sync_fetch_and_add(&pstat->store_clock, pager_clock() - t);
+    if (madvise(addr, page_size, MADV_DONTNEED)) perror("pager madvise(DONTNEED)");
+    pthread_mutex_lock(&res_lock);
+    resident[pfn] = RES_ABSENT;
+    pthread_mutex_unlock(&res_lock);
+    if (uffd_wp) pager_wake(wp.range.start);
+    __sync_fetch_and_add(&pstat->evictions, 1);
+}
+
+static
+void pager_serve(uint64_t addr, char* page, uint64_t t_start)
+{
+    size_t pfn = (addr - (uint64_t)(uintptr_t)map_base) / page_size;
+    ssize_t victim;
+    int already, ret;
+    uint64_t t, elapsed;
+
+    victim = residency_claim(pfn, &already);
+    if (already) {
+	/* another thread faulted on the same page and it's taken care of */
+	pager_wake(addr);
+	return;
+    }
+    if (victim >= 0) pager_evict(victim);
+
+    t = pager_clock();
+    ret = backend->fetch(pfn, page);
+    __sync_fetch_and_add(&pstat->fetch_clock, pager_clock() - t);
+    if (ret < 0) {
+	printf("pager: backend fetch failed for page %zu\n", pfn);
+	ret = 1;
+    }
+
+    if (ret == 1) {
+	struct uffdio_zeropage zp = { .range = { .start = addr, .len = page_size } };
+	ret = ioctl(uffd, UFFDIO_ZEROPAGE, &zp);
+	__sync_fetch_and_add(&pstat->zero_fills, 1);
+    } else {
+	struct uffdio_copy copy = {
+	    .dst = addr, .src = (uint64_t)(uintptr_t)page, .len = page_size, .mode = 0 };
+	ret = ioctl(uffd, UFFDIO_COPY, &copy);
+    }
+    /* EEXIST: the page got placed meanwhile. the faulting thread needs a wake */
+    if (ret) {
+	if (errno == EEXIST) pager_wake(addr);
+	else perror("pager page placement failed");
+    }
+    /* a page that failed to place stays out of the eviction */
+    if (!ret || errno == EEXIST) {
+	pthread_mutex_lock(&res_lock);
+	resident[pfn] = RES_PLACED;
+	pthread_mutex_unlock(&res_lock);
+    }
+
+    elapsed = pager_clock() - t_start;
+    __sync_fetch_and_add(&pstat->faults, 1);
+    __sync_fetch_and_add(&pstat->service_clock, elapsed);
+    for (t = pstat->service_clock_max; elapsed > t; t = pstat->service_clock_max) {
+	if (__sync_bool_compare_and_swap(&pstat->service_clock_max, t, elapsed)) break;
+    }
+}
+
+static
+void* pager_thread(void* arg)
+{
+    struct pollfd pfd[2] = {
+	{ .fd = uffd, .events = POLLIN },
+	{ .fd = stop_pipe[0], .events = POLLIN },
+    };
+    struct uffd_msg msg;
+    char* page;
+    ssize_t n;
+
+    if (posix_memalign((void**)&page, page_size, page_size)) {
+	printf("pager: page buffer allocation failed\n");
+	return NULL;
+    }
+    for (;;) {
+	if (poll(pfd, 2, -1) == -1) {
+	    if (errno == EINTR) continue;
+	    perror("pager poll");
+	    break;
+	}
+	if (pfd[1].revents) break;
+	n = read(uffd, &msg, sizeof(msg));
+	if (n != sizeof(msg)) {
+	    if (n == -1 && errno == EAGAIN) continue;
+	    perror("pager read");
+	    break;
+	}
+	if (msg.event != UFFD_EVENT_PAGEFAULT) continue;
+	/* a write to a page being evicted. the eviction wakes it */
+	if (msg.arg.pagefault.flags & UFFD_PAGEFAULT_FLAG_WP) continue;
+	pager_serve(msg.arg.pagefault.address & ~((uint64_t)page_size - 1), page, pager_clock());
+    }
+    free(page);
+    return NULL;
+}
+
+static
+char* uffd_map(size_t size, int prot)
+{
+    struct uffdio_api api = { .api = UFFD_API, .features = 0 };
+    struct uffdio_register reg;
+    int i, s;
+
+    page_size = sysconf(_SC_PAGESIZE);
+    map_npages = size / page_size;
+    pstat->threads = params.pager_threads;
+    pstat->resident_limit = ((uint64_t)params.resident_mib << 20) / page_size;
+
+    resident = calloc(map_npages, 1);
+    fifo = calloc(map_npages, sizeof(size_t));
+    pager_tid = calloc(params.pager_threads, sizeof(pthread_t));
+    if (!resident || !fifo || !pager_tid) {
+	perror("pager calloc failed");
+	goto out_free;
+    }
+    if (backend->init(map_npages, page_size)) goto out_free;
+
+    map_base = mmap(NULL, size, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map_base == MAP_FAILED) {
+	perror("buf mmap failed");
+	goto out_free;
+    }
+    /* the pager works in base pages */
+    madvise(map_base, size, MADV_NOHUGEPAGE);
+
+    uffd = syscall(__NR_userfaultfd, O_CLOEXEC | O_NONBLOCK);
+    if (uffd == -1) {
+	perror("userfaultfd failed");
+	printf("Check that userfaultfd is enabled (e.g., /proc/sys/vm/unprivileged_userfaultfd)\n");
+	goto out_unmap;
+    }
+    if (ioctl(uffd, UFFDIO_API, &api)) {
+	perror("UFFDIO_API failed");
+	goto out_close;
+    }
+    reg.range.start = (uint64_t)(uintptr_t)map_base;
+    reg.range.len = size;
+    reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+    /* without write protection a write racing an eviction may get lost */
+    uffd_wp = (api.features & UFFD_FEATURE_PAGEFAULT_FLAG_WP) && pstat->resident_limit &&
+	    (prot & PROT_WRITE);
+    if (uffd_wp) reg.mode |= UFFDIO_REGISTER_MODE_WP;
+    if (ioctl(uffd, UFFDIO_REGISTER, &reg)) {
+	perror("UFFDIO_REGISTER failed");
+	goto out_close;
+    }
+    if (pipe(stop_pipe)) {
+	perror("pager pipe failed");
+	goto out_close;
+    }
+    for (i = 0; i < params.pager_threads; i++) {
+	s = pthread_create(&pager_tid[i], NULL, pager_thread, NULL);
+	if (s != 0) {
+	    errno = s;
+	    perror("pager pthread_create");
+	    goto out_stop;
+	}
+    }
+    return map_base;
+
+out_stop:
+    /* the pagers started so far are waiting in poll */
+    if (write(stop_pipe[1], "x", 1) != 1) perror("pager stop");
+    while (i--) pthread_join(pager_tid[i], NULL);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    stop_pipe[0] = stop_pipe[1] = -1;
+out_close:
+    close(uffd);
+    uffd = -1;
+out_unmap:
+    munmap(map_base, size);
+out_free:
+    free(resident);
+    free(fifo);
+    free(pager_tid);
+    resident = NULL;
+    fifo = NULL;
+    pager_tid = NULL;
+    return NULL;
+}
+
+static
+int uffd_unmap(char* buf, size_t size)
+{
+    int i, ret = 0;
+
+    if (write(stop_pipe[1], "x", 1) != 1) perror("pager stop");
+    for (i = 0; i < params.pager_threads; i++) pthread_join(pager_tid[i], NULL);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    close(uffd);
+    uffd = -1;
+
+    if (munmap(buf, size)) {
+	perror("munmap failed");
+	ret = 1;
+    }
+    free(resident);
+    free(fifo);
+    free(pager_tid);
+    return ret;
+}
+
+static
+void uffd_report(void)
+{
+    printf("pager backend  : %s (%s)\n", backend->name, backend->description);
+    backend->report();
+    printf("pager threads  : %d\n", pstat->threads);
+    printf("resident limit : ");
+    if (pstat->resident_limit) printf("%"PRIu64" pages\n", pstat->resident_limit);
+    else printf("unlimited\n");
+    printf("resident peak  : %"PRIu64" pages\n", pstat->resident_peak);
+    printf("faults served  : %"PRIu64" (%"PRIu64" zero-filled)\n", pstat->faults, pstat->zero_fills);
+    printf("evictions      : %"PRIu64"\n", pstat->evictions);
+    if (pstat->faults) {
+	printf("fault service  : %0.3f us avg, %0.3f us max\n",
+		clock_to_usec(pstat->service_clock) / pstat->faults,
+		clock_to_usec(pstat->service_clock_max));
+	printf("backend fetch  : %0.3f us avg\n", clock_to_usec(pstat->fetch_clock) / pstat->faults);
+    }
+    if (pstat->evictions) {
+	printf("backend store  : %0.3f us avg\n", clock_to_usec(pstat->store_clock) / pstat->evictions);
+    }
+}
+
+map_backing uffd_backing = {
+    .setup = uffd_setup,
+    .map = uffd_map,
+    .unmap = uffd_unmap,
+    .report = uffd_report,
+    .name = "uffd",
+    .description = "Anonymous map served by a userfaultfd pager"
+};
+#endif
@@ -0,0 +1,83 @@
+#ifndef __PAGER_H__
+#define __PAGER_H__
+/*
+   Copyright (c) 2014, Intel Corporation
+   All rights reserved.
+
+   Redistribution and use in source and binary forms, with or without
+   modification, are permitted provided that the following conditions are met:
+
+       * Redistributions of source code must retain the above copyright
+         notice, this list of conditions and the following disclaimer.
+       * Redistributions in binary form must reproduce the above copyright
+         notice, this list of conditions and the following disclaimer in the
+         documentation and/or other materials provided with the distribution.
+       * Neither the name of Intel Corporation nor the names of its
+         contributors may be used to endorse or promote products derived from
+         this software without specific prior written permission.
+
+   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+   ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE
+   LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+   CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+   SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+   INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+   CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+   ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+   POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stddef.h>
+#include <inttypes.h>
+
+#include "backing.h"
+
+/*
+ * User-space pager (--backing=uffd:BACKEND[:ARG]).
+ *
+ * The map is registered with userfaultfd and pager threads serve missing
+ * pages from a pager backend. When a resident limit is given, the oldest
+ * resident page is stored back to the backend and dropped with
+ * MADV_DONTNEED, so its next access faults into the pager again.
+ *
+ * setup() receives ARG at option parsing time, init() is called at map time.
+ * fetch() fills @page with the contents of @pfn. It returns 1 if the page
+ * should be zero-filled instead, 0 on success, and -1 on failure.
+ */
+typedef struct pager_backend {
+    int (*setup)(const char* arg);
+    int (*init)(size_t npages, size_t page_size);
+    int (*fetch)(size_t pfn, char* page);
+    int (*store)(size_t pfn, const char* page);	// 0 on success
+    void (*report)(void);
+    const char* name;
+    const char* description;
+} pager_backend;
+
+#ifndef _WIN32
+extern map_backing uffd_backing;
+#endif
+
+/* pager statistics exported for the xml report */
+struct pager_stat {
+    const char* backend;	// backend name
+    int threads;		// number of pager threads
+    uint64_t resident_limit;	// in pages. 0 = unlimited
+    uint64_t resident_peak;	// in pages
+    uint64_t faults;		// page faults served
+    uint64_t zero_fills;	// faults served with a zero page
+    uint64_t evictions;		// pages stored back and dropped
+    uint64_t service_clock;	// fault read to page placed, summed
+    uint64_t service_clock_max;
+    uint64_t fetch_clock;	// time in backend fetch, summed
+    uint64_t store_clock;	// time in backend store, summed
+    uint64_t stored_bytes;	// bytes the backend holds (compressed store)
+    uint64_t stored_pages;
+};
+
+extern const struct pager_stat* get_pager_stat(void);
+
+#endif
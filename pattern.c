@@ -303,11 +303,24 @@ size_t normal_ih_get_warmup_run(void *ctx_)
     return ctx->n_user;
 }
 
+/* hottest in the middle, alternating outwards */
+static
+size_t normal_ih_get_rank(void *ctx_, size_t rank)
+{
+    normal_ih_context* ctx = ctx_;
+    size_t mid = ctx->n_user / 2;
+    size_t d = (rank + 1) / 2;
+
+    if (rank & 1) return (d <= mid) ? mid - d : rank;
+    return (mid + d <= ctx->n_user) ? mid + d : rank;
+}
+
 pattern_generator normal_ih_pattern = 
 {
     .alloc_pattern = normal_ih_alloc_pattern_fn,
     .get_next = normal_ih_get_number,
     .get_warmup_run = normal_ih_get_warmup_run,
+    .get_rank = normal_ih_get_rank,
     .free_pattern = generic_free_pattern,
     .name = "normal_ih",
     .description = "Randomized Normal Distribution (Irwin-Hall)"
@@ -386,11 +399,24 @@ size_t normal_get_warmup_run(void *ctx_)
     return ctx->n;
 }
 
+/* hottest at the mean n/2, alternating outwards */
+static
+size_t normal_get_rank(void *ctx_, size_t rank)
+{
+    normal_context* ctx = ctx_;
+    size_t mid = ctx->n / 2;
+    size_t d = (rank + 1) / 2;
+
+    if (rank & 1) return (d <= mid) ? mid - d : rank;
+    return (mid + d < ctx->n) ? mid + d : rank;
+}
+
 pattern_generator normal_pattern = 
 {
     .alloc_pattern = normal_alloc_pattern_fn,
     .get_next = normal_get_number,
     .get_warmup_run = normal_get_warmup_run,
+    .get_rank = normal_get_rank,
     .free_pattern = generic_free_pattern,
     .name = "normal",
     .description = "Randomized Normal Distribution"
@@ -453,11 +479,19 @@ size_t pareto_get_warmup_run(void *ctx_)
     return (size_t)ctx->h * 8;
 }
 
+/* density falls off with the index: lowest are hottest */
+static
+size_t pareto_get_rank(void *ctx_, size_t rank)
+{
+    return rank;
+}
+
 pattern_generator pareto_pattern = 
 {
     .alloc_pattern = pareto_alloc_pattern_fn,
     .get_next = pareto_get_number,
     .get_warmup_run = pareto_get_warmup_run,
+    .get_rank = pareto_get_rank,
     .free_pattern = generic_free_pattern,
     .name = "pareto",
     .description = "Randomized Bounded Pareto Distribution"
@@ -468,6 +502,7 @@ pattern_generator zipf_pattern = {
     .alloc_pattern = pareto_alloc_pattern_fn,
     .get_next = pareto_get_number,
     .get_warmup_run = pareto_get_warmup_run,
+    .get_rank = pareto_get_rank,
     .free_pattern = generic_free_pattern,
     .name = "zipf",
     .description = "Randomized Zipf Distribution"
@@ -495,6 +530,12 @@ pattern_generator* get_pattern_from_name(const char* str)
     return NULL;
 }
 
+size_t get_pattern_rank(pattern_generator* pattern, void* ctx, size_t rank)
+{
+    if (!pattern->get_rank) return rank;
+    return pattern->get_rank(ctx, rank);
+}
+
 /*
  * page offset random generator
  */
@@ -42,6 +42,7 @@ typedef struct pattern_generator {
     void * (*alloc_pattern)(size_t size, fp_t param1, uint32_t random_seed);
     size_t (*get_next)(void* ctx);
     size_t (*get_warmup_run)(void* ctx);
+    size_t (*get_rank)(void* ctx, size_t rank);	// index of the @rank-th hottest. NULL if flat
     int (*free_pattern)(void* ctx);
     const char* name;
     const char* description;
@@ -55,6 +56,9 @@ extern pattern_generator zipf_pattern;
 
 extern pattern_generator* get_pattern_from_name(const char* str);
 
+/* index drawn @rank-th most often. flat patterns rank in index order */
+extern size_t get_pattern_rank(pattern_generator* pattern, void* ctx, size_t rank);
+
 typedef uint32_t (*get_pattern_fn)(uint64_t *); 
 extern get_pattern_fn get_offset_function(int n);
 
@@ -40,6 +40,9 @@
 #include <stdarg.h>
 #include <inttypes.h>
 #include <fcntl.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 
 #ifdef _WIN32
@@ -48,6 +51,7 @@
 #else 
 #include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/wait.h>
 #include <argp.h>
 #endif
 
@@ -64,12 +68,48 @@
 #include "cpuid.h"
 #include "pattern.h"
 #include "access.h"
+#include "backing.h"
+#include "pager.h"
+#include "content.h"
+#include "bufpool.h"
 
 #include "pmbench.h"
 
 /*
  * Program arguments handling
  */
+
+/* keys for options that only have a long name */
+enum {
+    OPT_EVICT_INTERVAL = 0x100,
+    OPT_PAGER_THREADS,
+    OPT_RESIDENT,
+    OPT_PROCS,
+    OPT_TOPOLOGY,
+    OPT_CONTENT,
+    OPT_MLOCK,
+    OPT_CGROUP,
+    OPT_MEMORY_MAX,
+    OPT_MEMORY_HIGH,
+    OPT_SWAP_MAX,
+    OPT_ANTAGONIST,
+    OPT_RECOVER,
+    OPT_CHURN,
+    OPT_CHURN_OPS,
+    OPT_FAULT,
+    OPT_REGIONS,
+    OPT_PREFETCH,
+    OPT_BUFPOOL,
+    OPT_SYNC,
+    OPT_COW,
+    OPT_FRAGMENT,
+    OPT_MEMPOLICY,
+    OPT_NUMA_MATRIX,
+    OPT_GRANULARITY,
+    OPT_STREAM,
+    OPT_MLP,
+};
+
 static struct argp_option options[] = {
     { "mapsize", 'm', "MAPSIZE", 0, "Mmap size in MiB" },
     { "setsize", 's', "SETSIZE", 0, "Working set size in MiB" },
@@ -83,11 +123,45 @@ static struct argp_option options[] = {
     { "ratio", 'r', "RATIO", 0, "Percentage read/write ratio (0 = write only, 100 = read only; default 50)" }, //TODO: count # of reads/writes
     { "offset", 'o', "OFFSET", 0, "Specify static page access offset (default random)" },
     { "initialize", 'i', 0, OPTION_ARG_OPTIONAL, "Initialize memory map with garbage data" },
+    { "content", OPT_CONTENT, "RATIO[:DUP_PCT[:ZERO_PCT]]", 0, "Fill and write pages to compress by RATIO, with DUP_PCT identical and ZERO_PCT zero pages. Implies -i" },
     { "threshold", 'h', "THRESHOLD", 0, "Set the threshold time to trigger the ftrace log" },
     { "wrneedsrd", 'z', 0, OPTION_ARG_OPTIONAL, "Write is preceeded by read on the same memory" },
+    { "mlp", OPT_MLP, "K[:MODE]", 0, "Issue K(1-64) independent accesses per batch, timed as a group. MODE is load(def) or update (GUPS-style read-modify-write)" },
+    { "granularity", OPT_GRANULARITY, "GRAIN", 0, "Bytes each access reads or writes. word(def), lines:N (N cache lines), or page" },
     { "file", 'f', "FILE", 0, "Filename for XML output" },
+    { "backing", 'b', "BACKING[:ARG]", 0, "Map backing. e.g., anon(def), file:PATH[:overwrite], memfd, persist:PATH[:skip-warmup][:no-verify], uffd:BACKEND[:ARG]" },
+#ifndef _WIN32
+    { "pager-threads", OPT_PAGER_THREADS, "NUM", 0, "Number of uffd pager threads (default 1)" },
+    { "resident", OPT_RESIDENT, "MIB", 0, "Resident limit of the uffd pager in MiB (default unlimited)" },
+    { "shared", 'S', 0, OPTION_ARG_OPTIONAL, "Map with MAP_SHARED instead of MAP_PRIVATE" },
+    { "hugepage", 'H', "MODE", 0, "Huge page mode. default, thp, nothp, 2m, or 1g (hugetlb)" },
+    { "unit", 'u', "UNIT", 0, "Pattern unit. base(def) page or huge page" },
+    { "cgroup", OPT_CGROUP, "PARENT", OPTION_ARG_OPTIONAL, "Run in a new cgroup v2 under PARENT (default the hierarchy root)" },
+    { "memory-max", OPT_MEMORY_MAX, "MIB", 0, "memory.max of the cgroup. Implies --cgroup" },
+    { "memory-high", OPT_MEMORY_HIGH, "MIB", 0, "memory.high of the cgroup. Implies --cgroup" },
+    { "swap-max", OPT_SWAP_MAX, "MIB", 0, "memory.swap.max of the cgroup. Implies --cgroup" },
+    { "regions", OPT_REGIONS, "NUM[:MODE]", 0, "Map NUM separate regions. MODE is guard(def) or prot" },
+    { "fault", OPT_FAULT, "MODE[:KIB]", 0, "Fault in a fresh map once instead of the timed run. MODE is cold, populate, populate-read or populate-write" },
+    { "fragment", OPT_FRAGMENT, "MIB[:PIN_PCT[:UNMOV_PCT]]", 0, "Fragment memory with a MIB region before the run. PIN_PCT(def 10) and UNMOV_PCT(def 10) of its freed pages are refilled mlocked and unmovable" },
+    { "stream", OPT_STREAM, 0, 0, "Sweep the working set with whole page accesses instead of the pattern, and report bytes per second" },
+    { "bufpool", OPT_BUFPOOL, "MIB:PATH[:POLICY[:IO]]", 0, "Reach the working set in file PATH through a MIB buffer pool. POLICY is clock(def) or lru, IO is pread or uring" },
+#endif
 #ifdef PMB_THREAD
     { "jobs", 'j', "NUMJOBS", 0, "Number of concurrent jobs (threads)" },
+#ifndef _WIN32
+    { "procs", OPT_PROCS, "NUMPROCS", 0, "Number of concurrent worker processes, each with its own map" },
+    { "topology", OPT_TOPOLOGY, "TOPOLOGY", 0, "Worker map sharing. shared(def), partition, private, or mix:SHARED_PCT" },
+    { "evict", 'E', "MODE[:PERCENT]", 0, "Evict PERCENT(def 100) of the working set before the run. MODE is pageout or cold" },
+    { "evict-interval", OPT_EVICT_INTERVAL, "SEC", 0, "Repeat the eviction every SEC seconds during the run" },
+    { "mlock", OPT_MLOCK, "PERCENT[:MODE]", 0, "Mlock PERCENT of the working set. MODE is hot(def) or range" },
+    { "antagonist", OPT_ANTAGONIST, "SHAPE:MIB[:SEC]", 0, "Run a memory hog of MIB peak in SEC(def 10) cycles. SHAPE is square, ramp or spike" },
+    { "recover", OPT_RECOVER, "PERCENT", 0, "Recovered when interval p99 is within PERCENT(def 10) of the baseline" },
+    { "churn", OPT_CHURN, "RATE[:KIB]", 0, "Churn RATE ranges of KIB(def 256) of the map per second during the run" },
+    { "prefetch", OPT_PREFETCH, "DEPTH[:HINT]", 0, "Prefetch DEPTH draws ahead of each worker. HINT is normal, random or sequential" },
+    { "sync", OPT_SYNC, "MODE[:MS]", 0, "Watch the dirty pages of a shared file map and sync it every MS(def 1000). MODE is none, msync or fdatasync" },
+    { "cow", OPT_COW, "SIDE", 0, "Fork a copy-on-write snapshot after warmup. SIDE runs the timed loop: parent, child or both" },
+    { "churn-ops", OPT_CHURN_OPS, "OP[,OP...]", 0, "Churn operations. dontneed, free, remap, mremap, mprotect (def dontneed,free)" },
+#endif
 #endif
 #ifdef XALLOC
     { "xalloc", 'x', "REALMEMSIZE", 0, "Non-zero REAMMEMSIZE (MiB) enables xalloc. xmmap uses REALMEMSIZE of real memory" },
@@ -96,6 +170,8 @@ static struct argp_option options[] = {
 #ifdef PMB_NUMA
     { "affinityset", 'y', "CPUSTR[:THRCNT]", 0, "Affinity set creation for numa system"
     },
+    { "mempolicy", OPT_MEMPOLICY, "POLICY[:NODES]", 0, "Memory policy of the map. interleave[:NODES], preferred:NODE, local or remote[:NODE]" },
+    { "numa-matrix", OPT_NUMA_MATRIX, "MIB", OPTION_ARG_OPTIONAL, "Measure memory and swap-in latency of every cpu node to memory node pair with a MIB(def 4x LLC, min 64) buffer before the run" },
 #endif
     { 0 }
 };
@@ -105,6 +181,45 @@ static struct argp_option options[] = {
 // parameter definition moved to pmbench.h
 parameters params;
 
+static const char* topology_names[] = { "shared", "partition", "private", "mix" };
+
+const char* topology_name(int topology)
+{
+    return topology_names[topology];
+}
+
+/* access classes. the planes follow plane 0 in the stats area */
+int num_access_class = 0;
+const char* access_class_name[MAX_ACCESS_CLASS + 1] = { "all" };
+
+/* returns the class index (plane number) */
+static
+__attribute__((cold))
+int access_class_add(const char* name)
+{
+    if (num_access_class == MAX_ACCESS_CLASS) {
+	printf("too many access classes\n");
+	exit(EXIT_FAILURE);
+    }
+    access_class_name[++num_access_class] = name;
+    return num_access_class;
+}
+
+char* access_class_plane(char* stats, int cls)
+{
+    return stats + (size_t)cls * PAGE_SIZE * params.jobs;
+}
+
+static
+int access_class_find(const char* name)
+{
+    int i;
+    for (i = 1; i <= num_access_class; i++) {
+	if (!my_strncmp(access_class_name[i], name, 32)) return i;
+    }
+    return 0;
+}
+
 
 static
 __attribute__((cold))
@@ -121,9 +236,54 @@ void set_default_params(parameters* p)
     p->cold = 0;
     p->tsops = &rdtscp_ops;
     p->jobs = 1;
+    p->procs = 0;
+    p->topology = TOPO_SHARED;
+    p->mix_pct = 50;
     p->init_garbage = 0;
+    p->content = NULL;
     p->threshold = 0;
     p->write_needs_read = 0;
+    p->backing = &anon_backing;
+    p->map_shared = 0;
+    p->hugepage = HUGEPAGE_DEFAULT;
+    p->unit_huge = 0;
+    p->unit_shift = PAGE_SHIFT;
+    p->evict_mode = EVICT_NONE;
+    p->evict_pct = 100;
+    p->evict_interval_sec = 0;
+    p->pager_threads = 1;
+    p->resident_mib = 0;
+    p->mlock_pct = 0;
+    p->mlock_mode = MLOCK_HOT;
+    p->cgroup = 0;
+    p->cgroup_parent = NULL;
+    p->cg_max_mib = -1;
+    p->cg_high_mib = -1;
+    p->cg_swap_max_mib = -1;
+    p->antag_shape = ANTAG_NONE;
+    p->antag_mib = 0;
+    p->antag_period_sec = 10;
+    p->recover_pct = 10;
+    p->churn_rate = 0;
+    p->churn_kib = 256;
+    p->churn_ops = (1 << CHURN_DONTNEED) | (1 << CHURN_FREE);
+    p->fault_mode = FAULT_NONE;
+    p->fault_kib = 256;
+    p->regions = 0;
+    p->region_mode = REGION_GUARD;
+    p->prefetch_depth = 0;
+    p->prefetch_hint = PFHINT_NONE;
+    p->bufpool = NULL;
+    p->sync_mode = SYNC_NONE;
+    p->sync_ms = 0;
+    p->cow = COW_NONE;
+    p->frag_mib = 0;
+    p->frag_pin_pct = 10;
+    p->frag_unmov_pct = 10;
+    p->grain = 0;
+    p->stream = 0;
+    p->mlp = 0;
+    p->mlp_update = 0;
 #ifdef XALLOC
     p->xalloc_mib = 0;
     p->xalloc_path = "/dev/ram0";
@@ -134,6 +294,9 @@ void set_default_params(parameters* p)
     p->xml_path = NULL;
 #ifdef PMB_NUMA
     p->affy_head = NULL;
+    p->mempolicy = MEMPOL_NONE;
+    p->mempol_nodes = NULL;
+    p->numa_matrix_mib = 0;
 #endif
 }
 
@@ -150,17 +313,92 @@ void print_params(const parameters* p)
     printf("  mapsize_mib  = %d\n", p->mapsize_mib);
     printf("  setsize_mib  = %d\n", p->setsize_mib);
     printf("  initialize   = %d\n", p->init_garbage);
+    if (p->content) {
+	printf("  content      = %0.2fx, %0.1f%% dup, %0.1f%% zero\n", p->content->ratio,
+		p->content->dup_pct, p->content->zero_pct);
+    }
     printf("  shape        = %f\n", p->shape);
     printf("  delay        = %d\n", p->delay);
     printf("  quiet        = %d\n", p->quiet);
     printf("  cold         = %d\n", p->cold);
 #ifdef PMB_THREAD
     printf("  jobs         = %d\n", p->jobs);
+    if (p->procs) printf("  procs        = %d\n", p->procs);
+    printf("  topology     = %s", topology_name(p->topology));
+    if (p->topology == TOPO_MIX) printf(" (%d%% shared)\n", p->mix_pct);
+    else printf("\n");
 #endif
     printf("  offset       = "); if (p->offset < 0) printf("random\n"); else printf("%d\n", p->offset);
     printf("  ratio        = %d%%\n", p->ratio);
     printf("  threshold    = %d\n", p->threshold);
     printf("  wrneedsrd    = %d\n", p->write_needs_read);
+    if (p->backing && p->backing->name) {
+	printf("  backing      = %s\n", p->backing->name);
+    }
+    printf("  shared       = %d\n", p->map_shared);
+    printf("  hugepage     = %s\n", hugepage_mode_name(p->hugepage));
+    printf("  unit         = %d KiB\n", 1 << (p->unit_shift - 10));
+#ifndef _WIN32
+    if (p->backing == &uffd_backing) {
+	printf("  pager_threads= %d\n", p->pager_threads);
+	printf("  resident_mib = %d\n", p->resident_mib);
+    }
+    if (p->cgroup) {
+	printf("  cgroup       = %s (max %d, high %d, swap.max %d MiB. -1 = unset)\n",
+		p->cgroup_parent ? p->cgroup_parent : "root", p->cg_max_mib,
+		p->cg_high_mib, p->cg_swap_max_mib);
+    }
+#endif
+    if (p->mlock_pct) printf("  mlock        = %d%% %s\n", p->mlock_pct, mlock_mode_name(p->mlock_mode));
+    if (p->antag_shape != ANTAG_NONE) {
+	printf("  antagonist   = %s %d MiB every %d sec, recover within %d%%\n",
+		antagonist_shape_name(p->antag_shape), p->antag_mib,
+		p->antag_period_sec, p->recover_pct);
+    }
+#ifndef _WIN32
+    if (p->regions) printf("  regions      = %d %s\n", p->regions, region_mode_name(p->region_mode));
+#endif
+    if (p->grain) printf("  granularity  = %d bytes (%d cache lines)\n", p->grain, p->grain / 64);
+    if (p->stream) printf("  stream       = whole page sweeps\n");
+    if (p->mlp) printf("  mlp          = %d %s per batch\n", p->mlp, p->mlp_update ? "updates" : "loads");
+    if (p->fault_mode != FAULT_NONE) {
+	printf("  fault        = %s", fault_mode_name(p->fault_mode));
+	if (p->fault_mode != FAULT_COLD) printf(" %d KiB per call", p->fault_kib);
+	printf("\n");
+    }
+    if (p->prefetch_depth || p->prefetch_hint != PFHINT_NONE) {
+	printf("  prefetch     = %d draws ahead, hint %s\n", p->prefetch_depth,
+		prefetch_hint_name(p->prefetch_hint));
+    }
+    if (p->sync_ms) {
+	printf("  sync         = %s", sync_mode_name(p->sync_mode));
+	if (p->sync_mode != SYNC_NONE) printf(" every %d ms", p->sync_ms);
+	printf("\n");
+    }
+    if (p->cow != COW_NONE) printf("  cow          = %s\n", cow_side_name(p->cow));
+    if (p->frag_mib) {
+	printf("  fragment     = %d MiB, %d%% pinned, %d%% unmovable\n", p->frag_mib,
+		p->frag_pin_pct, p->frag_unmov_pct);
+    }
+    if (p->bufpool) {
+	printf("  bufpool      = %d MiB over %s, %s, io %s\n", p->bufpool->pool_mib,
+		p->bufpool->path, bufpool_policy_name(p->bufpool->policy),
+		bufpool_io_name(p->bufpool->io));
+    }
+    if (p->churn_rate) {
+	int op;
+	printf("  churn        = %d x %d KiB per sec:", p->churn_rate, p->churn_kib);
+	for (op = 0; op < CHURN_NR_OPS; op++) {
+	    if (p->churn_ops & (1 << op)) printf(" %s", churn_op_name(op));
+	}
+	printf("\n");
+    }
+    printf("  evict        = %s", evict_mode_name(p->evict_mode));
+    if (p->evict_mode != EVICT_NONE) {
+	printf(" %d%% every ", p->evict_pct);
+	if (p->evict_interval_sec) printf("%d sec\n", p->evict_interval_sec);
+	else printf("run\n");
+    } else printf("\n");
     if (p->pattern && p->pattern->name) {
 	printf("  pattern      = %s\n", p->pattern->name);
     }
@@ -182,6 +420,19 @@ void print_params(const parameters* p)
     } else {
 	printf("NULL\n");
     }
+    if (p->mempolicy != MEMPOL_NONE) {
+	printf("  mempolicy    = %s", mempolicy_name(p->mempolicy));
+	if (p->mempol_nodes) {
+	    int node, sep = ':';
+	    for (node = 0; node <= numa_max_node(); node++) {
+		if (!numa_bitmask_isbitset(p->mempol_nodes, node)) continue;
+		printf("%c%d", sep, node);
+		sep = ',';
+	    }
+	}
+	printf("\n");
+    }
+    if (p->numa_matrix_mib) printf("  numa matrix  = %d MiB per cell\n", p->numa_matrix_mib);
 #endif
 }
 
@@ -206,6 +457,14 @@ error_t parse_opt(int key, char* arg, struct argp_state* state)
     case 'i':
     	param->init_garbage = 1;
     	break;
+    case OPT_CONTENT:
+	if (content_setup(arg)) {
+	    printf("bad content profile. RATIO must be >= 1 and DUP_PCT + ZERO_PCT <= 100.\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	param->content = get_content_profile();
+	param->init_garbage = 1;
+	break;
 #ifdef PMB_THREAD
     case 'j':
 #ifdef PMB_NUMA
@@ -288,7 +547,356 @@ error_t parse_opt(int key, char* arg, struct argp_state* state)
 	    param->xml_path = strdup(arg);
     	}
     	break;
+    case 'b':
+	param->backing = get_backing_from_arg(arg);
+	if (!param->backing) {
+	    printf("backing unrecognized or bad backing argument.\n");
+	    param->backing = &anon_backing;
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+    case 'S':
+	param->map_shared = 1;
+	break;
+#ifdef PMB_THREAD
+    case OPT_PROCS:
+	param->procs = (arg ? atoi(arg) : 0);
+	if (param->procs < 1) {
+	    printf("procs must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_TOPOLOGY:
+	if (!arg) break;
+	if (!my_strncmp(arg, "shared", 16)) param->topology = TOPO_SHARED;
+	else if (!my_strncmp(arg, "partition", 16)) param->topology = TOPO_PARTITION;
+	else if (!my_strncmp(arg, "private", 16)) param->topology = TOPO_PRIVATE;
+	else if (!my_strncmp(arg, "mix", 3) && (arg[3] == ':' || arg[3] == 0)) {
+	    param->topology = TOPO_MIX;
+	    if (arg[3] == ':') param->mix_pct = atoi(arg + 4);
+	    if (param->mix_pct < 0 || param->mix_pct > 100) {
+		printf("topology mix percentage out of bounds, must be from 0-100.\n");
+		exit(EXIT_FAILURE);
+	    }
+	} else {
+	    printf("topology unrecognized.\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+#endif
+    case OPT_PAGER_THREADS:
+	param->pager_threads = (arg ? atoi(arg) : 1);
+	if (param->pager_threads < 1) {
+	    printf("pager-threads must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_CGROUP:
+	param->cgroup = 1;
+	param->cgroup_parent = arg;
+	break;
+    case OPT_MEMORY_MAX:
+    case OPT_MEMORY_HIGH:
+    case OPT_SWAP_MAX:
+	if (!arg || atoi(arg) < 0) {
+	    printf("cgroup limits must not be negative.\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (key == OPT_MEMORY_MAX) param->cg_max_mib = atoi(arg);
+	else if (key == OPT_MEMORY_HIGH) param->cg_high_mib = atoi(arg);
+	else param->cg_swap_max_mib = atoi(arg);
+	param->cgroup = 1;
+	break;
+    case OPT_REGIONS:
+	if (!arg) break;
+	param->regions = atoi(arg);
+	if (param->regions < 1) {
+	    printf("number of regions must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (strchr(arg, ':')) {
+	    const char* mode = strchr(arg, ':') + 1;
+	    if (!my_strncmp(mode, "guard", 16)) param->region_mode = REGION_GUARD;
+	    else if (!my_strncmp(mode, "prot", 16)) param->region_mode = REGION_PROT;
+	    else {
+		printf("region mode unrecognized. must be guard or prot\n");
+		return ARGP_ERR_UNKNOWN;
+	    }
+	}
+	break;
+    case OPT_FAULT:
+	if (!arg) break;
+	for (param->fault_mode = FAULT_COLD; param->fault_mode <= FAULT_POPULATE_WRITE; param->fault_mode++) {
+	    size_t len = strlen(fault_mode_name(param->fault_mode));
+	    if (!strncmp(arg, fault_mode_name(param->fault_mode), len) &&
+		    (arg[len] == ':' || arg[len] == 0)) break;
+	}
+	if (param->fault_mode > FAULT_POPULATE_WRITE) {
+	    printf("fault mode unrecognized. must be cold, populate, populate-read or populate-write\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	if (strchr(arg, ':')) param->fault_kib = atoi(strchr(arg, ':') + 1);
+	if (param->fault_kib < 1) {
+	    printf("fault range must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_BUFPOOL:
+	if (bufpool_setup(arg)) {
+	    printf("bad buffer pool. must be MIB:PATH[:clock|lru[:pread|uring]]\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	param->bufpool = get_bufpool_config();
+	break;
+    case OPT_RESIDENT:
+	param->resident_mib = (arg ? atoi(arg) : 0);
+	if (param->resident_mib < 0) {
+	    printf("resident limit must not be negative.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case 'H':
+	param->hugepage = get_hugepage_mode_from_name(arg);
+	if (param->hugepage < 0) {
+	    printf("hugepage mode unrecognized.\n");
+	    param->hugepage = HUGEPAGE_DEFAULT;
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+    case 'u':
+	if (!arg) break;
+	if (!my_strncmp(arg, "base", 16)) param->unit_huge = 0;
+	else if (!my_strncmp(arg, "huge", 16)) param->unit_huge = 1;
+	else {
+	    printf("unit unrecognized. must be base or huge\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    case 'E':
+	if (!arg) break;
+	for (param->evict_mode = EVICT_PAGEOUT; param->evict_mode <= EVICT_COLD; param->evict_mode++) {
+	    size_t len = strlen(evict_mode_name(param->evict_mode));
+	    if (!strncmp(arg, evict_mode_name(param->evict_mode), len) &&
+		    (arg[len] == ':' || arg[len] == 0)) break;
+	}
+	if (param->evict_mode > EVICT_COLD) {
+	    printf("evict mode unrecognized. must be pageout or cold\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	if (strchr(arg, ':')) param->evict_pct = atoi(strchr(arg, ':') + 1);
+	if (param->evict_pct < 1 || param->evict_pct > 100) {
+	    printf("evict percentage out of bounds, must be from 1-100.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_MLOCK:
+	if (!arg) break;
+	param->mlock_pct = atoi(arg);
+	if (param->mlock_pct < 1 || param->mlock_pct > 100) {
+	    printf("mlock percentage out of bounds, must be from 1-100.\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (strchr(arg, ':')) {
+	    const char* mode = strchr(arg, ':') + 1;
+	    if (!my_strncmp(mode, "hot", 16)) param->mlock_mode = MLOCK_HOT;
+	    else if (!my_strncmp(mode, "range", 16)) param->mlock_mode = MLOCK_RANGE;
+	    else {
+		printf("mlock mode unrecognized. must be hot or range\n");
+		return ARGP_ERR_UNKNOWN;
+	    }
+	}
+	break;
+    case OPT_ANTAGONIST:
+	if (!arg) break;
+	if (!my_strncmp(arg, "square:", 7)) param->antag_shape = ANTAG_SQUARE;
+	else if (!my_strncmp(arg, "ramp:", 5)) param->antag_shape = ANTAG_RAMP;
+	else if (!my_strncmp(arg, "spike:", 6)) param->antag_shape = ANTAG_SPIKE;
+	else {
+	    printf("antagonist shape unrecognized. must be square, ramp or spike with :MIB\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	arg = strchr(arg, ':') + 1;
+	param->antag_mib = atoi(arg);
+	if (strchr(arg, ':')) param->antag_period_sec = atoi(strchr(arg, ':') + 1);
+	if (param->antag_mib < 1 || param->antag_period_sec < 1) {
+	    printf("antagonist footprint and cycle must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_RECOVER:
+	param->recover_pct = (arg ? atoi(arg) : 10);
+	if (param->recover_pct < 0) {
+	    printf("recover percentage must not be negative.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_SYNC:
+	if (!arg) break;
+	for (param->sync_mode = SYNC_NONE; param->sync_mode <= SYNC_FDATASYNC; param->sync_mode++) {
+	    size_t len = strlen(sync_mode_name(param->sync_mode));
+	    if (!strncmp(arg, sync_mode_name(param->sync_mode), len) &&
+		    (arg[len] == ':' || arg[len] == 0)) break;
+	}
+	if (param->sync_mode > SYNC_FDATASYNC) {
+	    printf("sync mode unrecognized. must be none, msync or fdatasync\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	param->sync_ms = (strchr(arg, ':') ? atoi(strchr(arg, ':') + 1) : 1000);
+	if (param->sync_ms < 1) {
+	    printf("sync period must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_GRANULARITY:
+	if (!arg) break;
+	if (!my_strncmp(arg, "word", 16)) param->grain = 0;
+	else if (!my_strncmp(arg, "page", 16)) param->grain = GRAIN_PAGE;
+	else if (!strncmp(arg, "lines:", 6) && atoi(arg + 6) > 0) param->grain = atoi(arg + 6) * 64;
+	else {
+	    printf("granularity unrecognized. must be word, lines:N or page\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+    case OPT_STREAM:
+	param->stream = 1;
+	break;
+    case OPT_MLP:
+	if (!arg) break;
+	param->mlp = atoi(arg);
+	if (strchr(arg, ':')) {
+	    const char* mode = strchr(arg, ':') + 1;
+	    if (!my_strncmp(mode, "update", 16)) param->mlp_update = 1;
+	    else if (my_strncmp(mode, "load", 16)) {
+		printf("mlp mode unrecognized. must be load or update\n");
+		return ARGP_ERR_UNKNOWN;
+	    }
+	}
+	if (param->mlp < 1 || param->mlp > MLP_MAX) {
+	    printf("mlp batch size out of bounds, must be from 1-%d.\n", MLP_MAX);
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_FRAGMENT:
+	if (!arg) break;
+	param->frag_mib = atoi(arg);
+	if (strchr(arg, ':')) {
+	    arg = strchr(arg, ':') + 1;
+	    param->frag_pin_pct = atoi(arg);
+	    if (strchr(arg, ':')) param->frag_unmov_pct = atoi(strchr(arg, ':') + 1);
+	}
+	if (param->frag_mib < 1 || param->frag_pin_pct < 0 || param->frag_unmov_pct < 0 ||
+		param->frag_pin_pct + param->frag_unmov_pct > 100) {
+	    printf("fragment region must be positive, and the refilled percentages within 100.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_COW:
+	if (!arg) break;
+	for (param->cow = COW_PARENT; param->cow <= COW_BOTH; param->cow++) {
+	    if (!my_strncmp(arg, cow_side_name(param->cow), 16)) break;
+	}
+	if (param->cow > COW_BOTH) {
+	    printf("cow side unrecognized. must be parent, child or both\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	break;
+    case OPT_PREFETCH:
+	if (!arg) break;
+	param->prefetch_depth = atoi(arg);
+	if (param->prefetch_depth < 0) {
+	    printf("prefetch depth must not be negative.\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (strchr(arg, ':')) {
+	    const char* hint = strchr(arg, ':') + 1;
+	    for (param->prefetch_hint = PFHINT_NORMAL; param->prefetch_hint <= PFHINT_SEQUENTIAL;
+		    param->prefetch_hint++) {
+		if (!my_strncmp(hint, prefetch_hint_name(param->prefetch_hint), 16)) break;
+	    }
+	    if (param->prefetch_hint > PFHINT_SEQUENTIAL) {
+		printf("prefetch hint unrecognized. must be normal, random or sequential\n");
+		return ARGP_ERR_UNKNOWN;
+	    }
+	} else if (param->prefetch_depth == 0) {
+	    printf("prefetch needs a depth or a hint.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_CHURN:
+	if (!arg) break;
+	param->churn_rate = atoi(arg);
+	if (strchr(arg, ':')) param->churn_kib = atoi(strchr(arg, ':') + 1);
+	if (param->churn_rate < 1 || param->churn_kib < 1) {
+	    printf("churn rate and range size must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_CHURN_OPS:
+	if (!arg) break;
+	param->churn_ops = 0;
+	for (;;) {
+	    int op;
+	    for (op = 0; op < CHURN_NR_OPS; op++) {
+		size_t len = strlen(churn_op_name(op));
+		if (!strncmp(arg, churn_op_name(op), len) && (arg[len] == ',' || arg[len] == 0)) break;
+	    }
+	    if (op == CHURN_NR_OPS) {
+		printf("churn operation unrecognized. must be dontneed, free, remap, mremap or mprotect\n");
+		return ARGP_ERR_UNKNOWN;
+	    }
+	    param->churn_ops |= 1 << op;
+	    if (!strchr(arg, ',')) break;
+	    arg = strchr(arg, ',') + 1;
+	}
+	break;
+    case OPT_EVICT_INTERVAL:
+	param->evict_interval_sec = (arg ? atoi(arg) : 0);
+	if (param->evict_interval_sec < 0) {
+	    printf("evict interval must not be negative.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+#endif
 #ifdef PMB_NUMA
+    case OPT_MEMPOLICY:
+	if (!arg) break;
+	for (param->mempolicy = MEMPOL_INTERLEAVE; param->mempolicy <= MEMPOL_REMOTE; param->mempolicy++) {
+	    size_t len = strlen(mempolicy_name(param->mempolicy));
+	    if (!strncmp(arg, mempolicy_name(param->mempolicy), len) &&
+		    (arg[len] == ':' || arg[len] == 0)) break;
+	}
+	if (param->mempolicy > MEMPOL_REMOTE) {
+	    printf("memory policy unrecognized. must be interleave, preferred, local or remote\n");
+	    return ARGP_ERR_UNKNOWN;
+	}
+	if (strchr(arg, ':')) {
+	    param->mempol_nodes = numa_parse_nodestring(strchr(arg, ':') + 1);
+	    if (!param->mempol_nodes) {
+		printf("memory policy node list syntax error.\n");
+		exit(EXIT_FAILURE);
+	    }
+	}
+	if (param->mempolicy == MEMPOL_LOCAL && param->mempol_nodes) {
+	    printf("local memory policy takes no nodes.\n");
+	    exit(EXIT_FAILURE);
+	}
+	if ((param->mempolicy == MEMPOL_PREFERRED && !param->mempol_nodes) ||
+		((param->mempolicy == MEMPOL_PREFERRED || param->mempolicy == MEMPOL_REMOTE) &&
+		 param->mempol_nodes && numa_bitmask_weight(param->mempol_nodes) != 1)) {
+	    printf("preferred and remote memory policies take a single node.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
+    case OPT_NUMA_MATRIX:
+	/* by default four times the last level cache, and at least 64 MiB */
+	param->numa_matrix_mib = (arg ? atoi(arg) : (int)(sysconf(_SC_LEVEL3_CACHE_SIZE) >> 18));
+	if (!arg && param->numa_matrix_mib < 64) param->numa_matrix_mib = 64;
+	if (param->numa_matrix_mib < 1) {
+	    printf("numa matrix buffer must be positive.\n");
+	    exit(EXIT_FAILURE);
+	}
+	break;
     case 'y':
 	if (saw_jobs) {
 	    printf("jobs parameter shouldn't be specified if using affinityset\n");
@@ -353,36 +961,404 @@ int params_parsing(int argc, char** argv)
 	printf("invalid parameter combination: mapsize < setsize\n");
 	exit(EXIT_FAILURE);
     }
-#ifdef PMB_THREAD
-    if (params.jobs < 1) {
-	printf("invalid parameter combination: jobs less than zero\n");
+#ifndef _WIN32
+    /* memfd is always mapped shared */
+    if (params.backing == &memfd_backing) params.map_shared = 1;
+#endif
+    if (params.hugepage >= HUGEPAGE_HUGETLB_2M) {
+	int huge_mib = 1 << (hugepage_shift(params.hugepage) - 20);
+	if (params.backing != &anon_backing
+#ifndef _WIN32
+		&& params.backing != &memfd_backing
+#endif
+		) {
+	    printf("invalid parameter combination: hugetlb needs anon or memfd backing\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.mapsize_mib % huge_mib) {
+	    printf("invalid parameter: mapsize must be multiple of %d MiB\n", huge_mib);
+	    exit(EXIT_FAILURE);
+	}
+    }
+    if (params.unit_huge) {
+	params.unit_shift = hugepage_shift(params.hugepage);
+	if (((uint64_t)params.setsize_mib << 20) >> params.unit_shift == 0) {
+	    printf("invalid parameter: setsize smaller than a huge page\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+#ifndef _WIN32
+    if (params.backing == &uffd_backing) {
+	if (params.map_shared || params.hugepage != HUGEPAGE_DEFAULT || params.unit_huge) {
+	    printf("invalid parameter combination: uffd backing is private and base pages only\n");
+	    exit(EXIT_FAILURE);
+	}
+    } else if (params.resident_mib) {
+	printf("invalid parameter combination: resident needs uffd backing\n");
+	exit(EXIT_FAILURE);
+    }
+#endif
+    if (params.evict_mode != EVICT_NONE && params.hugepage >= HUGEPAGE_HUGETLB_2M) {
+	printf("invalid parameter combination: hugetlb pages can't be evicted\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.evict_interval_sec && params.evict_mode == EVICT_NONE) {
+	printf("invalid parameter combination: evict-interval needs evict\n");
 	exit(EXIT_FAILURE);
     }
+    if (params.mlock_pct) {
+#ifndef _WIN32
+	if (params.backing == &uffd_backing) {
+	    printf("invalid parameter combination: mlock can't be used with uffd backing\n");
+	    exit(EXIT_FAILURE);
+	}
 #endif
+	access_class_add("locked");
+	access_class_add("unlocked");
+    }
+    /* writes keep the pages on the content profile */
+    if (params.content) access_write_value = content_word;
+#ifndef _WIN32
+    if (params.fault_mode != FAULT_NONE) {
+	if (params.init_garbage || params.mlock_pct || params.evict_mode != EVICT_NONE ||
+		params.churn_rate || params.antag_shape != ANTAG_NONE) {
+	    printf("invalid parameter combination: fault needs a fresh map. "
+		    "no initialize, content, mlock, evict, churn or antagonist\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode == FAULT_POPULATE &&
+		(params.backing != &anon_backing || params.map_shared)) {
+	    printf("invalid parameter combination: populate fault mode needs a private anon map\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* MAP_POPULATE faults in before an madvise could apply */
+	if (params.fault_mode == FAULT_POPULATE &&
+		(params.hugepage == HUGEPAGE_THP || params.hugepage == HUGEPAGE_NOTHP)) {
+	    printf("invalid parameter combination: populate fault mode can't take thp or nothp. "
+		    "use populate-read or populate-write\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* the storm is the run. a warmup would fault the map first */
+	params.cold = 1;
+    }
+    if (params.regions) {
+	if (params.backing != &anon_backing) {
+	    printf("invalid parameter combination: regions need anon backing\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.procs || params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	    printf("invalid parameter combination: regions need one map shared by threads\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode == FAULT_POPULATE) {
+	    printf("invalid parameter combination: populate fault mode would remap the regions\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* these work on address ranges of the map, which guard pages split */
+	if (params.region_mode == REGION_GUARD && (params.mlock_pct ||
+		    params.evict_mode != EVICT_NONE || params.churn_rate)) {
+	    printf("invalid parameter combination: mlock, evict and churn need prot regions\n");
+	    exit(EXIT_FAILURE);
+	}
 #ifdef PMB_NUMA
-    /* set jobs param from threads from affyset*/
-    if (params.affy_head) {
-	int thr_sum = 0;
-	struct affy_node* iter;
-	for (iter = params.affy_head; iter != NULL; iter = iter->next) {
-	    thr_sum += iter->nthreads;
+	if (params.affy_head) {
+	    printf("invalid parameter combination: regions and affinityset are exclusive\n");
+	    exit(EXIT_FAILURE);
 	}
-	params.jobs = thr_sum;
+#endif
     }
-//sys_dump_affinity_set_param();
+    if (params.bufpool) {
+	/* the workers reach the working set through the pool, there is no map */
+	if (params.backing != &anon_backing || params.map_shared || params.regions ||
+		params.hugepage != HUGEPAGE_DEFAULT || params.unit_huge) {
+	    printf("invalid parameter combination: bufpool replaces the map. "
+		    "no backing, shared, hugepage, unit or regions\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.init_garbage || params.mlock_pct || params.evict_mode != EVICT_NONE ||
+		params.churn_rate || params.prefetch_depth || params.prefetch_hint != PFHINT_NONE ||
+		params.fault_mode != FAULT_NONE) {
+	    printf("invalid parameter combination: bufpool fills its own file. "
+		    "no initialize, content, mlock, evict, churn, prefetch or fault\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.procs || params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	    printf("invalid parameter combination: bufpool needs threads sharing the pool\n");
+	    exit(EXIT_FAILURE);
+	}
+#ifdef PMB_NUMA
+	if (params.affy_head) {
+	    printf("invalid parameter combination: bufpool and affinityset are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
 #endif
-    return 0;
-}
-
-/*
- * logging - thread safe. N.B. it only makes individual prn call atomic.
- * mingw32 seems to be breaking printf thread atomicity in Windows...
- */
-#ifdef PMB_THREAD
-pthread_mutex_t lock_prn = PTHREAD_MUTEX_INITIALIZER;
-#define prn_lock() pthread_mutex_lock(&lock_prn)
-#define prn_unlock() pthread_mutex_unlock(&lock_prn)
-#else
+	access_class_add("pool-hit");
+	access_class_add("pool-miss");
+    }
+    if (params.backing == &persist_backing) {
+	if (params.procs || params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	    printf("invalid parameter combination: persist needs threads sharing one map\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.hugepage == HUGEPAGE_HUGETLB_2M || params.hugepage == HUGEPAGE_HUGETLB_1G) {
+	    printf("invalid parameter combination: put the persist object on hugetlbfs instead\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode != FAULT_NONE) {
+	    printf("invalid parameter combination: fault needs a fresh map, not persist\n");
+	    exit(EXIT_FAILURE);
+	}
+	params.map_shared = 1;
+    }
+#endif
+#ifdef PMB_NUMA
+    if (params.affy_head && params.backing != &anon_backing) {
+	printf("invalid parameter combination: affinityset only supports anon backing\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.mempolicy != MEMPOL_NONE && numa_available() < 0) {
+	printf("numa is not available on this system\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.mempolicy != MEMPOL_NONE) {
+	if (params.affy_head) {
+	    printf("invalid parameter combination: mempolicy and affinityset are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.backing != &anon_backing || params.regions || params.bufpool ||
+		params.procs || params.topology != TOPO_SHARED) {
+	    printf("invalid parameter combination: mempolicy needs one anon map shared by worker threads\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* remote defaults to the node farthest from the one we start on */
+	if (params.mempolicy == MEMPOL_REMOTE && !params.mempol_nodes) {
+	    params.mempol_nodes = numa_allocate_nodemask();
+	    numa_bitmask_setbit(params.mempol_nodes,
+		    sys_numa_farthest_node(numa_node_of_cpu(sched_getcpu())));
+	}
+    }
+#endif
+#ifdef PMB_THREAD
+    if (params.jobs < 1) {
+	printf("invalid parameter combination: jobs less than zero\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.evict_mode != EVICT_NONE &&
+	    (params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX)) {
+	printf("invalid parameter combination: evict covers one shared map, not private or mix\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.procs) {
+	if (params.jobs > 1) {
+	    printf("invalid parameter combination: jobs and procs are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.evict_mode != EVICT_NONE) {
+	    printf("invalid parameter combination: evict is not supported with procs\n");
+	    exit(EXIT_FAILURE);
+	}
+#ifdef PMB_NUMA
+	if (params.affy_head) {
+	    printf("invalid parameter combination: affinityset and procs are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+#endif
+	if (params.topology != TOPO_SHARED) {
+	    printf("invalid parameter combination: topology needs jobs, not procs\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* one worker per process. the rest of the code sees them as jobs */
+	params.jobs = params.procs;
+    }
+    if (params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	if (params.backing != &anon_backing) {
+	    printf("invalid parameter combination: private maps need anon backing\n");
+	    exit(EXIT_FAILURE);
+	}
+#ifdef PMB_NUMA
+	if (params.affy_head) {
+	    printf("invalid parameter combination: affinityset needs shared topology\n");
+	    exit(EXIT_FAILURE);
+	}
+#endif
+    }
+    if (params.topology == TOPO_PARTITION &&
+	    ((((uint64_t)params.setsize_mib << 20) >> params.unit_shift) / params.jobs) == 0) {
+	printf("invalid parameter: setsize too small to partition among jobs\n");
+	exit(EXIT_FAILURE);
+    }
+    if (params.topology == TOPO_MIX) {
+	access_class_add("shared");
+	access_class_add("private");
+    }
+#ifndef _WIN32
+    if (params.prefetch_depth) {
+	if (params.topology == TOPO_MIX) {
+	    printf("invalid parameter combination: prefetch follows one pattern, not mix\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode != FAULT_NONE) {
+	    printf("invalid parameter combination: prefetch needs the timed run, not fault\n");
+	    exit(EXIT_FAILURE);
+	}
+	access_class_add("pf-on");
+	access_class_add("pf-off");
+    }
+    if (params.churn_rate) {
+	if (params.backing != &anon_backing || params.map_shared) {
+	    printf("invalid parameter combination: churn needs a private anon map\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.procs || params.topology == TOPO_PRIVATE) {
+	    printf("invalid parameter combination: churn needs threads sharing the map\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.mlock_pct) {
+	    printf("invalid parameter combination: churn and mlock are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.hugepage == HUGEPAGE_HUGETLB_2M || params.hugepage == HUGEPAGE_HUGETLB_1G) {
+	    printf("invalid parameter combination: churn doesn't support hugetlb maps\n");
+	    exit(EXIT_FAILURE);
+	}
+#ifdef PMB_NUMA
+	if (params.affy_head) {
+	    printf("invalid parameter combination: churn and affinityset are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+#endif
+	if ((params.churn_ops & (1 << CHURN_MPROTECT)) && params.regions) {
+	    printf("invalid parameter combination: the mprotect churn op would undo the regions\n");
+	    exit(EXIT_FAILURE);
+	}
+	access_class_add("refault");
+	access_class_add("steady");
+	access_class_add("overlap");
+	access_class_add("quiet");
+    }
+    if (params.sync_ms) {
+	if (params.backing != &file_backing || !params.map_shared) {
+	    printf("invalid parameter combination: sync needs a shared file map (-b file:PATH -S)\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.procs || params.topology == TOPO_PRIVATE) {
+	    printf("invalid parameter combination: sync needs threads sharing the map\n");
+	    exit(EXIT_FAILURE);
+	}
+	access_class_add("throttled");
+	access_class_add("stalled");
+	access_class_add("running");
+    }
+    if (params.cow != COW_NONE) {
+	if (params.backing != &anon_backing || params.map_shared || params.regions || params.bufpool ||
+		params.hugepage == HUGEPAGE_HUGETLB_2M || params.hugepage == HUGEPAGE_HUGETLB_1G) {
+	    printf("invalid parameter combination: cow needs one private anon map. "
+		    "no shared, hugetlb, regions or bufpool\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.procs || params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	    printf("invalid parameter combination: cow needs threads sharing the map\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode != FAULT_NONE) {
+	    printf("invalid parameter combination: cow needs the timed run, not fault\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* the child has worker 1 and nothing else */
+	if (params.cow != COW_PARENT && (params.prefetch_depth || params.churn_rate)) {
+	    printf("invalid parameter combination: the cow child can't have prefetch or churn\n");
+	    exit(EXIT_FAILURE);
+	}
+#ifdef PMB_NUMA
+	if (params.affy_head) {
+	    printf("invalid parameter combination: cow and affinityset are exclusive\n");
+	    exit(EXIT_FAILURE);
+	}
+#endif
+	access_class_add("cow-break");
+	access_class_add("ordinary");
+    }
+#endif
+#endif
+#ifndef _WIN32
+    if (params.stream) {
+	if (params.grain && params.grain != GRAIN_PAGE) {
+	    printf("invalid parameter combination: stream accesses whole pages\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.fault_mode != FAULT_NONE || params.bufpool || params.topology == TOPO_MIX ||
+		params.mlock_pct || params.churn_rate || params.prefetch_depth ||
+		params.prefetch_hint != PFHINT_NONE || params.sync_ms || params.cow != COW_NONE) {
+	    printf("invalid parameter combination: stream replaces the timed loop. "
+		    "no fault, bufpool, mix, mlock, churn, prefetch, sync or cow\n");
+	    exit(EXIT_FAILURE);
+	}
+	params.grain = GRAIN_PAGE;
+	access_class_add("resident");
+	access_class_add("non-resident");
+    }
+#endif
+    if (params.mlp) {
+	if (params.stream || params.fault_mode != FAULT_NONE || params.bufpool ||
+		params.topology == TOPO_MIX || params.mlock_pct || params.churn_rate ||
+		params.prefetch_depth || params.prefetch_hint != PFHINT_NONE || params.sync_ms ||
+		params.cow != COW_NONE || params.evict_mode != EVICT_NONE ||
+		params.antag_shape != ANTAG_NONE) {
+	    printf("invalid parameter combination: mlp replaces the timed loop. "
+		    "no stream, fault, bufpool, mix, mlock, churn, prefetch, sync, cow, "
+		    "evict or antagonist\n");
+	    exit(EXIT_FAILURE);
+	}
+	/* a batch is timed as a group, so per access options have nothing to act on */
+	if (params.threshold || params.delay || params.write_needs_read) {
+	    printf("invalid parameter combination: mlp times whole batches. "
+		    "no threshold, delay or wrneedsrd\n");
+	    exit(EXIT_FAILURE);
+	}
+	if (params.grain) {
+	    printf("invalid parameter combination: mlp batches word accesses\n");
+	    exit(EXIT_FAILURE);
+	}
+    }
+    /* spans are cache line aligned and stay within a base page */
+    if (params.grain) {
+#ifdef _WIN32
+	const int pgsz = PAGE_SIZE;
+#else
+	const int pgsz = (int)sysconf(_SC_PAGESIZE);
+#endif
+	if (params.grain == GRAIN_PAGE) params.grain = pgsz;
+	if (params.grain > pgsz) {
+	    printf("granularity is larger than a page (%d bytes)\n", pgsz);
+	    exit(EXIT_FAILURE);
+	}
+	access_span = params.grain;
+	access_page_size = pgsz;
+    }
+#ifdef PMB_NUMA
+    /* set jobs param from threads from affyset*/
+    if (params.affy_head) {
+	int thr_sum = 0;
+	struct affy_node* iter;
+	for (iter = params.affy_head; iter != NULL; iter = iter->next) {
+	    thr_sum += iter->nthreads;
+	}
+	params.jobs = thr_sum;
+    }
+//sys_dump_affinity_set_param();
+#endif
+    return 0;
+}
+
+/*
+ * logging - thread safe. N.B. it only makes individual prn call atomic.
+ * mingw32 seems to be breaking printf thread atomicity in Windows...
+ */
+#ifdef PMB_THREAD
+pthread_mutex_t lock_prn = PTHREAD_MUTEX_INITIALIZER;
+#define prn_lock() pthread_mutex_lock(&lock_prn)
+#define prn_unlock() pthread_mutex_unlock(&lock_prn)
+#else
 #define prn_lock(_l_) do {;} while(0)
 #define prn_unlock(_l_) do {;} while(0)
 #endif
@@ -419,6 +1395,9 @@ struct thread_info {
 #endif
     int thread_num;	    	// local thread number (1, 2, 3,...)
     char *map;			// memory map base pointer for access
+    char *pmap;			// private map with TOPO_MIX
+    int init_index;		// slice of map this thread initializes,
+    int init_count;		// out of init_count threads sharing the map
     struct bench_result result;	// per-thread result
 };
 
@@ -428,7 +1407,7 @@ struct thread_control {
     char *stats;		// histograms base pointer
     int interrupted;		// ctrl-c sets this
 #ifdef PMB_THREAD
-    pthread_barrier_t barrier;	// barrier for mt
+    pthread_barrier_t* barrier;	// barrier for mt. process-shared for mp
 #endif
 } control;
  
@@ -462,6 +1441,167 @@ void print_result(void)
    }
 }
 
+/*
+ * map initialization throughput in MiB/s of worker @jobid.
+ * with jobid -1, total bytes over the slowest worker's time
+ */
+double get_init_throughput(int jobid)
+{
+    uint64_t bytes = 0, clk = 0;
+    int i;
+
+    for (i = 0; i < params.jobs; i++) {
+	if (jobid >= 0 && i != jobid) continue;
+	bytes += get_result(i)->total_init_bytes;
+	if (get_result(i)->total_init_clock > clk) clk = get_result(i)->total_init_clock;
+    }
+    if (clk == 0) return 0.0;
+    return (double)bytes / (1 << 20) / ((double)clk / freq_khz / 1000);
+}
+
+double get_stream_throughput(int jobid)
+{
+    uint64_t bytes = 0, clk = 0;
+    int i;
+
+    for (i = 0; i < params.jobs; i++) {
+	if (jobid >= 0 && i != jobid) continue;
+	bytes += get_result(i)->total_stream_bytes[0] + get_result(i)->total_stream_bytes[1];
+	if (get_result(i)->total_bench_clock > clk) clk = get_result(i)->total_bench_clock;
+    }
+    if (clk == 0) return 0.0;
+    return (double)bytes / (1 << 20) / ((double)clk / freq_khz / 1000);
+}
+
+double get_mlp_rate(int jobid)
+{
+    uint64_t count = 0, clk = 0;
+    int i;
+
+    for (i = 0; i < params.jobs; i++) {
+	if (jobid >= 0 && i != jobid) continue;
+	count += get_result(i)->total_bench_count;
+	if (get_result(i)->total_bench_clock > clk) clk = get_result(i)->total_bench_clock;
+    }
+    if (clk == 0) return 0.0;
+    return (double)count / ((double)clk / freq_khz / 1000);
+}
+
+double get_fault_rate(int jobid)
+{
+    uint64_t faults = 0, clk = 0;
+    int i;
+
+    for (i = 0; i < params.jobs; i++) {
+	if (jobid >= 0 && i != jobid) continue;
+	faults += get_result(i)->total_bench_count;
+	if (get_result(i)->total_bench_clock > clk) clk = get_result(i)->total_bench_clock;
+    }
+    if (clk == 0) return 0.0;
+    return (double)faults / ((double)clk / freq_khz / 1000);
+}
+
+/*
+ * Many-VMA map (--regions). The map is made of separately mmapped regions
+ * of the same size, kept from merging by a guard page between them or by
+ * alternating protections. The table holds each region's address, so
+ * calc_address() and the range walkers translate offsets of the map.
+ */
+struct region_map {
+    char* base;		// the map as the rest of the code knows it. region 0
+    char** table;	// NULL without regions
+    size_t count;	// number of regions
+    size_t units;	// pattern units per region
+    size_t bytes;	// bytes per region
+    size_t span;	// size of the reservation holding all regions
+};
+
+static struct region_map region_map;
+
+/* true if the map is made of shmem pages (memfd or shared anonymous) */
+int map_is_shmem(const parameters* p)
+{
+#ifndef _WIN32
+    if (p->backing == &memfd_backing) return 1;
+#endif
+    return (p->backing == &anon_backing && p->map_shared);
+}
+
+/* smaps of the map around the main run. fields are -1 if not sampled */
+struct map_sample map_sample_before_run = { -1, -1, -1 };
+struct map_sample map_sample_after_run = { -1, -1, -1 };
+
+static
+int map_sample_needed(void)
+{
+    /* smaps is sampled for the map's vma, which is only one region */
+    if (params.regions) return 0;
+    return params.hugepage != HUGEPAGE_DEFAULT || params.unit_huge ||
+	map_is_shmem(&params);
+}
+
+#ifndef _WIN32
+static
+int64_t map_huge_kib(const char* buf)
+{
+    int64_t a, b;
+
+    if (params.hugepage >= HUGEPAGE_HUGETLB_2M) {
+	a = sys_smaps_get(buf, "Private_Hugetlb:");
+	b = sys_smaps_get(buf, "Shared_Hugetlb:");
+	return (a < 0 || b < 0) ? -1 : a + b;
+    }
+    if (map_is_shmem(&params)) return sys_smaps_get(buf, "ShmemPmdMapped:");
+    if (params.backing != &anon_backing) return sys_smaps_get(buf, "FilePmdMapped:");
+    return sys_smaps_get(buf, "AnonHugePages:");
+}
+
+static
+void map_sample(const char* buf, struct map_sample* ms)
+{
+    if (!buf) return;
+    ms->huge_kib = map_huge_kib(buf);
+    ms->rss_kib = sys_smaps_get(buf, "Rss:");
+    ms->swap_kib = sys_smaps_get(buf, "Swap:");
+}
+#else
+static
+void map_sample(const char* buf, struct map_sample* ms)
+{
+    return;
+}
+#endif
+
+static
+void print_map_kib(const char* tag, int64_t kib)
+{
+    int64_t map_kib = (int64_t)params.mapsize_mib << 10;
+
+    if (kib < 0) return;
+    printf("%s: %"PRId64" KiB of %"PRId64" KiB map (%0.2f%%)\n", tag,
+	    kib, map_kib, 100.0 * kib / map_kib);
+}
+
+static
+__attribute__((cold))
+void print_access_class_summary(char* stats)
+{
+    struct histogram_summary hs;
+    int c, w;
+
+    printf("# Access latency by class (estimated from histogram bins)\n");
+    printf("%-10s %5s %12s %12s %12s %12s\n", "class", "type", "samples", "mean(ns)", "p50(ns)", "p99(ns)");
+    for (c = 0; c <= num_access_class; c++) {
+	for (w = 0; w < 2; w++) {
+	    if ((w == 0 && params.ratio == 0) || (w == 1 && params.ratio == 100)) continue;
+	    get_histogram_summary(access_class_plane(stats, c), w, &hs);
+	    printf("%-10s %5s %12"PRIu64" %12.0f %12.0f %12.0f\n", access_class_name[c],
+		    w ? "write" : "read", hs.count, hs.mean_ns, hs.p50_ns, hs.p99_ns);
+	}
+    }
+    printf("\n");
+}
+
 sys_mem_item mem_info_before_warmup;// stores mem info right before warmup/exercise
 sys_mem_item mem_info_before_run;   // stores mem info before exercise, after warmup
 sys_mem_item mem_info_middle_run;   // stores mem info at the halfway of exercise
@@ -533,48 +1673,498 @@ print_con_report(char* buf, const parameters* p)
     //result
     printf("\n----------- Average access latency ------------\n");
     print_result();
-    
-    //statistics
-    printf("\n----------------- Statistics ------------------\n");
-    p->access->report(buf, p->ratio);
-    
-    //sys_mem_info
-    printf("\n---------- System memory information ----------\n");
-    sys_stat_mem_print_header();
-    if (params.cold) {
-	printf("pre-run   :"); sys_stat_mem_print(&mem_info_before_warmup);//1
-	printf("  (delta) :");
-	if (mem_info_middle_run.recorded) {
-	    sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_middle_run);//2
-	    printf("mid-run   :"); sys_stat_mem_print(&mem_info_middle_run);	//3
-	    printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_middle_run, &mem_info_after_run);	//4
+
+    //init
+    if (p->init_garbage) {
+	int i;
+	printf("\n---------- Initialization throughput ----------\n");
+	printf("aggregate      : %0.1f MiB/s\n", get_init_throughput(-1));
+	for (i = 0; i < p->jobs; i++) {
+	    printf("thread %-7d : %0.1f MiB/s (%"PRIu64" MiB)\n", i + 1,
+		    get_init_throughput(i), get_result(i)->total_init_bytes >> 20);
 	}
-	else sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_after_run); //5
-    } else {
-	printf("pre-warmup:"); sys_stat_mem_print(&mem_info_before_warmup);//6
-	printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_before_run);	//7
-	printf("pre-run   :"); sys_stat_mem_print(&mem_info_before_run);	//8
-	printf("  (delta) :");
-	if (mem_info_middle_run.recorded) {
-	    sys_stat_mem_print_delta(&mem_info_before_run, &mem_info_middle_run);//9
-	    printf("mid-run   :"); sys_stat_mem_print(&mem_info_middle_run);	//10
-	    printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_middle_run, &mem_info_after_run);	//11
+    }
+    
+#ifndef _WIN32
+    //fault storm
+    if (p->fault_mode != FAULT_NONE) {
+	int i;
+	uint64_t failures = 0;
+
+	printf("\n------------- Fault storm information ---------\n");
+	printf("mode           : %s", fault_mode_name(p->fault_mode));
+	if (p->fault_mode != FAULT_COLD) printf(", %d KiB per call", p->fault_kib);
+	printf("\n");
+	for (i = 0; i < p->jobs; i++) failures += get_result(i)->fault_failures;
+	printf("aggregate      : %0.0f faults/s with %d workers (%"PRIu64" failed calls)\n",
+		get_fault_rate(-1), p->jobs, failures);
+	for (i = 0; i < p->jobs; i++) {
+	    printf("thread %-7d : %0.0f faults/s (%"PRIu64" pages)\n", i + 1,
+		    get_fault_rate(i), get_result(i)->total_bench_count);
 	}
-	else sys_stat_mem_print_delta(&mem_info_before_run, &mem_info_after_run);//12
     }
-    printf("post-run  :"); sys_stat_mem_print(&mem_info_after_run);		//13
-}
 
-#define MAX_ALARM 4
-typedef void (*alarm_fn)(uint64_t now, void* param);
+    //streaming
+    if (p->stream) {
+	const long pgsz = sysconf(_SC_PAGESIZE);
+	static const char* stream_class[2] = { "non-resident", "resident" };
+	uint64_t passes = 0, bytes[2] = { 0, 0 }, ns[2] = { 0, 0 };
+	double mean_us[2] = { 0.0, 0.0 };
+	int i, r;
+
+	for (i = 0; i < p->jobs; i++) {
+	    passes += get_result(i)->total_stream_passes;
+	    for (r = 0; r < 2; r++) {
+		bytes[r] += get_result(i)->total_stream_bytes[r];
+		ns[r] += get_result(i)->total_stream_ns[r];
+	    }
+	}
+	printf("\n------------- Streaming information -----------\n");
+	printf("aggregate      : %0.1f MiB/s with %d workers, %"PRIu64" full passes\n",
+		get_stream_throughput(-1), p->jobs, passes);
+	for (r = 1; r >= 0; r--) {
+	    if (!bytes[r]) continue;
+	    mean_us[r] = (double)ns[r] / 1000 / (bytes[r] / pgsz);
+	    printf("%-14s : %"PRIu64" MiB, %0.1f MiB/s while accessing, %0.3f us per page",
+		    stream_class[r], bytes[r] >> 20,
+		    (double)bytes[r] / (1 << 20) / ((double)ns[r] / 1000000000), mean_us[r]);
+	    if (r == 0 && bytes[1]) printf(" (%0.3f us over resident)", mean_us[0] - mean_us[1]);
+	    printf("\n");
+	}
+	for (i = 0; i < p->jobs; i++) {
+	    printf("thread %-7d : %0.1f MiB/s (%"PRIu64" passes)\n", i + 1,
+		    get_stream_throughput(i), get_result(i)->total_stream_passes);
+	}
+    }
+#endif
 
-typedef struct alarm_data {
-    uint64_t time;
-    alarm_fn callback;
-    void* data;		    // user private data
-} alarm_data;
+    //memory level parallelism
+    if (p->mlp) {
+	const struct mlp_result* mr = &mlp_result;
+	uint64_t batches = 0, ns = 0, count = 0;
+	int i;
 
-alarm_data alarms[MAX_ALARM];
+	for (i = 0; i < p->jobs; i++) {
+	    batches += get_result(i)->total_mlp_batches;
+	    ns += get_result(i)->total_mlp_ns;
+	    count += get_result(i)->total_bench_count;
+	}
+	printf("\n------------- MLP information -----------------\n");
+	printf("batch          : %d independent %s\n", p->mlp, p->mlp_update ? "updates" : "loads");
+	if (batches) {
+	    printf("batch latency  : %0.1f ns mean over %"PRIu64" batches (%0.1f ns per access)\n",
+		    (double)ns / batches, batches, (double)ns / count);
+	}
+	printf("aggregate      : %0.3f M accesses/s with %d workers", get_mlp_rate(-1) / 1000000, p->jobs);
+	if (p->mlp_update) printf(", %0.6f GUPS", get_mlp_rate(-1) / 1000000000);
+	printf("\n");
+	if (ns) {
+	    printf("in batches     : %0.3f M accesses/s per worker\n", (double)count * 1000 / ns);
+	}
+	for (i = 0; i < p->jobs; i++) {
+	    printf("thread %-7d : %0.3f M accesses/s (%"PRIu64" batches)\n", i + 1,
+		    get_mlp_rate(i) / 1000000, get_result(i)->total_mlp_batches);
+	}
+	printf("batch size sweep, worker 1 alone for %d ms each:\n", MLP_PROBE_MS);
+	for (i = 0; i < mr->levels; i++) {
+	    printf("K = %-10d : %0.3f M accesses/s, %0.1f ns per batch\n",
+		    mr->k[i], mr->rate[i] / 1000000, mr->batch_ns[i]);
+	}
+	if (mr->saturation_k) {
+	    printf("saturates at   : K = %d (%d%% of the peak)\n", mr->saturation_k, MLP_SATURATE_PCT);
+	}
+    }
+
+    //statistics
+    printf("\n----------------- Statistics ------------------\n");
+    p->access->report(buf, p->ratio);
+    if (num_access_class && p->access == &histogram_access) print_access_class_summary(buf);
+
+    //content
+    if (p->content) {
+	printf("\n------------- Content information -------------\n");
+	content_report();
+    }
+
+    //backing
+    if (p->backing != &anon_backing) {
+	printf("\n------------- Backing information -------------\n");
+	p->backing->report();
+    }
+    
+    //shmem
+    if (map_is_shmem(p)) {
+	printf("\n--------- Shared memory information -----------\n");
+	printf("shmem source   : %s\n", p->backing == &anon_backing ?
+		"MAP_SHARED|MAP_ANONYMOUS" : p->backing->name);
+	print_map_kib("resident (pre-run)         ", map_sample_before_run.rss_kib);
+	print_map_kib("resident (post-run)        ", map_sample_after_run.rss_kib);
+	print_map_kib("ShmemSwapped (pre-run)     ", map_sample_before_run.swap_kib);
+	print_map_kib("ShmemSwapped (post-run)    ", map_sample_after_run.swap_kib);
+    }
+
+    //huge page
+    if (p->hugepage != HUGEPAGE_DEFAULT || p->unit_huge) {
+	printf("\n------------ Huge page information ------------\n");
+	printf("huge page mode : %s (%d KiB pages)\n", hugepage_mode_name(p->hugepage),
+		1 << (hugepage_shift(p->hugepage) - 10));
+	printf("pattern unit   : %d KiB\n", 1 << (p->unit_shift - 10));
+	print_map_kib("huge page backed (pre-run) ", map_sample_before_run.huge_kib);
+	print_map_kib("huge page backed (post-run)", map_sample_after_run.huge_kib);
+    }
+
+#ifndef _WIN32
+    //cgroup sandbox
+    if (sys_cgroup_path()) {
+	printf("\n------------- cgroup sandbox ------------------\n");
+	sys_cgroup_print();
+    }
+
+    //many-VMA map
+    if (p->regions) {
+	const struct region_info* ri = get_region_info();
+
+	printf("\n-------------- Region information -------------\n");
+	printf("regions        : %zu x %zu KiB, %s\n", ri->count, ri->bytes >> 10,
+		region_mode_name(p->region_mode));
+	printf("vmas           : %"PRId64" in the map, %"PRId64" in the process\n",
+		ri->vmas, sys_vma_count(NULL, NULL));
+    }
+
+    //resident floor
+    if (p->mlock_pct) {
+	uint64_t locked = 0;
+	int i, failures = 0;
+
+	for (i = 0; i < p->jobs; i++) {
+	    locked += get_result(i)->total_locked_bytes;
+	    failures += get_result(i)->lock_failures;
+	}
+	printf("\n---------- Resident floor information ---------\n");
+	printf("mlock          : %d%% of the working set, %s units\n", p->mlock_pct,
+		mlock_mode_name(p->mlock_mode));
+	printf("locked         : %"PRIu64" KiB (%d failed mlock calls)\n", locked >> 10, failures);
+    }
+
+    //eviction
+    if (p->evict_mode != EVICT_NONE) {
+	const struct evict_result* ev = &evict_result;
+	const long kib = sysconf(_SC_PAGESIZE) >> 10;
+
+	printf("\n------------- Eviction information ------------\n");
+	printf("evict mode     : %s %d%% ", evict_mode_name(p->evict_mode), p->evict_pct);
+	if (p->evict_interval_sec) printf("every %d sec\n", p->evict_interval_sec);
+	else printf("once before run\n");
+	printf("rounds         : %d (%d failed madvise calls)\n", ev->rounds, ev->failures);
+	printf("advised        : %"PRIu64" KiB total\n", ev->advised_pages * kib);
+	if (ev->rounds) {
+	    printf("time per round : %0.3f ms\n",
+		(double)ev->total_clock / ev->rounds / freq_khz);
+	}
+	if (ev->resident_before >= 0 && ev->resident_after >= 0 && ev->ws_pages) {
+	    printf("ws resident    : %0.2f%% before, %0.2f%% after the first round\n",
+		100.0 * ev->resident_before / ev->ws_pages,
+		100.0 * ev->resident_after / ev->ws_pages);
+	}
+    }
+
+    //pressure antagonist
+    if (p->antag_shape != ANTAG_NONE) {
+	const struct recover_result* rr = &recover_result;
+	int c;
+
+	printf("\n------------- Pressure antagonist -------------\n");
+	printf("antagonist     : %s %d MiB every %d sec (peak %"PRId64" KiB)\n",
+		antagonist_shape_name(p->antag_shape), p->antag_mib, p->antag_period_sec,
+		rr->peak_kib);
+	if (rr->baseline_p99_ns >= 0) {
+	    printf("baseline p99   : %0.0f ns, recovered within %d%%\n",
+		    rr->baseline_p99_ns, p->recover_pct);
+	} else {
+	    printf("baseline p99   : unknown\n");
+	}
+	for (c = 0; c < rr->cycles; c++) {
+	    printf("cycle %-3d      : peak p99 %0.0f ns, ", c + 1, rr->peak_p99_ns[c]);
+	    if (rr->recover_ms[c] >= 0) printf("recovered %"PRId64" ms after release\n", rr->recover_ms[c]);
+	    else printf("not recovered\n");
+	}
+	if (rr->cycles == 0) printf("no pressure cycle completed during the run\n");
+    }
+
+    //dirty writeback
+    if (p->sync_ms) {
+	const struct writeback_result* wr = &writeback_result;
+	int i, peak_dirty = 0, peak_wb = 0;
+	uint32_t next_ms = 0;
+
+	printf("\n------------ Writeback information ------------\n");
+	printf("sync           : %s", sync_mode_name(p->sync_mode));
+	if (p->sync_mode != SYNC_NONE) printf(" every %d ms", p->sync_ms);
+	printf("\n");
+	if (wr->syncs) {
+	    printf("sync time      : %"PRIu64" calls, %0.3f ms avg, %0.3f ms max (%d failed)\n",
+		    wr->syncs, (double)wr->sync_clock / wr->syncs / freq_khz,
+		    (double)wr->sync_clock_max / freq_khz, wr->failures);
+	}
+	if (wr->thresh_kib >= 0) {
+	    printf("dirty limits   : %"PRId64" KiB threshold, %"PRId64" KiB background, "
+		    "throttled from %"PRId64" KiB\n", wr->thresh_kib, wr->bg_thresh_kib,
+		    (wr->thresh_kib + wr->bg_thresh_kib) / 2);
+	}
+	for (i = 0; i < wr->nsamples; i++) {
+	    if (wr->samples[i].dirty_kib > peak_dirty) peak_dirty = wr->samples[i].dirty_kib;
+	    if (wr->samples[i].writeback_kib > peak_wb) peak_wb = wr->samples[i].writeback_kib;
+	}
+	printf("throttling     : %d of %d samples at or above the freerun ceiling\n",
+		wr->throttle_samples, wr->nsamples);
+	printf("peak           : %d KiB dirty, %d KiB writeback\n", peak_dirty, peak_wb);
+	/* the first sample of each second. the xml report has all of them */
+	printf("%9s %12s %12s\n", "time(s)", "Dirty(K)", "Writeback(K)");
+	for (i = 0; i < wr->nsamples; i++) {
+	    if (wr->samples[i].ms < next_ms) continue;
+	    printf("%9.1f %12d %12d\n", wr->samples[i].ms / 1000.0,
+		    wr->samples[i].dirty_kib, wr->samples[i].writeback_kib);
+	    next_ms = (wr->samples[i].ms / 1000 + 1) * 1000;
+	}
+    }
+
+#ifdef PMB_NUMA
+    //memory policy
+    if (p->mempolicy != MEMPOL_NONE) {
+	const struct numa_placement* pl = &numa_placement;
+	int node;
+
+	printf("\n---------- NUMA placement information ---------\n");
+	printf("mempolicy      : %s\n", mempolicy_name(p->mempolicy));
+	for (node = 0; node < pl->nnodes; node++) {
+	    if (!pl->pages[node]) continue;
+	    printf("node %-9d : %"PRId64" pages\n", node, pl->pages[node]);
+	}
+	printf("not present    : %"PRId64" pages\n", pl->absent);
+    }
+
+    //node-to-node latency matrix
+    if (p->numa_matrix_mib) {
+	const struct numa_matrix_result* mr = &numa_matrix_result;
+	int row, col;
+
+	printf("\n---------- NUMA latency matrix ----------------\n");
+	printf("memory access (ns), cpu node by memory node, every line of a %d MiB buffer "
+		"in random order, %d%% THP\n", p->numa_matrix_mib, mr->thp_pct);
+	if (mr->llc_kib > 0 && ((int64_t)p->numa_matrix_mib << 10) < mr->llc_kib * 4) {
+	    printf("N.B. the buffer isn't well over the %"PRId64" KiB last level cache, "
+		    "so part of the loads hit it\n", mr->llc_kib);
+	}
+	if (mr->thp_pct < 100) printf("N.B. page walks add to the loads outside THP\n");
+	printf("%8s", "");
+	for (col = 0; col < mr->nmem_nodes; col++) {
+	    char name[16];
+	    snprintf(name, sizeof(name), "node %d", mr->mem_node[col]);
+	    printf("  %9s", name);
+	}
+	printf("\n");
+	for (row = 0; row < mr->ncpu_nodes; row++) {
+	    printf("node %-3d", mr->cpu_node[row]);
+	    for (col = 0; col < mr->nmem_nodes; col++) {
+		if (mr->mem_ns[row][col] < 0) printf("  %9s", "-");
+		else printf("  %9.1f", mr->mem_ns[row][col]);
+	    }
+	    printf("\n");
+	}
+	printf("swap-in (us), per swapped out page\n");
+	for (row = 0; row < mr->ncpu_nodes; row++) {
+	    printf("node %-3d", mr->cpu_node[row]);
+	    for (col = 0; col < mr->nmem_nodes; col++) {
+		if (mr->swapin_ns[row][col] < 0) printf("  %9s", "-");
+		else printf("  %9.2f", mr->swapin_ns[row][col] / 1000);
+	    }
+	    printf("\n");
+	}
+	printf("node distance\n");
+	for (row = 0; row < mr->ncpu_nodes; row++) {
+	    printf("node %-3d", mr->cpu_node[row]);
+	    for (col = 0; col < mr->nmem_nodes; col++) printf("  %9d", mr->distance[row][col]);
+	    printf("\n");
+	}
+    }
+#endif
+
+#ifndef _WIN32
+    //fragmentation preconditioning
+    if (p->frag_mib) {
+	const struct fragment_result* fr = &fragment_result;
+	const int64_t faults = fr->thp_fault_alloc + fr->thp_fault_fallback;
+
+	printf("\n---------- Fragmentation information ----------\n");
+	printf("region         : %d MiB, every other page freed (%d failed calls)\n",
+		p->frag_mib, fr->failures);
+	printf("kept           : %"PRId64" KiB, refilled %"PRId64" KiB mlocked, "
+		"%"PRId64" KiB unmovable in %d pipes\n", fr->kept_kib, fr->pinned_kib,
+		fr->unmovable_kib, fr->pipes);
+	if (fr->blocks_before >= 0 && fr->blocks_after >= 0) {
+	    printf("free hugepages : %"PRId64" blocks before, %"PRId64" after fragmenting\n",
+		    fr->blocks_before, fr->blocks_after);
+	}
+	printf("THP faults     : %"PRId64" allocated, %"PRId64" fell back", fr->thp_fault_alloc,
+		fr->thp_fault_fallback);
+	if (faults > 0) printf(" (%0.1f%% success)", 100.0 * fr->thp_fault_alloc / faults);
+	printf("\n");
+	printf("compaction     : %"PRId64" stalls, %"PRId64" failed, %"PRId64" succeeded\n",
+		fr->compact_stall, fr->compact_fail, fr->compact_success);
+    }
+
+    //copy-on-write snapshot
+    if (p->cow != COW_NONE) {
+	const struct cow_result* cr = &cow_result;
+	const struct bench_result* presult = &cr->child;
+
+	printf("\n---------- COW snapshot information -----------\n");
+	printf("timed loop     : %s\n", cow_side_name(p->cow));
+	if (cr->pid > 0) {
+	    printf("fork           : %0.3f ms\n", (double)cr->fork_clock / freq_khz);
+	    if (cr->pte_kib >= 0) printf("page tables    : %"PRId64" KiB at the fork\n", cr->pte_kib);
+	    if (cr->rss_kib >= 0) printf("map resident   : %"PRId64" KiB at the fork\n", cr->rss_kib);
+	} else {
+	    printf("fork           : failed\n");
+	}
+	if (p->cow == COW_BOTH && presult->total_bench_count) {
+	    printf("child          : %"PRIu64" accesses, %0.4f usec avg\n",
+		    presult->total_bench_count, mean_us(bench));
+	    if (p->access == &histogram_access) print_access_class_summary(cr->child_stats);
+	}
+    }
+#endif
+
+    //buffer pool
+    if (p->bufpool) {
+	printf("\n----------- Buffer pool information -----------\n");
+	bufpool_report();
+    }
+
+    //lookahead prefetch
+    if (p->prefetch_depth || p->prefetch_hint != PFHINT_NONE) {
+	uint64_t issued = 0, useless = 0, late = 0;
+	int i;
+
+	for (i = 0; i < p->jobs; i++) {
+	    issued += get_result(i)->total_prefetch_issued;
+	    useless += get_result(i)->total_prefetch_useless;
+	    late += get_result(i)->total_prefetch_late;
+	}
+	printf("\n------------- Prefetch information ------------\n");
+	printf("prefetch       : %d draws ahead, hint %s\n", p->prefetch_depth,
+		prefetch_hint_name(p->prefetch_hint));
+	if (p->prefetch_depth) {
+	    printf("phases         : %d ms on and off in turn (pf-on, pf-off classes)\n", PREFETCH_PHASE_MS);
+	    printf("issued         : %"PRIu64" MADV_WILLNEED\n", issued);
+	    printf("useless        : %"PRIu64" (%0.2f%%) already resident\n", useless,
+		    issued ? 100.0 * useless / issued : 0.0);
+	    printf("late           : %"PRIu64" draws reached by the worker first\n", late);
+	}
+    }
+
+    //churn agent
+    if (p->churn_rate) {
+	const struct churn_result* cr = &churn_result;
+	uint64_t total = 0;
+	int op;
+
+	for (op = 0; op < CHURN_NR_OPS; op++) total += cr->ops[op];
+	printf("\n--------------- Churn information -------------\n");
+	printf("churn          : %d x %d KiB per sec, %0.1f per sec achieved (%d failed)\n",
+		p->churn_rate, p->churn_kib,
+		cr->run_clock ? (double)total * freq_khz * 1000 / cr->run_clock : 0.0, cr->failures);
+	for (op = 0; op < CHURN_NR_OPS; op++) {
+	    uint64_t n = 0, sum = 0;
+	    int b;
+
+	    if (!(p->churn_ops & (1 << op))) continue;
+	    printf("%-15s: %"PRIu64" ops", churn_op_name(op), cr->ops[op]);
+	    for (b = 0; b < CHURN_LAT_BINS; b++) n += cr->lat_bins[op][b];
+	    if (n) {
+		/* p99 as the upper edge of its log2 bin */
+		for (b = 0; b < CHURN_LAT_BINS - 1; b++) {
+		    sum += cr->lat_bins[op][b];
+		    if (sum >= n - n / 100) break;
+		}
+		printf(", %0.3f us each, p99 < %lu us, max %0.3f us",
+			(double)cr->clock[op] * 1000 / freq_khz / n, 1UL << b,
+			(double)cr->clock_max[op] * 1000 / freq_khz);
+	    }
+	    printf("\n");
+	}
+	if (cr->tlb_shootdowns >= 0) {
+	    printf("TLB shootdowns : %"PRId64" interrupts while the agent ran", cr->tlb_shootdowns);
+	    if (total) printf(", %0.1f per op", (double)cr->tlb_shootdowns / total);
+	    printf("\n");
+	}
+    }
+
+    //extended counters
+    {
+	const char* labels[4];
+	const sys_mem_item* items[4];
+	int i, n = 0;
+
+	for (i = 0; i < sys_stat_mem_ext_count(); i++) {
+	    if (sys_stat_mem_ext_is_enabled(i)) break;
+	}
+	if (i < sys_stat_mem_ext_count()) {
+	    printf("\n----------- Extended memory counters ----------\n");
+	    labels[n] = params.cold ? "pre-run" : "pre-warmup";
+	    items[n++] = &mem_info_before_warmup;
+	    if (!params.cold) {
+		labels[n] = "pre-run";
+		items[n++] = &mem_info_before_run;
+	    }
+	    if (mem_info_middle_run.recorded) {
+		labels[n] = "mid-run";
+		items[n++] = &mem_info_middle_run;
+	    }
+	    labels[n] = "post-run";
+	    items[n++] = &mem_info_after_run;
+	    sys_stat_mem_ext_print(n, labels, items);
+	}
+    }
+#endif
+
+    //sys_mem_info
+    printf("\n---------- System memory information ----------\n");
+    sys_stat_mem_print_header();
+    if (params.cold) {
+	printf("pre-run   :"); sys_stat_mem_print(&mem_info_before_warmup);//1
+	printf("  (delta) :");
+	if (mem_info_middle_run.recorded) {
+	    sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_middle_run);//2
+	    printf("mid-run   :"); sys_stat_mem_print(&mem_info_middle_run);	//3
+	    printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_middle_run, &mem_info_after_run);	//4
+	}
+	else sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_after_run); //5
+    } else {
+	printf("pre-warmup:"); sys_stat_mem_print(&mem_info_before_warmup);//6
+	printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_before_warmup, &mem_info_before_run);	//7
+	printf("pre-run   :"); sys_stat_mem_print(&mem_info_before_run);	//8
+	printf("  (delta) :");
+	if (mem_info_middle_run.recorded) {
+	    sys_stat_mem_print_delta(&mem_info_before_run, &mem_info_middle_run);//9
+	    printf("mid-run   :"); sys_stat_mem_print(&mem_info_middle_run);	//10
+	    printf("  (delta) :"); sys_stat_mem_print_delta(&mem_info_middle_run, &mem_info_after_run);	//11
+	}
+	else sys_stat_mem_print_delta(&mem_info_before_run, &mem_info_after_run);//12
+    }
+    printf("post-run  :"); sys_stat_mem_print(&mem_info_after_run);		//13
+}
+
+#define MAX_ALARM 4
+typedef void (*alarm_fn)(uint64_t now, void* param);
+
+typedef struct alarm_data {
+    uint64_t time;
+    alarm_fn callback;
+    void* data;		    // user private data
+} alarm_data;
+
+alarm_data alarms[MAX_ALARM];
 
 static
 void _code alarm_arm(int slot, uint64_t time, alarm_fn callback, void* data)
@@ -642,105 +2232,1532 @@ static void* main_bm_thread(void* arg);
 
 #define TS_WARMUP_DONE (1)
 #define TS_MAIN_BM_START (2)
+#define TS_INIT_DONE (3)
 static inline
 void thread_sync(int syncpoint) {
 #ifdef PMB_THREAD
-    pthread_barrier_wait(&control.barrier);
+    pthread_barrier_wait(control.barrier);
 #endif
     return;
 }
 
 /*
- * access address = (base address of map + (page number << 12) + (10 bit random number) * sizeof(u32) )
+ * fills @len bytes at @buf with garbage. 64-bit indexing throughout.
+ * non-temporal stores keep the fill from flushing the caches.
  */
-static inline 
-uint32_t* calc_address(char *buf, size_t pfn) {
-    return (uint32_t*)(buf + (pfn << PAGE_SHIFT));
+static
+__attribute__((cold))
+void fill_garbage(char* buf, size_t len, uint64_t seed)
+{
+    uint64_t state = 0x0ddfadedbeefd00d ^ seed;
+    uint64_t a;
+    size_t off;
+#ifdef __SSE2__
+    uint64_t b;
+    for (off = 0; off + 16 <= len; off += 16) {
+	state = state * 6364136223846793005ull + 1442695040888963407ull;
+	a = state ^ (state >> 29);
+	state = state * 6364136223846793005ull + 1442695040888963407ull;
+	b = state ^ (state >> 29);
+	_mm_stream_si128((__m128i*)(buf + off), _mm_set_epi64x(a, b));
+    }
+    _mm_sfence();
+#else
+    for (off = 0; off + 8 <= len; off += 8) {
+	state = state * 6364136223846793005ull + 1442695040888963407ull;
+	a = state ^ (state >> 29);
+	*(uint64_t*)(buf + off) = a;
+    }
+#endif
 }
 
-/**
- * - main benchmark entry point
- *
- * NB. We want this function and the functions that this function calls to 
- * be confined in a single page, so that there is just one ITLB needed 
- * during the benchmark. We could further compact the code in order to 
- * minimize cache-impact, but that's work to be done.
+/*
+ * returns the address of byte @off of the map at @buf, and clips @len
+ * to the region it is in.
  */
-static void* main_bm_thread(void* arg) _code;
-static
-__attribute__((aligned(4096)))
-void* main_bm_thread(void* arg)
+static inline
+char* map_piece(char* buf, size_t off, size_t* len)
 {
-    struct thread_info *tinfo = (struct thread_info*)arg;
-    int do_memstat = (tinfo->thread_num == 1);
+    size_t r;
 
-    char* buf = tinfo->map;
-    char* stats = control.stats + ((tinfo->thread_num - 1) * 4096); //worker thread numbers start at 1
+    if (!region_map.table || buf != region_map.base) return buf + off;
+    r = off / region_map.bytes;
+    if (*len > (r + 1) * region_map.bytes - off) *len = (r + 1) * region_map.bytes - off;
+    return region_map.table[r] + (off - r * region_map.bytes);
+}
 
-    struct bench_result* presult = &tinfo->result;
+#ifndef _WIN32
+static const char* region_mode_names[] = { "guard", "prot" };
 
-    const parameters* p = &params;
-    pattern_generator* pattern = p->pattern;
-    access_fn_set* access = p->access;
-    uint64_t rand_ctx_offset = (p->offset < 0 ? (uint64_t)(tinfo->thread_num + 7) : (uint64_t)p->offset);
-    uint64_t rand_ctx_action = (uint64_t)(tinfo->thread_num + 50);
-    struct sys_timestamp* tsops = p->tsops;
-    struct stopwatch sw;
-    int i;
-    uint64_t tenk;
-    uint64_t done_tsc, now;
+const char* region_mode_name(int mode)
+{
+    return region_mode_names[mode];
+}
 
-    uint32_t* a_addr;
-    int is_write;   // 0: read, 1: write, 2: write after read
-    uint32_t latency_ns;
+/* maps @size bytes as the regions. returns region 0, NULL on failure */
+static
+__attribute__((cold))
+char* regions_map(size_t size, int prot)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const int flags = MAP_ANONYMOUS | (params.map_shared ? MAP_SHARED : MAP_PRIVATE) |
+	hugepage_map_flags(params.hugepage);
+    struct region_map* rm = &region_map;
+    size_t align = (size_t)1 << params.unit_shift, gap, i;
+    char *resv, *end;
+
+    if ((size_t)pgsz > align) align = pgsz;
+    if (params.hugepage == HUGEPAGE_HUGETLB_2M || params.hugepage == HUGEPAGE_HUGETLB_1G) {
+	if (((size_t)1 << hugepage_shift(params.hugepage)) > align) align = (size_t)1 << hugepage_shift(params.hugepage);
+    }
+    gap = (params.region_mode == REGION_GUARD) ? align : 0;
+    rm->bytes = (size / params.regions + align - 1) & ~(align - 1);
+    rm->count = (size + rm->bytes - 1) / rm->bytes;
+    rm->units = rm->bytes >> params.unit_shift;
+    rm->span = rm->count * (rm->bytes + gap);
+    rm->table = calloc(rm->count, sizeof(char*));
+    if (!rm->table) return NULL;
+
+    /* reserve the span first, so the regions are placed by us */
+    resv = mmap(NULL, rm->span, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (resv == MAP_FAILED) {
+	perror("region reservation mmap failed");
+	return NULL;
+    }
+    for (i = 0; i < rm->count; i++) {
+	size_t len = (i == rm->count - 1) ? size - i * rm->bytes : rm->bytes;
+	int p = prot;
+
+	if (params.region_mode == REGION_PROT && (i & 1)) p |= PROT_EXEC;
+	rm->table[i] = mmap(resv + i * (rm->bytes + gap), len, p, flags | MAP_FIXED, -1, 0);
+	if (rm->table[i] == MAP_FAILED) {
+	    perror("region mmap failed");
+	    printf("Check the limit of VMAs (/proc/sys/vm/max_map_count)\n");
+	    munmap(resv, rm->span);
+	    return NULL;
+	}
+	if (hugepage_advise(rm->table[i], len, params.hugepage)) {
+	    munmap(resv, rm->span);
+	    return NULL;
+	}
+    }
+    /* drop what's reserved past the last region */
+    end = rm->table[rm->count - 1] + (size - (rm->count - 1) * rm->bytes);
+    if (end < resv + rm->span) munmap(end, resv + rm->span - end);
+    rm->span = end - resv;
+    rm->base = resv;
+    return resv;
+}
 
-    /* we upconvert ratio to 0-1023 scale to avoid modular op*/
-    int rat_scaled = ((p->ratio)*1024)/100;
+const struct region_info* get_region_info(void)
+{
+    static struct region_info ri;
 
-    /* note on data type for page count:
-     * size_t and ssize_t types are used when consistent integer
-     * width is needed across platforms.
-     * 'long' is 64bit on 64bit Linux but 32bit on 64bit Windows so
-     * using long for holding page count doesn't work. On the other hand
-     * using long long type makes life difficult when compiling 32bit.
-     */
+    ri.count = region_map.count;
+    ri.bytes = region_map.bytes;
+    ri.vmas = sys_vma_count(region_map.base, region_map.base + region_map.span);
+    return &ri;
+}
 
-    size_t num_pages = p->setsize_mib * 256;
-    size_t iter_warmup;
-    int iter_patternlap = 1000000; // draw 1000000
-    void* ctx = pattern->alloc_pattern(num_pages, p->shape, tinfo->thread_num);
+static
+__attribute__((cold))
+int regions_unmap(void)
+{
+    if (munmap(region_map.base, region_map.span)) {
+	perror("munmap failed");
+	return 1;
+    }
+    free(region_map.table);
+    region_map.table = NULL;
+    return 0;
+}
+#endif
 
-    prn("[%d] num_pages: %ld (%ld MiB), shape: %0.4f\n", tinfo->thread_num, num_pages, num_pages/256, p->shape);
-    sw_reset(&sw, tsops);
+/*
+ * each worker initializes its slice of the map (and its private map),
+ * so first touch places the pages on the worker's node.
+ * returns the number of bytes filled.
+ */
+static
+__attribute__((cold))
+uint64_t init_thread_maps(struct thread_info* tinfo)
+{
+    const size_t map_num_pfn = (size_t)params.mapsize_mib * 256;
+    size_t lo = map_num_pfn * tinfo->init_index / tinfo->init_count;
+    size_t hi = map_num_pfn * (tinfo->init_index + 1) / tinfo->init_count;
+    uint64_t bytes = (uint64_t)(hi - lo) * PAGE_SIZE;
+    size_t off, len;
+    char* addr;
+
+    for (off = lo * PAGE_SIZE; off < hi * PAGE_SIZE; off += len) {
+	len = hi * PAGE_SIZE - off;
+	addr = map_piece(tinfo->map, off, &len);
+	if (params.content) content_fill(addr, len);
+	else fill_garbage(addr, len, off / PAGE_SIZE);
+    }
+    if (tinfo->pmap && tinfo->pmap != tinfo->map) {
+	if (params.content) content_fill(tinfo->pmap, map_num_pfn * PAGE_SIZE);
+	else fill_garbage(tinfo->pmap, map_num_pfn * PAGE_SIZE, 0);
+	bytes += (uint64_t)map_num_pfn * PAGE_SIZE;
+    }
+    return bytes;
+}
 
-    /* do measure pattern generation overhead */
+#ifndef _WIN32
+#ifndef MADV_POPULATE_READ
+#define MADV_POPULATE_READ 22
+#endif
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23
+#endif
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE 0x100000
+#endif
 
-    sw_start(&sw);
-    for (i = 0; i < iter_patternlap; ++i) {
-	pattern->get_next(ctx);
+/*
+ * Fault storm (--fault). Instead of the timed run, all workers fault in
+ * their slice of the fresh map at once, page by page with cold or a range
+ * at a time with the populate modes. Every faulted page is recorded, with
+ * the latency of its access or the average per page of its populate call.
+ */
+static
+int fault_populate(char* addr, size_t len)
+{
+    switch (params.fault_mode) {
+    case FAULT_POPULATE:
+	/* the range is unmapped first, so that MAP_POPULATE is timed alone */
+	if (mmap(addr, len, PROT_READ|PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS |
+		    MAP_FIXED_NOREPLACE | MAP_POPULATE | hugepage_map_flags(params.hugepage),
+		    -1, 0) != addr) {
+	    return -1;
+	}
+	return 0;
+    case FAULT_POPULATE_READ:
+	return madvise(addr, len, MADV_POPULATE_READ);
+    case FAULT_POPULATE_WRITE:
+	return madvise(addr, len, MADV_POPULATE_WRITE);
     }
+    return -1;
+}
 
-    sw_stop(&sw);
+/* returns the clock spent unmapping, which isn't part of the storm */
+static
+uint64_t fault_region(char* buf, size_t len, char* stats, uint64_t* seed,
+	struct bench_result* presult)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const int rat_scaled = ((params.ratio)*1024)/100;
+    struct sys_timestamp* tsops = params.tsops;
+    access_fn_set* access = params.access;
+    size_t chunk = (size_t)params.fault_kib << 10;
+    size_t align = pgsz, off, n, k;
+    uint32_t latency_ns;
+    uint64_t t, unmap_clock = 0;
+    int is_write;
+
+    if (params.fault_mode == FAULT_COLD) {
+	for (off = 0; off < len; off += pgsz) {
+	    is_write = (roll_dice(seed) % 1024) < rat_scaled ? 0 : 1;
+	    if (is_write && params.write_needs_read) is_write = 2;
+	    latency_ns = access->exercise((uint32_t*)(buf + off), is_write);
+	    access->record(stats, latency_ns, is_write);
+	}
+	presult->total_bench_count += len / pgsz;
+	return 0;
+    }
 
-    presult->total_numgen_clock = sw.elapsed_sum;
-    presult->total_numgen_count = iter_patternlap;
+    if (params.hugepage == HUGEPAGE_HUGETLB_2M || params.hugepage == HUGEPAGE_HUGETLB_1G) {
+	align = (size_t)1 << hugepage_shift(params.hugepage);
+    }
+    chunk &= ~(align - 1);
+    if (chunk < align) chunk = align;
+    is_write = (params.fault_mode != FAULT_POPULATE_READ);
+    for (off = 0; off < len; off += chunk) {
+	n = (len - off < chunk) ? len - off : chunk;
+	if (params.fault_mode == FAULT_POPULATE) {
+	    t = tsops->timestamp();
+	    if (munmap(buf + off, n)) {
+		if (presult->fault_failures++ == 0) perror("populate munmap failed");
+		continue;
+	    }
+	    unmap_clock += tsops->timestamp() - t;
+	}
+	t = tsops->timestamp();
+	if (fault_populate(buf + off, n)) {
+	    if (presult->fault_failures++ == 0) perror("populate failed");
+	    continue;
+	}
+	t = tsops->timestamp() - t;
+	/* the pages of a call can't be told apart. each gets the average */
+	latency_ns = (uint32_t)(t * 1000000 / freq_khz / (n / pgsz));
+	for (k = 0; k < n / pgsz; k++) access->record(stats, latency_ns, is_write);
+	presult->total_bench_count += n / pgsz;
+    }
+    return unmap_clock;
+}
 
-    prn("[%d] Pattern generation overhead: %0.4f usec per drawing\n", tinfo->thread_num, (float)sw_get_usec(&sw)/iter_patternlap); // convert msec to usec
-    sw_reset(&sw, tsops);
+/* faults in the worker's slice of the map, and its private map */
+static
+void fault_storm(struct thread_info* tinfo, char* stats, struct bench_result* presult)
+{
+    const size_t map_num_pfn = (size_t)params.mapsize_mib * 256;
+    size_t lo = map_num_pfn * tinfo->init_index / tinfo->init_count;
+    size_t hi = map_num_pfn * (tinfo->init_index + 1) / tinfo->init_count;
+    uint64_t seed = tinfo->thread_num;
+    struct stopwatch sw;
+    uint64_t unmap_clock = 0;
+    size_t off, len;
+    char* addr;
 
-    /* take memory information snapshot */
-    if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_before_warmup);
+    sw_reset(&sw, params.tsops);
+    sw_start(&sw);
+    for (off = lo * PAGE_SIZE; off < hi * PAGE_SIZE; off += len) {
+	len = hi * PAGE_SIZE - off;
+	addr = map_piece(tinfo->map, off, &len);
+	unmap_clock += fault_region(addr, len, stats, &seed, presult);
+    }
+    if (tinfo->pmap && tinfo->pmap != tinfo->map) {
+	unmap_clock += fault_region(tinfo->pmap, map_num_pfn * PAGE_SIZE, stats, &seed, presult);
+    }
+    sw_stop(&sw);
+    presult->total_bench_clock = sw.elapsed_sum - unmap_clock;
+}
 
-    /* do warmup */
-    if (!p->cold) {
+/*
+ * Streaming (--stream). Whole page accesses in address order over a
+ * piece of the map, until done. Residency is checked a chunk ahead, so
+ * the pages that had to be faulted in are told from the ones that only
+ * cost memory bandwidth. Returns nonzero when the time ran out.
+ */
+static
+int stream_region(char* buf, size_t len, char* stats, uint64_t* seed, uint64_t done,
+	struct bench_result* presult)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const int rat_scaled = ((params.ratio)*1024)/100;
+    struct sys_timestamp* tsops = params.tsops;
+    access_fn_set* access = params.access;
+    char* stats_resident = access_class_plane(stats, access_class_find("resident"));
+    char* stats_absent = access_class_plane(stats, access_class_find("non-resident"));
+    unsigned char vec[STREAM_CHUNK];
+    size_t off, k, n;
+    uint32_t latency_ns;
+    int is_write, r;
+
+    for (off = 0; off + pgsz <= len; off += n * pgsz) {
+	if (tsops->timestamp() >= done || control.interrupted) return 1;
+	n = (len - off) / pgsz;
+	if (n > STREAM_CHUNK) n = STREAM_CHUNK;
+	if (mincore(buf + off, n * pgsz, vec)) memset(vec, 1, n);
+	for (k = 0; k < n; k++) {
+	    is_write = (roll_dice(seed) % 1024) < rat_scaled ? 0 : 1;
+	    if (is_write && params.write_needs_read) is_write = 2;
+	    latency_ns = access->exercise((uint32_t*)(buf + off + k * pgsz), is_write);
+	    r = vec[k] & 1;
+	    access->record(stats, latency_ns, is_write);
+	    access->record(r ? stats_resident : stats_absent, latency_ns, is_write);
+	    presult->total_stream_bytes[r] += pgsz;
+	    presult->total_stream_ns[r] += latency_ns;
+	}
+	presult->total_bench_count += n;
+    }
+    return 0;
+}
+
+/* sweeps the worker's slice of the working set for the duration */
+static
+void stream_sweep(struct thread_info* tinfo, char* stats, struct bench_result* presult)
+{
+    const size_t ws_pfn = (size_t)params.setsize_mib * 256;
+    size_t lo = ws_pfn * tinfo->init_index / tinfo->init_count;
+    size_t hi = ws_pfn * (tinfo->init_index + 1) / tinfo->init_count;
+    uint64_t seed = tinfo->thread_num + 50;
+    struct stopwatch sw;
+    uint64_t done;
+    size_t off, len;
+    char* addr;
+
+    sw_reset(&sw, params.tsops);
+    done = sw_start(&sw) + (uint64_t)params.duration_sec * freq_khz * 1000;
+    for (;;) {
+	for (off = lo * PAGE_SIZE; off < hi * PAGE_SIZE; off += len) {
+	    len = hi * PAGE_SIZE - off;
+	    addr = map_piece(tinfo->map, off, &len);
+	    if (stream_region(addr, len, stats, &seed, done, presult)) goto out;
+	}
+	presult->total_stream_passes++;
+    }
+out:
+    sw_stop(&sw);
+    presult->total_bench_clock = sw.elapsed_sum;
+}
+#endif
+
+static const char* mlock_names[] = { "hot", "range" };
+
+const char* mlock_mode_name(int mode)
+{
+    return mlock_names[mode];
+}
+
+static const char* antagonist_names[] = { "none", "square", "ramp", "spike" };
+
+const char* antagonist_shape_name(int shape)
+{
+    return antagonist_names[shape];
+}
+
+struct recover_result recover_result;
+
+static const char* churn_names[] = { "dontneed", "free", "remap", "mremap", "mprotect" };
+
+const char* churn_op_name(int op)
+{
+    return churn_names[op];
+}
+
+struct churn_result churn_result;
+
+static const char* prefetch_hint_names[] = { "none", "normal", "random", "sequential" };
+
+const char* prefetch_hint_name(int hint)
+{
+    return prefetch_hint_names[hint];
+}
+
+static const char* sync_names[] = { "none", "msync", "fdatasync" };
+
+const char* sync_mode_name(int mode)
+{
+    return sync_names[mode];
+}
+
+struct writeback_result writeback_result;
+
+static const char* cow_names[] = { "none", "parent", "child", "both" };
+
+const char* cow_side_name(int side)
+{
+    return cow_names[side];
+}
+
+struct cow_result cow_result;
+
+#ifdef PMB_NUMA
+static const char* mempolicy_names[] = { "none", "interleave", "preferred", "local", "remote" };
+
+const char* mempolicy_name(int policy)
+{
+    return mempolicy_names[policy];
+}
+
+struct numa_placement numa_placement;
+struct numa_matrix_result numa_matrix_result;
+#endif
+
+static const char* fault_names[] = { "none", "cold", "populate", "populate-read", "populate-write" };
+
+const char* fault_mode_name(int mode)
+{
+    return fault_names[mode];
+}
+
+#ifndef _WIN32
+/*
+ * Resident floor (--mlock). PERCENT of the units of a worker's working set
+ * are mlocked before warmup, either the ones the pattern ranks hottest or
+ * the leading ones. lock_bits marks the locked units by pattern index, so
+ * the hot loop can split the latencies into locked and unlocked classes.
+ */
+static uint8_t* lock_bits;
+
+static inline
+int unit_is_locked(size_t idx)
+{
+    return lock_bits[idx >> 3] & (1 << (idx & 7));
+}
+
+/*
+ * VMA churn (--churn). An agent thread discards or replaces ranges of the
+ * shared map while the workers run. churn_bits marks the units a discard
+ * has emptied until a worker touches them again, which is then counted in
+ * the refault class.
+ * The agent also bumps churn_seq before and after each operation, so it is
+ * odd while one is in flight. Accesses that overlap an operation, and with
+ * it the TLB shootdown it sends, are counted in the overlap class.
+ */
+static unsigned long* churn_bits;
+static unsigned long churn_seq;
+
+#define CHURN_WORD_BITS (8 * sizeof(unsigned long))
+
+static inline
+int churn_test_clear(size_t unit)
+{
+    unsigned long* w = &churn_bits[unit / CHURN_WORD_BITS];
+    const unsigned long mask = 1UL << (unit % CHURN_WORD_BITS);
+
+    /* plain load first - the bit is rarely set */
+    if (!(__atomic_load_n(w, __ATOMIC_RELAXED) & mask)) return 0;
+    return (__atomic_fetch_and(w, ~mask, __ATOMIC_RELAXED) & mask) != 0;
+}
+
+/*
+ * Dirty writeback agent (--sync). Its sampler sets wb_throttling while
+ * dirty and writeback pages are at or above the freerun ceiling, where the
+ * kernel throttles writers. A worker access slower than WB_STALL_NS is checked for
+ * a voluntary context switch, i.e., the worker slept in it. Slept accesses
+ * go to the throttled class while throttling, and to stalled otherwise.
+ */
+static int wb_throttling;
+
+static inline
+long wb_nvcsw(void)
+{
+    struct rusage ru;
+
+    if (getrusage(RUSAGE_THREAD, &ru)) return 0;
+    return ru.ru_nvcsw;
+}
+
+/*
+ * Copy-on-write snapshot (--cow). Worker 1 forks once all workers are warm,
+ * while the others wait for the main run. cow_bits marks the pages of the
+ * working set the fork shared, the ones present at fork time. With --cold
+ * the untouched ones fault in fresh pages, not COW. The first write to a
+ * shared page after the fork breaks the COW and goes to the cow-break
+ * class, the rest of the accesses to ordinary. Each side has its own copy of the bits.
+ * With COW_CHILD or COW_BOTH, the child goes on as worker 1 and hands its
+ * result over through cow_child, a shared map.
+ */
+static unsigned long* cow_bits;
+static int cow_page_shift;
+
+#define COW_WORD_BITS (8 * sizeof(unsigned long))
+
+static inline
+int cow_test_clear(size_t page)
+{
+    unsigned long* w = &cow_bits[page / COW_WORD_BITS];
+    const unsigned long mask = 1UL << (page % COW_WORD_BITS);
+
+    if (!(__atomic_load_n(w, __ATOMIC_RELAXED) & mask)) return 0;
+    return (__atomic_fetch_and(w, ~mask, __ATOMIC_RELAXED) & mask) != 0;
+}
+
+#ifdef PMB_THREAD
+static int cow_pipe = -1;	// the snapshot holds until this closes (COW_PARENT)
+
+struct cow_child {
+    struct bench_result result;
+    sys_mem_item mem_info[2];	// middle and after the run
+    char stats[];		// laid out as the stats area
+};
+
+static struct cow_child* cow_child;
+static size_t cow_child_size;
+
+static
+__attribute__((cold))
+int cow_prepare(void)
+{
+    size_t n;
+
+    cow_page_shift = __builtin_ctzl(sysconf(_SC_PAGESIZE));
+    n = (((uint64_t)params.setsize_mib << 20) >> cow_page_shift) / COW_WORD_BITS + 1;
+    cow_bits = malloc(n * sizeof(unsigned long));
+    if (!cow_bits) return -1;
+    memset(cow_bits, 0xff, n * sizeof(unsigned long));
+
+    cow_result.pid = -1;
+    cow_result.pte_kib = -1;
+    cow_result.rss_kib = -1;
+    if (params.cow != COW_PARENT) {
+	cow_child_size = sizeof(struct cow_child) + (size_t)PAGE_SIZE * params.jobs * (1 + num_access_class);
+	cow_child = mmap(NULL, cow_child_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (cow_child == MAP_FAILED) {
+	    cow_child = NULL;
+	    return -1;
+	}
+	cow_result.child_stats = cow_child->stats;
+    }
+    return 0;
+}
+
+/* clears the bits of the pages not present, which the fork can't share */
+static
+void cow_seed(char* buf)
+{
+    const size_t npages = ((uint64_t)params.setsize_mib << 20) >> cow_page_shift;
+    unsigned char vec[4096];
+    size_t off, k, n;
+
+    for (off = 0; off < npages; off += n) {
+	n = npages - off;
+	if (n > sizeof(vec)) n = sizeof(vec);
+	if (mincore(buf + (off << cow_page_shift), n << cow_page_shift, vec)) continue;
+	for (k = 0; k < n; k++) {
+	    if (!(vec[k] & 1)) cow_bits[(off + k) / COW_WORD_BITS] &= ~(1UL << ((off + k) % COW_WORD_BITS));
+	}
+    }
+}
+
+/* forks the snapshot. returns 1 in a child that goes on as worker 1 */
+static
+int cow_fork(char* buf, char* stats)
+{
+    struct cow_result* cr = &cow_result;
+    int fds[2];
+    uint64_t clk;
+    pid_t pid;
+    char c;
+    int i;
+
+    if (params.cow == COW_PARENT && pipe(fds)) {
+	perror("cow pipe");
+	return 0;
+    }
+    cr->pte_kib = sys_status_get("VmPTE:");
+    cr->rss_kib = sys_smaps_get(buf, "Rss:");
+    cow_seed(buf);
+
+    /* the child must not inherit the lock held */
+    prn_lock();
+    fflush(stdout);
+    clk = params.tsops->timestamp();
+    pid = fork();
+    clk = params.tsops->timestamp() - clk;
+    prn_unlock();
+    if (pid == 0) {
+	if (params.cow == COW_PARENT) {
+	    /* hold the snapshot until the parent is done, or gone */
+	    close(fds[1]);
+	    while (read(fds[0], &c, 1) == -1 && errno == EINTR);
+	    _exit(0);
+	}
+	/* the histograms are still empty. break their COW before the run */
+	for (i = 0; i <= num_access_class; i++) memset(access_class_plane(stats, i), 0, PAGE_SIZE);
+	return 1;
+    }
+    if (pid == -1) perror("cow fork");
+    cr->pid = pid;
+    cr->fork_clock = clk;
+    if (params.cow == COW_PARENT) {
+	close(fds[0]);
+	if (pid == -1) close(fds[1]);
+	else cow_pipe = fds[1];
+    }
+    return 0;
+}
+
+/* the child hands its result over to the parent and exits */
+static
+void cow_child_exit(char* stats, const struct bench_result* presult)
+{
+    /* worker 1's histograms lead each plane, so the stats area goes whole */
+    memcpy(cow_child->stats, stats, cow_child_size - sizeof(struct cow_child));
+    cow_child->result = *presult;
+    cow_child->mem_info[0] = mem_info_middle_run;
+    cow_child->mem_info[1] = mem_info_after_run;
+    fflush(stdout);
+    _exit(0);
+}
+#endif
+
+/* number of units a worker's pattern draws from */
+static
+size_t worker_num_units(void)
+{
+    size_t n = ((uint64_t)params.setsize_mib << 20) >> params.unit_shift;
+    if (params.topology == TOPO_PARTITION) n /= params.jobs;
+    return n;
+}
+
+static
+__attribute__((cold))
+int mlock_prepare(void)
+{
+    const size_t n = worker_num_units();
+    const size_t nlock = (uint64_t)n * params.mlock_pct / 100;
+    void* ctx = NULL;
+    size_t r, idx;
+
+    lock_bits = calloc((n + 7) / 8, 1);
+    if (!lock_bits) return -1;
+    if (params.mlock_mode == MLOCK_HOT) {
+	ctx = params.pattern->alloc_pattern(n, params.shape, 0);
+	if (!ctx) return -1;
+    }
+    for (r = 0; r < nlock; r++) {
+	idx = ctx ? get_pattern_rank(params.pattern, ctx, r) : r;
+	if (idx < n) lock_bits[idx >> 3] |= (1 << (idx & 7));
+    }
+    if (ctx) params.pattern->free_pattern(ctx);
+    return 0;
+}
+
+/* mlocks the marked units of the region at @buf, coalescing runs */
+static
+__attribute__((cold))
+void mlock_region(char* buf, struct bench_result* presult)
+{
+    const size_t n = worker_num_units();
+    const int shift = params.unit_shift;
+    size_t i, run = 0;
+
+    for (i = 0; i <= n; i++) {
+	if (i < n && unit_is_locked(i)) {
+	    run++;
+	    continue;
+	}
+	if (run == 0) continue;
+	if (mlock(buf + ((i - run) << shift), run << shift)) {
+	    if (presult->lock_failures++ == 0) perror("mlock failed");
+	} else {
+	    presult->total_locked_bytes += (uint64_t)run << shift;
+	}
+	run = 0;
+    }
+}
+#endif
+
+/*
+ * access address = (base address of map + (unit number << unit_shift) + (10 bit random number) * sizeof(u32) )
+ * unit is a base page (4K) unless huge page unit is asked.
+ */
+static inline 
+uint32_t* calc_address(char *buf, size_t pfn, int unit_shift) {
+    if (region_map.table && buf == region_map.base) {
+	const size_t r = pfn / region_map.units;
+	return (uint32_t*)(region_map.table[r] + ((uint64_t)(pfn - r * region_map.units) << unit_shift));
+    }
+    return (uint32_t*)(buf + ((uint64_t)pfn << unit_shift));
+}
+
+/*
+ * Memory level parallelism (--mlp). The addresses of a batch are drawn
+ * first, then its K accesses are issued back to back with nothing
+ * depending on them but a sink, so an out-of-order core can overlap the
+ * misses. The batch is timed as a group.
+ */
+static volatile uint32_t mlp_sink;
+
+static
+_code
+uint32_t mlp_batch(uint32_t** addr, int k, int is_write)
+{
+    struct stopwatch sw;
+    uint32_t sink = 0;
+    int j;
+
+    sw_reset(&sw, params.tsops);
+    sw_start(&sw);
+    if (params.mlp_update) {
+	for (j = 0; j < k; j++) *(volatile uint32_t*)addr[j] ^= (uint32_t)(uintptr_t)addr[j];
+    } else if (is_write) {
+	for (j = 0; j < k; j++) *(volatile uint32_t*)addr[j] = (uint32_t)(uintptr_t)addr[j];
+    } else {
+	for (j = 0; j < k; j++) sink += *(volatile uint32_t*)addr[j];
+    }
+    sw_stop(&sw);
+    mlp_sink = sink;
+    return sw_get_nsec(&sw);
+}
+
+struct mlp_draw {
+    char* buf;
+    size_t base_pfn;
+    pattern_generator* pattern;
+    void* ctx;
+    uint64_t* seed_offset;
+    uint64_t* seed_action;
+};
+
+/* draws the addresses of a batch of k, and whether it writes */
+static inline
+int mlp_draw_batch(struct mlp_draw* d, uint32_t** addr, int k)
+{
+    const int rat_scaled = ((params.ratio)*1024)/100;
+    int j;
+
+    for (j = 0; j < k; j++) {
+	addr[j] = calc_address(d->buf, d->base_pfn + d->pattern->get_next(d->ctx), params.unit_shift);
+	addr[j] += params.get_offset(d->seed_offset);
+    }
+    return params.mlp_update || (roll_dice(d->seed_action) % 1024) >= rat_scaled;
+}
+
+struct mlp_result mlp_result;
+
+/* worker 1 alone, before the run: throughput at each power of two batch size */
+static
+void mlp_sweep(struct mlp_draw* d)
+{
+    struct mlp_result* mr = &mlp_result;
+    uint32_t* addr[MLP_MAX];
+    uint64_t batches, ns, done;
+    double peak = 0.0;
+    int k, l, is_write;
+
+    memset(mr, 0, sizeof(*mr));
+    for (k = 1; k <= MLP_MAX; k *= 2) {
+	batches = ns = 0;
+	done = params.tsops->timestamp() + (uint64_t)MLP_PROBE_MS * freq_khz;
+	while (params.tsops->timestamp() < done && !control.interrupted) {
+	    is_write = mlp_draw_batch(d, addr, k);
+	    ns += mlp_batch(addr, k, is_write);
+	    batches++;
+	}
+	l = mr->levels++;
+	mr->k[l] = k;
+	mr->rate[l] = ns ? (double)batches * k * 1000000000 / ns : 0.0;
+	mr->batch_ns[l] = batches ? (double)ns / batches : 0.0;
+	if (mr->rate[l] > peak) peak = mr->rate[l];
+    }
+    for (l = 0; l < mr->levels; l++) {
+	if (mr->rate[l] * 100 >= peak * MLP_SATURATE_PCT) {
+	    mr->saturation_k = mr->k[l];
+	    break;
+	}
+    }
+}
+
+/* the timed run with batches of params.mlp */
+static
+void mlp_run(struct mlp_draw* d, char* stats, struct bench_result* presult)
+{
+    access_fn_set* access = params.access;
+    uint32_t* addr[MLP_MAX];
+    struct stopwatch sw;
+    uint64_t done;
+    uint32_t latency_ns;
+    int i, is_write;
+
+    sw_reset(&sw, params.tsops);
+    done = sw_start(&sw) + (uint64_t)params.duration_sec * freq_khz * 1000;
+    while (params.tsops->timestamp() < done && !control.interrupted) {
+	for (i = 0; i < 1000; i++) {
+	    is_write = mlp_draw_batch(d, addr, params.mlp);
+	    latency_ns = mlp_batch(addr, params.mlp, is_write);
+	    access->record(stats, latency_ns, is_write);
+	    presult->total_mlp_ns += latency_ns;
+	}
+	presult->total_mlp_batches += 1000;
+	presult->total_bench_count += 1000 * params.mlp;
+    }
+    sw_stop(&sw);
+    presult->total_bench_clock = sw.elapsed_sum;
+}
+
+#define handle_error_en(en, msg) \
+    do { errno = en; perror(msg); exit(EXIT_FAILURE); } while (0)
+
+#define handle_error(msg) \
+    do { perror(msg); exit(EXIT_FAILURE); } while (0)
+
+#ifndef _WIN32
+/* applies the --prefetch hint to the worker's slice of the map, and its private map */
+static
+__attribute__((cold))
+void prefetch_advise(struct thread_info* tinfo)
+{
+    static const int advice[] = { 0, MADV_NORMAL, MADV_RANDOM, MADV_SEQUENTIAL };
+    const size_t map_num_pfn = (size_t)params.mapsize_mib * 256;
+    size_t lo = map_num_pfn * tinfo->init_index / tinfo->init_count * PAGE_SIZE;
+    size_t hi = map_num_pfn * (tinfo->init_index + 1) / tinfo->init_count * PAGE_SIZE;
+    size_t off, len;
+    char* addr;
+
+    for (off = lo; off < hi; off += len) {
+	len = hi - off;
+	addr = map_piece(tinfo->map, off, &len);
+	if (madvise(addr, len, advice[params.prefetch_hint])) perror("prefetch hint madvise failed");
+    }
+    if (tinfo->pmap && tinfo->pmap != tinfo->map) {
+	if (madvise(tinfo->pmap, map_num_pfn * PAGE_SIZE, advice[params.prefetch_hint])) {
+	    perror("prefetch hint madvise failed");
+	}
+    }
+}
+#endif
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+/*
+ * Lookahead prefetch (--prefetch). A helper thread per worker draws the
+ * worker's pattern stream from its own copy of the generator, up to depth
+ * draws ahead of the worker, and issues MADV_WILLNEED on the units. The
+ * main run alternates PREFETCH_PHASE_MS phases with the prefetch on and
+ * off, so the pf-on and pf-off classes compare the two under the same
+ * conditions.
+ */
+struct prefetcher {
+    pthread_t thread_id;
+    struct thread_info* tinfo;
+    char* buf;
+    size_t num_pages;		// the worker's pattern size
+    size_t base_pfn;		// the worker's slice with partition
+    uint64_t skip;		// draws the worker made before the main run
+    uint64_t progress;		// draws the worker made in the main run
+    int on;			// the current phase. set by the worker
+    int done;
+};
+
+static
+void* prefetch_thread(void* arg)
+{
+    struct prefetcher* pf = arg;
+    struct bench_result* presult = &pf->tinfo->result;
+    const size_t len = (size_t)1 << params.unit_shift;
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    unsigned char vec[len / pgsz];
+    uint64_t drawn = 0, i;
+    char* addr;
+    size_t idx;
+    void* ctx;
+
+    /* same size and seed as the worker's, so the same stream */
+    ctx = params.pattern->alloc_pattern(pf->num_pages, params.shape, pf->tinfo->thread_num);
+    if (!ctx) return NULL;
+    for (i = 0; i < pf->skip; i++) params.pattern->get_next(ctx);
+
+    while (!__atomic_load_n(&pf->done, __ATOMIC_RELAXED)) {
+	uint64_t progress = __atomic_load_n(&pf->progress, __ATOMIC_RELAXED);
+
+	if (drawn >= progress + params.prefetch_depth) {
+	    sched_yield();
+	    continue;
+	}
+	idx = params.pattern->get_next(ctx);
+	if (drawn++ < progress) {
+	    presult->total_prefetch_late++;
+	    continue;
+	}
+	if (!__atomic_load_n(&pf->on, __ATOMIC_RELAXED)) continue;
+
+	addr = (char*)calc_address(pf->buf, pf->base_pfn + idx, params.unit_shift);
+	if (!mincore(addr, len, vec) && (vec[0] & 1)) presult->total_prefetch_useless++;
+	madvise(addr, len, MADV_WILLNEED);
+	presult->total_prefetch_issued++;
+    }
+    params.pattern->free_pattern(ctx);
+    return NULL;
+}
+
+static
+void prefetch_start(struct prefetcher* pf)
+{
+    int s = pthread_create(&pf->thread_id, NULL, prefetch_thread, pf);
+    if (s != 0) handle_error_en(s, "pthread_create");
+}
+
+static
+void prefetch_stop(struct prefetcher* pf)
+{
+    int s;
+
+    __atomic_store_n(&pf->done, 1, __ATOMIC_RELAXED);
+    s = pthread_join(pf->thread_id, NULL);
+    if (s != 0) handle_error_en(s, "pthread_join");
+}
+#endif
+
+/*
+ * Latency timeline. With the antagonist each worker also counts its
+ * accesses into a small histogram per TIMELINE_MS interval of the main run,
+ * so interval percentiles can be followed through the pressure cycles.
+ * Bins are 8 per power of two: bin = (log2 << 3) | next 3 bits.
+ */
+#define TIMELINE_MS 100
+#define TL_BINS 256
+
+struct timeline {
+    uint64_t base_tsc;		// start of interval 0, set by the control thread
+    uint64_t interval_clk;
+    size_t nslots;		// intervals per worker
+    uint32_t bins[];		// [worker][interval][TL_BINS]
+};
+
+static struct timeline* timeline;	// shared with worker processes
+
+static inline
+int tl_bin(uint32_t ns)
+{
+    int o;
+
+    if (ns < 8) return ns;
+    o = ilog2(ns);
+    return (o << 3) | ((ns >> (o - 3)) & 7);
+}
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+static
+double tl_bin_mid(int b)
+{
+    int o = b >> 3;
+
+    if (b < 24) return b < 8 ? b : 0.0;
+    return (double)((uint64_t)(8 + (b & 7)) << (o - 3)) + (double)((uint64_t)1 << (o - 3)) / 2;
+}
+#endif
+
+/*
+ * Feature loops. A default run keeps to the timed loop of main_bm_thread,
+ * which fits in one page. Features that act on every access run a loop of
+ * their own instead, picked once before the run. Each is bm_feature_loop
+ * specialized for one feature, and bm_loop_any takes the combinations.
+ */
+enum {
+    BM_MIX = 1 << 0,		// mix topology. shared and private classes
+    BM_MLOCK = 1 << 1,		// locked and unlocked classes
+    BM_CHURN = 1 << 2,		// refault, steady, overlap and quiet classes
+    BM_POOL = 1 << 3,		// accesses through the buffer pool
+    BM_SYNC = 1 << 4,		// throttled, stalled and running classes
+    BM_COW = 1 << 5,		// cow-break and ordinary classes
+    BM_PREFETCH = 1 << 6,	// prefetch phases. pf-on and pf-off classes
+    BM_TIMELINE = 1 << 7,	// latency timeline of the antagonist
+};
+
+struct bm_loop {
+    unsigned features;		// BM_* of the worker
+    char* buf;
+    char* pbuf;			// private map of mix
+    size_t base_pfn;
+    void* ctx;
+    void* pctx;			// pattern over the private map of mix
+    int mix_scaled;
+    uint64_t* seed_offset;
+    uint64_t* seed_action;
+    char* stats;
+    char* stats_shared;
+    char* stats_private;
+    char* stats_locked;
+    char* stats_unlocked;
+    char* stats_refault;
+    char* stats_steady;
+    char* stats_overlap;
+    char* stats_quiet;
+    char* stats_pool_hit;
+    char* stats_pool_miss;
+    char* stats_throttled;
+    char* stats_stalled;
+    char* stats_running;
+    char* stats_cow_break;
+    char* stats_ordinary;
+    char* stats_pf_on;
+    char* stats_pf_off;
+    uint32_t* tl_bins;
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    struct prefetcher pf;
+#endif
+};
+
+/* sets up the features of a worker before its warmup */
+static
+__attribute__((cold, noinline))
+void bm_prepare(struct bm_loop* l, struct thread_info* tinfo, char* stats, void* ctx,
+	size_t base_pfn, size_t num_pages, uint64_t* seed_offset, uint64_t* seed_action)
+{
+    const parameters* p = &params;
+
+    memset(l, 0, sizeof(*l));
+    l->buf = tinfo->map;
+    l->pbuf = tinfo->pmap;
+    l->base_pfn = base_pfn;
+    l->ctx = ctx;
+    l->mix_scaled = ((p->mix_pct)*1024)/100;
+    l->seed_offset = seed_offset;
+    l->seed_action = seed_action;
+    l->stats = stats;
+
+    if (p->topology == TOPO_MIX) {
+	l->features |= BM_MIX;
+	l->pctx = p->pattern->alloc_pattern(num_pages, p->shape, tinfo->thread_num + p->jobs);
+	l->stats_shared = access_class_plane(stats, access_class_find("shared"));
+	l->stats_private = access_class_plane(stats, access_class_find("private"));
+    }
+    if (timeline) {
+	l->features |= BM_TIMELINE;
+	l->tl_bins = timeline->bins + (size_t)(tinfo->thread_num - 1) * timeline->nslots * TL_BINS;
+    }
+#ifndef _WIN32
+    /* resident floor. the first initializer of a map locks it,
+     * partition workers lock their own slice */
+    if (lock_bits) {
+	l->features |= BM_MLOCK;
+	if (tinfo->init_index == 0 || p->topology == TOPO_PARTITION) {
+	    mlock_region(l->buf + (base_pfn << p->unit_shift), &tinfo->result);
+	}
+	if (l->pbuf && l->pbuf != l->buf) mlock_region(l->pbuf, &tinfo->result);
+	l->stats_locked = access_class_plane(stats, access_class_find("locked"));
+	l->stats_unlocked = access_class_plane(stats, access_class_find("unlocked"));
+    }
+    if (churn_bits) {
+	l->features |= BM_CHURN;
+	l->stats_refault = access_class_plane(stats, access_class_find("refault"));
+	l->stats_steady = access_class_plane(stats, access_class_find("steady"));
+	l->stats_overlap = access_class_plane(stats, access_class_find("overlap"));
+	l->stats_quiet = access_class_plane(stats, access_class_find("quiet"));
+    }
+    if (p->prefetch_hint != PFHINT_NONE) prefetch_advise(tinfo);
+    if (p->bufpool) {
+	l->features |= BM_POOL;
+	l->stats_pool_hit = access_class_plane(stats, access_class_find("pool-hit"));
+	l->stats_pool_miss = access_class_plane(stats, access_class_find("pool-miss"));
+    }
+    if (p->sync_ms) {
+	l->features |= BM_SYNC;
+	l->stats_throttled = access_class_plane(stats, access_class_find("throttled"));
+	l->stats_stalled = access_class_plane(stats, access_class_find("stalled"));
+	l->stats_running = access_class_plane(stats, access_class_find("running"));
+    }
+    if (p->cow != COW_NONE) {
+	l->features |= BM_COW;
+	l->stats_cow_break = access_class_plane(stats, access_class_find("cow-break"));
+	l->stats_ordinary = access_class_plane(stats, access_class_find("ordinary"));
+    }
+#endif
+}
+
+/* warmup of the features that change where the accesses go (mix, pool) */
+static
+__attribute__((noinline))
+void bm_warmup(struct bm_loop* l, size_t iter)
+{
+    const parameters* p = &params;
+    const int rat_scaled = ((p->ratio)*1024)/100;
+    uint32_t* a_addr;
+    size_t i;
+    int is_write;
+
+    for (i = 0; i < iter; ++i) {
+	if (l->pctx && (i & 1)) a_addr = calc_address(l->pbuf, p->pattern->get_next(l->pctx), p->unit_shift);
+#ifndef _WIN32
+	else if (l->features & BM_POOL) a_addr = (uint32_t*)bufpool_fix(l->base_pfn + p->pattern->get_next(l->ctx), NULL);
+#endif
+	else a_addr = calc_address(l->buf, l->base_pfn + p->pattern->get_next(l->ctx), p->unit_shift);
+	a_addr += p->get_offset(l->seed_offset);
+	is_write = (roll_dice(l->seed_action) % 1024) < rat_scaled ? 0 : 1;
+	if (is_write && p->write_needs_read) is_write = 2;
+
+	p->access->exercise(a_addr, is_write);
+#ifndef _WIN32
+	if (l->features & BM_POOL) bufpool_unfix(a_addr, is_write);
+#endif
+    }
+}
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+/* the helper catches up with the draws so far while the others warm up */
+static
+__attribute__((cold, noinline))
+void bm_prefetch_start(struct bm_loop* l, struct thread_info* tinfo, size_t num_pages, uint64_t skip)
+{
+    l->features |= BM_PREFETCH;
+    l->pf.tinfo = tinfo;
+    l->pf.buf = l->buf;
+    l->pf.num_pages = num_pages;
+    l->pf.base_pfn = l->base_pfn;
+    l->pf.skip = skip;
+    prefetch_start(&l->pf);
+    l->stats_pf_on = access_class_plane(l->stats, access_class_find("pf-on"));
+    l->stats_pf_off = access_class_plane(l->stats, access_class_find("pf-off"));
+}
+#endif
+
+/* end of the warmup. worker 1 takes what goes before the main run */
+static
+__attribute__((cold, noinline))
+void bm_warmup_done(struct bm_loop* l, struct thread_info* tinfo, struct mlp_draw* md)
+{
+    md->buf = l->buf;
+    md->base_pfn = l->base_pfn;
+    md->pattern = params.pattern;
+    md->ctx = l->ctx;
+    md->seed_offset = l->seed_offset;
+    md->seed_action = l->seed_action;
+    if (tinfo->thread_num != 1) return;
+    /* the others wait at the next sync point while worker 1 tries the batch
+     * sizes. it's part of the warmup, so the timeline starts after it */
+    if (params.mlp && !control.interrupted) {
+	prn("[1] Measuring throughput by batch size\n");
+	mlp_sweep(md);
+    }
+    /* with procs, or without threads, there's no control thread on the map */
+#ifdef PMB_THREAD
+    if (params.procs && map_sample_needed())
+#else
+    if (map_sample_needed())
+#endif
+	map_sample(tinfo->map, &map_sample_before_run);
+}
+
+/*
+ * the runs that replace the timed loop: fault storm, streaming and mlp,
+ * or none at all for a COW parent whose child runs in its place.
+ * Returns 1 when the worker is done.
+ */
+static
+__attribute__((cold, noinline))
+int bm_other_run(struct bm_loop* l, struct thread_info* tinfo, struct mlp_draw* md,
+	int do_memstat, int cow_in_child)
+{
+    struct bench_result* presult = &tinfo->result;
+
+#ifndef _WIN32
+    if (cow_in_child && params.cow == COW_BOTH) l->features &= ~BM_TIMELINE;	// worker 1 of the parent has it
+    if (params.cow == COW_CHILD && tinfo->thread_num == 1 && !cow_in_child && cow_result.pid > 0) {
+	/* the child runs in our place */
+	goto done;
+    }
+    if (params.fault_mode != FAULT_NONE) {
+	prn("[%d] Starting fault storm\n", tinfo->thread_num);
+	fault_storm(tinfo, l->stats, presult);
+	if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_after_run);
+	prn("[%d] Fault storm done - %"PRIu64" pages in %0.3f ms\n", tinfo->thread_num,
+		presult->total_bench_count, (double)presult->total_bench_clock / freq_khz);
+	goto done;
+    }
+    if (params.stream) {
+	prn("[%d] Starting streaming\n", tinfo->thread_num);
+	stream_sweep(tinfo, l->stats, presult);
+	if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_after_run);
+	prn("[%d] Streaming done - %"PRIu64" passes, %0.1f MiB/s\n", tinfo->thread_num,
+		presult->total_stream_passes, get_stream_throughput(tinfo->thread_num - 1));
+	goto done;
+    }
+#endif
+    if (params.mlp) {
+	prn("[%d] Starting main benchmark, %d %s per batch\n", tinfo->thread_num, params.mlp,
+		params.mlp_update ? "updates" : "loads");
+	mlp_run(md, l->stats, presult);
+	if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_after_run);
+	prn("[%d] Benchmark done - %"PRIu64" batches, %0.3f M accesses/s\n", tinfo->thread_num,
+		presult->total_mlp_batches, get_mlp_rate(tinfo->thread_num - 1) / 1000000);
+	goto done;
+    }
+    return 0;
+done:
+    params.pattern->free_pattern(l->ctx);
+    if (l->pctx) params.pattern->free_pattern(l->pctx);
+    return 1;
+}
+
+/*
+ * the timed loop with features @f. Always inlined with a constant @f, so
+ * each instance only carries the code of its features. Returns the number
+ * of 10000 access rounds.
+ */
+static inline
+__attribute__((always_inline))
+uint64_t bm_feature_loop(struct bm_loop* l, uint64_t done_tsc, const unsigned f)
+{
+    const parameters* p = &params;
+    pattern_generator* pattern = p->pattern;
+    access_fn_set* access = p->access;
+    struct sys_timestamp* tsops = p->tsops;
+    const int unit_shift = p->unit_shift;
+    const int rat_scaled = ((p->ratio)*1024)/100;
+    char* cls_stats = NULL;
+    uint32_t* a_addr;
+    uint32_t latency_ns;
+    uint64_t tenk = 0, now;
+    size_t idx;
+    int i, is_write;
+#ifndef _WIN32
+    uint64_t pool_clk = 0;
+    unsigned long seq = 0;
+    int pool_miss = 0, overlap = 0, churned = 0;
+    long nvcsw = 0, n;
+    char* wb_stats;
+#endif
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    const uint64_t pf_phase_clk = (uint64_t)PREFETCH_PHASE_MS * freq_khz;
+    const uint64_t pf_start = done_tsc - (uint64_t)p->duration_sec * freq_khz * 1000;
+    uint64_t pf_count = 0;
+    int pf_on = 0;
+#endif
+
+#ifndef _WIN32
+    if (f & BM_SYNC) nvcsw = wb_nvcsw();
+#endif
+    while ((now = tsops->timestamp()) < done_tsc) {
+	alarm_check(now);
+#if defined(PMB_THREAD) && !defined(_WIN32)
+	if (f & BM_PREFETCH) {
+	    pf_on = (((now - pf_start) / pf_phase_clk) & 1) == 0;
+	    __atomic_store_n(&l->pf.on, pf_on, __ATOMIC_RELAXED);
+	}
+#endif
+	for (i = 0; i < 10000; ++i) {
+	    if ((f & BM_MIX) && (roll_dice(l->seed_action) % 1024) >= l->mix_scaled) {
+		idx = pattern->get_next(l->pctx);
+		a_addr = calc_address(l->pbuf, idx, unit_shift);
+		cls_stats = l->stats_private;
+#ifndef _WIN32
+		churned = 0;
+#endif
+	    } else {
+		idx = pattern->get_next(l->ctx);
+#ifndef _WIN32
+		if (f & BM_POOL) {
+		    /* the lookup and any miss service count toward the access */
+		    pool_clk = tsops->timestamp();
+		    a_addr = (uint32_t*)bufpool_fix(l->base_pfn + idx, &pool_miss);
+		    pool_clk = tsops->timestamp() - pool_clk;
+		} else
+#endif
+		a_addr = calc_address(l->buf, l->base_pfn + idx, unit_shift);
+		cls_stats = l->stats_shared;
+#ifndef _WIN32
+		if (f & BM_CHURN) churned = churn_test_clear(l->base_pfn + idx);
+#endif
+	    }
+	    a_addr += p->get_offset(l->seed_offset);
+	    is_write = (roll_dice(l->seed_action) % 1024) < rat_scaled ? 0 : 1;
+	    if (is_write && p->write_needs_read) is_write = 2;
+
+#ifndef _WIN32
+	    if (f & BM_CHURN) seq = __atomic_load_n(&churn_seq, __ATOMIC_ACQUIRE);
+#endif
+	    latency_ns = access->exercise(a_addr, is_write);
+#ifndef _WIN32
+	    if (f & BM_CHURN) {
+		overlap = (seq & 1) || seq != __atomic_load_n(&churn_seq, __ATOMIC_ACQUIRE);
+	    }
+	    if (f & BM_POOL) {
+		uint64_t ns = latency_ns + pool_clk * 1000000 / freq_khz;
+		latency_ns = ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+		bufpool_unfix(a_addr, is_write);
+	    }
+#endif
+
+	    access->record(l->stats, latency_ns, is_write);
+	    if (f & BM_MIX) access->record(cls_stats, latency_ns, is_write);
+	    if (f & BM_TIMELINE) {
+		size_t slot = (tsops->timestamp() - timeline->base_tsc) / timeline->interval_clk;
+		if (slot < timeline->nslots) l->tl_bins[slot * TL_BINS + tl_bin(latency_ns)]++;
+	    }
+#ifndef _WIN32
+	    if (f & BM_MLOCK) {
+		access->record(unit_is_locked(idx) ? l->stats_locked : l->stats_unlocked,
+			latency_ns, is_write);
+	    }
+	    if (f & BM_CHURN) {
+		access->record(churned ? l->stats_refault : l->stats_steady, latency_ns, is_write);
+		access->record(overlap ? l->stats_overlap : l->stats_quiet, latency_ns, is_write);
+	    }
+	    if (f & BM_POOL) {
+		access->record(pool_miss ? l->stats_pool_miss : l->stats_pool_hit, latency_ns, is_write);
+	    }
+	    if (f & BM_COW) {
+		access->record(is_write && cow_test_clear(((char*)a_addr - l->buf) >> cow_page_shift) ?
+			l->stats_cow_break : l->stats_ordinary, latency_ns, is_write);
+	    }
+	    if (f & BM_SYNC) {
+		wb_stats = l->stats_running;
+		if (latency_ns >= WB_STALL_NS && (n = wb_nvcsw()) != nvcsw) {
+		    nvcsw = n;
+		    wb_stats = __atomic_load_n(&wb_throttling, __ATOMIC_RELAXED) ?
+			l->stats_throttled : l->stats_stalled;
+		}
+		access->record(wb_stats, latency_ns, is_write);
+	    }
+#ifdef PMB_THREAD
+	    if (f & BM_PREFETCH) {
+		access->record(pf_on ? l->stats_pf_on : l->stats_pf_off, latency_ns, is_write);
+		__atomic_store_n(&l->pf.progress, ++pf_count, __ATOMIC_RELAXED);
+	    }
+#endif
+	    if (params.threshold > 0) mark_long_latency(latency_ns);
+#endif
+	    if (p->delay > 10) sys_delay(p->delay);
+	}
+	tenk++;
+	if (control.interrupted) break;
+    }
+    return tenk;
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_mix(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_MIX);
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_timeline(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_TIMELINE);
+}
+
+#ifndef _WIN32
+static __attribute__((noinline)) uint64_t bm_loop_mlock(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_MLOCK);
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_churn(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_CHURN);
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_pool(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_POOL);
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_sync(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_SYNC);
+}
+
+static __attribute__((noinline)) uint64_t bm_loop_cow(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_COW);
+}
+#endif
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+static __attribute__((noinline)) uint64_t bm_loop_prefetch(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, BM_PREFETCH);
+}
+#endif
+
+/* two or more features at once. they are tested on every access */
+static __attribute__((noinline)) uint64_t bm_loop_any(struct bm_loop* l, uint64_t done_tsc)
+{
+    return bm_feature_loop(l, done_tsc, l->features);
+}
+
+/* runs the loop of the worker's features. returns the 10000 access rounds */
+static
+__attribute__((noinline))
+uint64_t bm_run_features(struct bm_loop* l, uint64_t done_tsc)
+{
+    switch (l->features) {
+    case BM_MIX:	return bm_loop_mix(l, done_tsc);
+    case BM_TIMELINE:	return bm_loop_timeline(l, done_tsc);
+#ifndef _WIN32
+    case BM_MLOCK:	return bm_loop_mlock(l, done_tsc);
+    case BM_CHURN:	return bm_loop_churn(l, done_tsc);
+    case BM_POOL:	return bm_loop_pool(l, done_tsc);
+    case BM_SYNC:	return bm_loop_sync(l, done_tsc);
+    case BM_COW:	return bm_loop_cow(l, done_tsc);
+#endif
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    case BM_PREFETCH:	return bm_loop_prefetch(l, done_tsc);
+#endif
+    }
+    return bm_loop_any(l, done_tsc);
+}
+
+/**
+ * - main benchmark entry point
+ *
+ * NB. We want this function and the functions that this function calls to 
+ * be confined in a single page, so that there is just one ITLB needed 
+ * during the benchmark. We could further compact the code in order to 
+ * minimize cache-impact, but that's work to be done.
+ */
+static void* main_bm_thread(void* arg) _code;
+static
+__attribute__((aligned(4096)))
+void* main_bm_thread(void* arg)
+{
+    struct thread_info *tinfo = (struct thread_info*)arg;
+    int do_memstat = (tinfo->thread_num == 1);
+
+    char* buf = tinfo->map;
+    char* stats = control.stats + ((tinfo->thread_num - 1) * 4096); //worker thread numbers start at 1
+
+    struct bench_result* presult = &tinfo->result;
+
+    const parameters* p = &params;
+    pattern_generator* pattern = p->pattern;
+    access_fn_set* access = p->access;
+    uint64_t rand_ctx_offset = (p->offset < 0 ? (uint64_t)(tinfo->thread_num + 7) : (uint64_t)p->offset);
+    uint64_t rand_ctx_action = (uint64_t)(tinfo->thread_num + 50);
+    struct sys_timestamp* tsops = p->tsops;
+    struct stopwatch sw;
+    int i;
+    uint64_t tenk;
+    uint64_t done_tsc, now;
+
+    uint32_t* a_addr;
+    int is_write;   // 0: read, 1: write, 2: write after read
+    uint32_t latency_ns;
+
+    /* we upconvert ratio to 0-1023 scale to avoid modular op*/
+    int rat_scaled = ((p->ratio)*1024)/100;
+
+    /* note on data type for page count:
+     * size_t and ssize_t types are used when consistent integer
+     * width is needed across platforms.
+     * 'long' is 64bit on 64bit Linux but 32bit on 64bit Windows so
+     * using long for holding page count doesn't work. On the other hand
+     * using long long type makes life difficult when compiling 32bit.
+     */
+
+    const int unit_shift = p->unit_shift;
+    size_t num_pages = ((uint64_t)p->setsize_mib << 20) >> unit_shift;
+    size_t iter_warmup = 0;
+    int iter_patternlap = 1000000; // draw 1000000
+    void* ctx;
+    size_t base_pfn = 0;
+    struct bm_loop l;
+    struct mlp_draw md;
+    int cow_in_child = 0;
+
+    /* map initialization. all workers finish before anybody goes on */
+    if (p->init_garbage) {
+	sw_reset(&sw, tsops);
+	sw_start(&sw);
+	presult->total_init_bytes = init_thread_maps(tinfo);
+	sw_stop(&sw);
+	presult->total_init_clock = sw.elapsed_sum;
+	thread_sync(TS_INIT_DONE);
+    }
+
+    if (p->topology == TOPO_PARTITION) {
+	num_pages /= p->jobs;
+	base_pfn = num_pages * (tinfo->thread_num - 1);
+    }
+    ctx = pattern->alloc_pattern(num_pages, p->shape, tinfo->thread_num);
+    bm_prepare(&l, tinfo, stats, ctx, base_pfn, num_pages, &rand_ctx_offset, &rand_ctx_action);
+
+    prn("[%d] num_pages: %ld (%ld MiB), shape: %0.4f\n", tinfo->thread_num, num_pages, 
+	    (long)(((uint64_t)num_pages << unit_shift) >> 20), p->shape);
+    sw_reset(&sw, tsops);
+
+    /* do measure pattern generation overhead */
+
+    sw_start(&sw);
+    for (i = 0; i < iter_patternlap; ++i) {
+	pattern->get_next(ctx);
+    }
+
+    sw_stop(&sw);
+
+    presult->total_numgen_clock = sw.elapsed_sum;
+    presult->total_numgen_count = iter_patternlap;
+
+    prn("[%d] Pattern generation overhead: %0.4f usec per drawing\n", tinfo->thread_num, (float)sw_get_usec(&sw)/iter_patternlap); // convert msec to usec
+    sw_reset(&sw, tsops);
+
+    /* take memory information snapshot */
+    if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_before_warmup);
+
+    /* do warmup */
+    if (!p->cold) {
 	iter_warmup = pattern->get_warmup_run ?
 	    pattern->get_warmup_run(ctx) : num_pages;
+	if (l.pctx) iter_warmup *= 2;	// both maps, interleaved
 	    
 	prn("[%d] Performing %ld page accesses for warmup\n",
 		tinfo->thread_num, iter_warmup);
 	sw_start(&sw);
-	for (i = 0; i < iter_warmup; ++i) {
-	    a_addr = calc_address(buf, pattern->get_next(ctx));
+	if (l.features & (BM_MIX | BM_POOL)) bm_warmup(&l, iter_warmup);
+	else for (i = 0; i < iter_warmup; ++i) {
+	    a_addr = calc_address(buf, base_pfn + pattern->get_next(ctx), unit_shift);
 	    a_addr += p->get_offset(&rand_ctx_offset);
 	    is_write = (roll_dice(&rand_ctx_action) % 1024) < rat_scaled ? 0 : 1;
 	    if (is_write && p->write_needs_read) is_write = 2;
@@ -748,75 +3765,1043 @@ void* main_bm_thread(void* arg)
 	    access->exercise(a_addr, is_write);
 	    // don't need to record, don't need to mark long lats
 
-//	    if (p->delay > 10) sys_delay(p->delay); // no delay in warmup..
+//	    if (p->delay > 10) sys_delay(p->delay); // no delay in warmup..
+	}
+	sw_stop(&sw);
+
+	presult->total_warmup_clock = sw.elapsed_sum;
+	presult->total_warmup_count = iter_warmup;
+
+	prn("[%d] Warmup done - took %d us\n", tinfo->thread_num, sw_get_usec(&sw));
+	sw_reset(&sw, tsops);
+
+	if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_before_run);
+    }
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    if (p->prefetch_depth) {
+	bm_prefetch_start(&l, tinfo, num_pages, iter_patternlap + (p->cold ? 0 : iter_warmup));
+    }
+#endif
+    bm_warmup_done(&l, tinfo, &md);
+
+    //out_warmup_interrupted:
+    thread_sync(TS_WARMUP_DONE);
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    /* the others wait at the next sync point, so the fork finds them warm */
+    if (p->cow != COW_NONE && tinfo->thread_num == 1) {
+	cow_in_child = cow_fork(buf, stats);
+	if (cow_in_child && p->cow == COW_BOTH) do_memstat = 0;
+    }
+    /* the child isn't part of the sync. it starts right away */
+    if (!cow_in_child)
+#endif
+    /* main thread collects warmup stats between the two sync points */
+    thread_sync(TS_MAIN_BM_START);
+    if (bm_other_run(&l, tinfo, &md, do_memstat, cow_in_child)) return NULL;
+    prn("[%d] Starting main benchmark\n", tinfo->thread_num);
+
+    tenk = 0;
+
+    done_tsc = (uint64_t)p->duration_sec * freq_khz * 1000;
+    if (do_memstat) alarm_arm(tinfo->thread_num - 1, tsops->timestamp() + (done_tsc / 2), mem_info_oneshot, &mem_ctx);
+    done_tsc += sw_start(&sw);
+	
+    if (l.features) tenk = bm_run_features(&l, done_tsc);
+    else while ((now = tsops->timestamp()) < done_tsc) {
+	alarm_check(now);
+	for (i = 0; i < 10000; ++i) {
+	    a_addr = calc_address(buf, base_pfn + pattern->get_next(ctx), unit_shift);
+	    a_addr += p->get_offset(&rand_ctx_offset);
+	    is_write = (roll_dice(&rand_ctx_action) % 1024) < rat_scaled ? 0 : 1;
+	    if (is_write && p->write_needs_read) is_write = 2;
+
+	    latency_ns = access->exercise(a_addr, is_write);
+
+	    access->record(stats, latency_ns, is_write);
+#ifndef _WIN32
+	    if (params.threshold > 0) mark_long_latency(latency_ns);
+#endif
+	    if (p->delay > 10) sys_delay(p->delay);
+	}
+	tenk++;
+    	if (control.interrupted) break;
+    }
+    sw_stop(&sw);
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    if (l.features & BM_PREFETCH) prefetch_stop(&l.pf);
+#endif
+
+    if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_after_run);
+
+    presult->total_bench_clock = sw.elapsed_sum;
+    presult->total_bench_count = tenk * 10000;
+
+    prn("[%d] Benchmark done - took %0.3f sec for %d page access\n"
+        "  (Average %0.3f usec per page access)\n", tinfo->thread_num,
+	(float)sw_get_usec(&sw)/1000000.0f, tenk*10000,
+	(float)sw_get_usec(&sw)/(tenk*10000));
+
+    pattern->free_pattern(ctx);
+    if (l.pctx) pattern->free_pattern(l.pctx);
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    if (cow_in_child) cow_child_exit(stats, presult);
+#endif
+
+    return NULL;
+}
+
+
+/*
+ * Memory fragmentation preconditioning (--fragment). Before the map, a
+ * region of MIB is faulted in with base pages, huge page by huge page, and
+ * every other page of it is freed again. Free memory is left in single
+ * pages, as on a host that has been up for months. Right after each huge
+ * page worth, some of the freed pages are taken again by mlocked pages and
+ * by pipe buffers, which the kernel can't migrate. All of it is kept until
+ * the end, so THP faults of the map have to compact around it.
+ */
+struct fragment_result fragment_result = { .blocks_before = -1, .blocks_after = -1 };
+
+#ifndef _WIN32
+static char* frag_region;
+static char* frag_pinned;	// mlocked on fault, touched a page at a time
+static size_t frag_pinned_size;
+static int* frag_pipes;		// write and read end of each pipe
+static int frag_pipe_fill, frag_pipe_cap;	// pages in the last pipe, and its capacity
+static int64_t frag_vmstat[5];
+
+static const char* frag_vmstat_keys[] = {
+    "thp_fault_alloc ", "thp_fault_fallback ", "compact_stall ", "compact_fail ", "compact_success ",
+};
+
+/* writes @npages pages of pipe buffers. returns the pages written */
+static
+int64_t fragment_pipe_fill(int64_t npages, const char* page, long pgsz)
+{
+    struct fragment_result* fr = &fragment_result;
+    int64_t done = 0;
+    int fds[2];
+    int* p;
+
+    while (done < npages) {
+	if (fr->pipes == 0 || frag_pipe_fill == frag_pipe_cap) {
+	    if (pipe(fds)) {
+		if (fr->failures++ == 0) perror("fragment pipe");
+		return done;
+	    }
+	    p = realloc(frag_pipes, (fr->pipes + 1) * 2 * sizeof(int));
+	    if (!p) {
+		close(fds[0]);
+		close(fds[1]);
+		return done;
+	    }
+	    frag_pipes = p;
+	    /* as large as pipe-max-size allows. the writes must not block */
+	    fcntl(fds[1], F_SETPIPE_SZ, 1 << 20);
+	    fcntl(fds[1], F_SETFL, O_NONBLOCK);
+	    frag_pipes[fr->pipes * 2] = fds[1];
+	    frag_pipes[fr->pipes * 2 + 1] = fds[0];
+	    frag_pipe_cap = fcntl(fds[1], F_GETPIPE_SZ) / pgsz;
+	    frag_pipe_fill = 0;
+	    fr->pipes++;
+	}
+	/* a full page write takes a page of its own */
+	if (write(frag_pipes[(fr->pipes - 1) * 2], page, pgsz) != pgsz) {
+	    frag_pipe_fill = frag_pipe_cap;
+	    continue;
+	}
+	frag_pipe_fill++;
+	done++;
+    }
+    return done;
+}
+
+static
+__attribute__((cold))
+int fragment_precondition(void)
+{
+    struct fragment_result* fr = &fragment_result;
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const int order = hugepage_shift(HUGEPAGE_DEFAULT) - __builtin_ctzl(pgsz);
+    const size_t npages = ((size_t)params.frag_mib << 20) / pgsz;
+    const size_t chunk = (size_t)1 << order;
+    size_t c, i, end, freed = 0, pinned = 0;
+    int64_t unmovable = 0;
+    char* page;
+
+    fr->blocks_before = sys_free_blocks(order);
+    frag_region = mmap(NULL, npages * pgsz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (frag_region == MAP_FAILED) {
+	perror("fragment mmap");
+	return -1;
+    }
+    madvise(frag_region, npages * pgsz, MADV_NOHUGEPAGE);
+    if (params.frag_pin_pct) {
+	frag_pinned_size = (npages / 2 * params.frag_pin_pct / 100 + 1) * pgsz;
+	frag_pinned = mmap(NULL, frag_pinned_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (frag_pinned == MAP_FAILED) {
+	    perror("fragment mmap");
+	    return -1;
+	}
+	madvise(frag_pinned, frag_pinned_size, MADV_NOHUGEPAGE);
+	if (mlock2(frag_pinned, frag_pinned_size, MLOCK_ONFAULT)) {
+	    perror("fragment mlock2");
+	    fr->failures++;
+	    munmap(frag_pinned, frag_pinned_size);
+	    frag_pinned = NULL;
+	}
+    }
+    page = malloc(pgsz);
+    if (!page) return -1;
+    memset(page, 0x5a, pgsz);
+
+    prn("Fragmenting memory with a %d MiB region\n", params.frag_mib);
+    for (c = 0; c < npages; c += chunk) {
+	end = (c + chunk < npages) ? c + chunk : npages;
+	for (i = c; i < end; i++) frag_region[i * pgsz] = 1;
+	for (i = c + 1; i < end; i += 2) {
+	    if (madvise(frag_region + i * pgsz, pgsz, MADV_DONTNEED)) {
+		if (fr->failures++ == 0) perror("fragment madvise");
+	    } else {
+		freed++;
+	    }
+	}
+	/* the fresh holes are what the next allocations get */
+	for (; frag_pinned && pinned < freed * params.frag_pin_pct / 100; pinned++) {
+	    frag_pinned[pinned * pgsz] = 1;
+	}
+	if ((int64_t)(freed * params.frag_unmov_pct / 100) > unmovable) {
+	    unmovable += fragment_pipe_fill(freed * params.frag_unmov_pct / 100 - unmovable, page, pgsz);
+	}
+    }
+    free(page);
+
+    fr->kept_kib = (int64_t)(npages - freed) * (pgsz >> 10);
+    fr->pinned_kib = (int64_t)pinned * (pgsz >> 10);
+    fr->unmovable_kib = unmovable * (pgsz >> 10);
+    fr->blocks_after = sys_free_blocks(order);
+    for (i = 0; i < 5; i++) frag_vmstat[i] = sys_vmstat_get(frag_vmstat_keys[i]);
+    return 0;
+}
+
+/* THP fault and compaction counts since the preconditioning */
+static
+void fragment_finish(void)
+{
+    struct fragment_result* fr = &fragment_result;
+    int64_t* delta[5] = { &fr->thp_fault_alloc, &fr->thp_fault_fallback,
+	&fr->compact_stall, &fr->compact_fail, &fr->compact_success };
+    int i;
+
+    for (i = 0; i < 5; i++) *delta[i] = sys_vmstat_get(frag_vmstat_keys[i]) - frag_vmstat[i];
+}
+
+static
+void fragment_release(void)
+{
+    int i;
+
+    for (i = 0; i < fragment_result.pipes * 2; i++) close(frag_pipes[i]);
+    free(frag_pipes);
+    if (frag_pinned) munmap(frag_pinned, frag_pinned_size);
+    munmap(frag_region, ((size_t)params.frag_mib << 20));
+}
+#endif
+
+/*
+ * Explicit working set eviction (--evict).
+ * The control thread advises an evenly spread PERCENT of the working set
+ * pages out, once before the run or every evict-interval seconds during it,
+ * so cold accesses are repeatable without having to exhaust memory.
+ */
+static const char* evict_names[] = { "none", "pageout", "cold" };
+
+const char* evict_mode_name(int mode)
+{
+    return evict_names[mode];
+}
+
+struct evict_result evict_result = { .resident_before = -1, .resident_after = -1 };
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+#ifndef MADV_COLD
+#define MADV_COLD 20
+#endif
+#ifndef MADV_PAGEOUT
+#define MADV_PAGEOUT 21
+#endif
+
+/* returns the number of resident pages of the working set. -1 on failure */
+static
+int64_t ws_resident_pages(char* buf, size_t npages, long pgsz)
+{
+    unsigned char* vec;
+    int64_t resident = 0;
+    size_t i;
+
+    vec = malloc(npages);
+    if (!vec) return -1;
+    if (mincore(buf, npages * pgsz, vec)) {
+	perror("mincore");
+	free(vec);
+	return -1;
+    }
+    for (i = 0; i < npages; i++) resident += (vec[i] & 1);
+    free(vec);
+    return resident;
+}
+
+static
+void evict_map(char* buf, size_t npages, long pgsz)
+{
+    const int advice = (params.evict_mode == EVICT_COLD) ? MADV_COLD : MADV_PAGEOUT;
+    const uint64_t pct = params.evict_pct;
+    const size_t nunits = lock_bits ? worker_num_units() : 1;
+    size_t i, run = 0;
+
+    /* page i is picked whenever i*pct/100 steps up. consecutive picks
+     * are coalesced into one madvise call. mlocked pages are skipped */
+    for (i = 0; i <= npages; i++) {
+	if (i < npages && ((i + 1) * pct / 100) > (i * pct / 100) &&
+		!(lock_bits && unit_is_locked(((i * pgsz) >> params.unit_shift) % nunits))) {
+	    run++;
+	    continue;
+	}
+	if (run == 0) continue;
+	if (madvise(buf + (i - run) * pgsz, run * pgsz, advice)) {
+	    if (evict_result.failures++ == 0) perror("evict madvise failed");
+	} else {
+	    evict_result.advised_pages += run;
+	}
+	run = 0;
+    }
+}
+
+static
+void evict_round(char* buf)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const size_t npages = ((uint64_t)params.setsize_mib << 20) / pgsz;
+    const int first = (evict_result.rounds == 0);
+    struct stopwatch sw;
+
+    evict_result.ws_pages = npages;
+    if (first) evict_result.resident_before = ws_resident_pages(buf, npages, pgsz);
+
+    sw_reset(&sw, params.tsops);
+    sw_start(&sw);
+#ifdef PMB_NUMA
+    if (params.affy_head) {
+	struct affy_node* iter;
+	for (iter = params.affy_head; iter != NULL; iter = iter->next) {
+	    evict_map(iter->buf, npages, pgsz);
+	}
+    } else
+#endif
+    evict_map(buf, npages, pgsz);
+    sw_stop(&sw);
+
+    evict_result.total_clock += sw.elapsed_sum;
+    evict_result.rounds++;
+    if (first) evict_result.resident_after = ws_resident_pages(buf, npages, pgsz);
+}
+
+#ifdef PMB_NUMA
+/*
+ * Node-to-node latency matrix (--numa-matrix). Before the run, the main
+ * thread is moved to each node with CPUs in turn and chases pointers
+ * through buffers bound to each node with memory. The memory latency is
+ * taken over every line of a THP backed buffer in random order, so that
+ * the caches miss and the page walks mostly hit. A second, base page
+ * buffer is chased one line of each page, paged out and chased once more,
+ * so each step swaps a page in to the buffer's node.
+ */
+#define NUMA_MATRIX_LINE 64
+
+/* slot i of the chain is line i of the buffer, or a line of page i */
+static inline
+char* numa_matrix_slot(char* buf, size_t i, long stride)
+{
+    if (stride == NUMA_MATRIX_LINE) return buf + i * NUMA_MATRIX_LINE;
+    return buf + i * stride + (i % (stride / NUMA_MATRIX_LINE)) * NUMA_MATRIX_LINE;
+}
+
+static
+void numa_matrix_chain(char* buf, size_t n, long stride, uint64_t* seed)
+{
+    size_t* order;
+    size_t i, j, t;
+
+    order = malloc(n * sizeof(*order));
+    if (!order) {
+	/* linear chain */
+	for (i = 0; i < n; i++) {
+	    *(char**)numa_matrix_slot(buf, i, stride) = numa_matrix_slot(buf, (i + 1) % n, stride);
+	}
+	return;
+    }
+    for (i = 0; i < n; i++) order[i] = i;
+    for (i = n - 1; i > 0; i--) {
+	j = roll_dice(seed) % (i + 1);
+	t = order[i]; order[i] = order[j]; order[j] = t;
+    }
+    for (i = 0; i < n; i++) {
+	*(char**)numa_matrix_slot(buf, order[i], stride) =
+	    numa_matrix_slot(buf, order[(i + 1) % n], stride);
+    }
+    free(order);
+}
+
+/* average clocks of a step of the chain starting at p */
+static
+uint64_t numa_matrix_chase(char* p, size_t steps)
+{
+    struct sys_timestamp* tsops = params.tsops;
+    uint64_t t;
+    size_t i;
+
+    t = tsops->timestamp();
+    for (i = 0; i < steps; i++) p = *(char* volatile*)p;
+    t = tsops->timestamp() - t;
+    sys_barrier();
+    return (p == NULL) ? 0 : t;
+}
+
+/* maps a buffer bound to memory column @col. NULL on failure */
+static
+char* numa_matrix_buf(size_t len, int col, int nodes_ok, int advice)
+{
+    struct numa_matrix_result* mr = &numa_matrix_result;
+    char* buf;
+
+    buf = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+	perror("numa matrix mmap failed");
+	return NULL;
+    }
+    madvise(buf, len, advice);
+    if (nodes_ok) {
+	struct bitmask* mask = numa_allocate_nodemask();
+	int r;
+	numa_bitmask_setbit(mask, mr->mem_node[col]);
+	r = sys_numa_set_policy(buf, len, MEMPOL_REMOTE, mask);
+	numa_free_nodemask(mask);
+	if (r) {
+	    munmap(buf, len);
+	    return NULL;
+	}
+    }
+    return buf;
+}
+
+static
+void numa_matrix_cell(int row, int col, int nodes_ok)
+{
+    struct numa_matrix_result* mr = &numa_matrix_result;
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const size_t len = (size_t)params.numa_matrix_mib << 20;
+    const size_t npages = len / pgsz;
+    const size_t nlines = len / NUMA_MATRIX_LINE;
+    uint64_t seed = row * NUMA_MAX_NODES + col + 1;
+    int64_t resident, thp_kib;
+    char* buf;
+
+    mr->mem_ns[row][col] = -1;
+    mr->swapin_ns[row][col] = -1;
+    mr->swapped_pct[row][col] = 0;
+
+    buf = numa_matrix_buf(len, col, nodes_ok, MADV_HUGEPAGE);
+    if (!buf) return;
+    numa_matrix_chain(buf, nlines, NUMA_MATRIX_LINE, &seed);
+    thp_kib = sys_smaps_get(buf, "AnonHugePages:");
+    if (thp_kib >= 0 && thp_kib * 100 / (int64_t)(len >> 10) < mr->thp_pct) {
+	mr->thp_pct = (int)(thp_kib * 100 / (int64_t)(len >> 10));
+    }
+    /* a pass to warm up the TLB, then two timed ones */
+    numa_matrix_chase(buf, nlines);
+    mr->mem_ns[row][col] = (double)numa_matrix_chase(buf, nlines * 2) * 1000000 /
+	freq_khz / (nlines * 2);
+    munmap(buf, len);
+
+    /* base pages, so that the swap-in is per page */
+    buf = numa_matrix_buf(len, col, nodes_ok, MADV_NOHUGEPAGE);
+    if (!buf) return;
+    numa_matrix_chain(buf, npages, pgsz, &seed);
+    if (madvise(buf, len, MADV_PAGEOUT)) goto out;
+    resident = ws_resident_pages(buf, npages, pgsz);
+    if (resident < 0 || resident == npages) goto out;
+    mr->swapped_pct[row][col] = (int)((npages - resident) * 100 / npages);
+    mr->swapin_ns[row][col] = (double)numa_matrix_chase(buf, npages) * 1000000 /
+	freq_khz / (npages - resident);
+out:
+    munmap(buf, len);
+}
+
+static
+void numa_matrix_run(void)
+{
+    struct numa_matrix_result* mr = &numa_matrix_result;
+    const int nodes_ok = (numa_available() >= 0);
+    struct bitmask* saved = NULL;
+    struct bitmask* cpus;
+    int node, row, col;
+
+    memset(mr, 0, sizeof(*mr));
+    mr->thp_pct = 100;
+    mr->llc_kib = sysconf(_SC_LEVEL3_CACHE_SIZE) >> 10;
+    if (mr->llc_kib <= 0) mr->llc_kib = sysconf(_SC_LEVEL2_CACHE_SIZE) >> 10;
+    if (!nodes_ok) {
+	/* no NUMA in the kernel. a single node 0 with all CPUs and memory */
+	mr->ncpu_nodes = mr->nmem_nodes = 1;
+	mr->distance[0][0] = 10;
+	numa_matrix_cell(0, 0, 0);
+	return;
+    }
+
+    cpus = numa_allocate_cpumask();
+    for (node = 0; node <= numa_max_node() && node < NUMA_MAX_NODES; node++) {
+	if (!numa_bitmask_isbitset(numa_all_nodes_ptr, node)) continue;
+	if (numa_node_size64(node, NULL) > 0) mr->mem_node[mr->nmem_nodes++] = node;
+	if (!numa_node_to_cpus(node, cpus) && numa_bitmask_weight(cpus) > 0) {
+	    mr->cpu_node[mr->ncpu_nodes++] = node;
+	}
+    }
+    numa_free_cpumask(cpus);
+    for (row = 0; row < mr->ncpu_nodes; row++) {
+	for (col = 0; col < mr->nmem_nodes; col++) {
+	    mr->distance[row][col] = numa_distance(mr->cpu_node[row], mr->mem_node[col]);
+	}
+    }
+
+    saved = numa_allocate_cpumask();
+    if (numa_sched_getaffinity(0, saved) < 0) {
+	numa_free_cpumask(saved);
+	saved = NULL;
+    }
+    for (row = 0; row < mr->ncpu_nodes; row++) {
+	if (numa_run_on_node(mr->cpu_node[row])) {
+	    perror("numa_run_on_node failed");
+	    for (col = 0; col < mr->nmem_nodes; col++) {
+		mr->mem_ns[row][col] = mr->swapin_ns[row][col] = -1;
+	    }
+	    continue;
+	}
+	for (col = 0; col < mr->nmem_nodes; col++) numa_matrix_cell(row, col, 1);
+    }
+    if (saved) {
+	numa_sched_setaffinity(0, saved);
+	numa_free_cpumask(saved);
+    } else {
+	numa_run_on_node(-1);
+    }
+}
+#endif
+
+/* control thread repeats eviction while the workers run */
+static
+void evict_periodic(char* buf)
+{
+    const uint64_t interval = (uint64_t)params.evict_interval_sec * freq_khz * 1000;
+    uint64_t now = params.tsops->timestamp();
+    const uint64_t done = now + (uint64_t)params.duration_sec * freq_khz * 1000;
+    uint64_t next = now + interval;
+
+    while (!control.interrupted && (now = params.tsops->timestamp()) < done) {
+	if (now >= next) {
+	    evict_round(buf);
+	    next += interval;
+	    continue;
+	}
+	usleep(100000);
+    }
+}
+
+/*
+ * The antagonist is a forked process, so its footprint is a separate mm
+ * (and is charged to the same cgroup with --cgroup). It follows the cycle
+ * schedule against the clock and logs when each cycle's pressure starts
+ * and when its footprint has been released.
+ */
+#define ANTAG_CHUNK (16UL << 20)
+
+struct antag_log {
+    int cycles;					// cycles released
+    uint64_t onset_tsc[RECOVER_MAX_CYCLES];
+    uint64_t release_tsc[RECOVER_MAX_CYCLES];
+    int64_t peak_kib;
+};
+
+static struct antag_log* antag_log;
+
+/* footprint in bytes at @t clocks into a cycle of @period clocks */
+static
+size_t antagonist_target(uint64_t t, uint64_t period, size_t max)
+{
+    switch (params.antag_shape) {
+    case ANTAG_SQUARE:
+	return (t >= period / 2) ? max : 0;
+    case ANTAG_RAMP:
+	if (t < period / 2) return 0;
+	return (size_t)((double)max * (t - period / 2) / (period - period / 2));
+    case ANTAG_SPIKE:
+	return (t >= period - period / 10) ? max : 0;
+    }
+    return 0;
+}
+
+static
+void antagonist_run(void)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const uint64_t period = (uint64_t)params.antag_period_sec * freq_khz * 1000;
+    const size_t max = (size_t)params.antag_mib << 20;
+    size_t cur = 0, target, off;
+    uint64_t start, done, now;
+    int cycle, active = -1;	// cycle under pressure
+    char* mem;
+
+    /* wait for the main run to start, see timeline_start() */
+    while ((start = *(volatile uint64_t*)&timeline->base_tsc) == 0) usleep(1000);
+    done = start + (uint64_t)params.duration_sec * freq_khz * 1000;
+
+    mem = mmap(NULL, max, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) return;
+
+    /* grows a chunk at a time so that a slow fill doesn't miss the release */
+    while ((now = params.tsops->timestamp()) < done) {
+	cycle = (now - start) / period;
+	target = antagonist_target((now - start) % period, period, max) & ~(size_t)(pgsz - 1);
+	if (target > cur) {
+	    if (cur == 0 && cycle < RECOVER_MAX_CYCLES) {
+		active = cycle;
+		antag_log->onset_tsc[active] = now;
+	    }
+	    if (target - cur > ANTAG_CHUNK) target = cur + ANTAG_CHUNK;
+	    for (off = cur; off < target; off += pgsz) mem[off] = 1;
+	    if ((int64_t)(target >> 10) > antag_log->peak_kib) antag_log->peak_kib = target >> 10;
+	    cur = target;
+	    continue;
+	}
+	if (target < cur) {
+	    madvise(mem + target, cur - target, MADV_DONTNEED);
+	    cur = target;
+	    if (cur == 0 && active >= 0) {
+		antag_log->release_tsc[active] = params.tsops->timestamp();
+		antag_log->cycles = active + 1;
+		active = -1;
+	    }
+	}
+	usleep(10000);
+    }
+    munmap(mem, max);
+}
+
+static pid_t antag_child = -1;
+static pid_t antag_parent;
+
+/* the antagonist waits for a timeline that an early exit never starts */
+static
+void antagonist_reap(void)
+{
+    if (antag_child > 0 && getpid() == antag_parent) {
+	kill(antag_child, SIGKILL);
+	waitpid(antag_child, NULL, 0);
+	antag_child = -1;
+    }
+}
+
+/*
+ * forks the antagonist. This is done before the workers populate the map,
+ * so the fork doesn't have to copy its page tables. It is reaped at exit
+ * unless antagonist_stop() got to it first.
+ */
+static
+pid_t antagonist_start(void)
+{
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == -1) {
+	perror("antagonist fork");
+	return -1;
+    }
+    if (pid == 0) {
+	antagonist_run();
+	_exit(0);
+    }
+    antag_child = pid;
+    antag_parent = getpid();
+    atexit(antagonist_reap);
+    return pid;
+}
+
+/* starts the timeline, and with it the antagonist's schedule */
+static
+void timeline_start(void)
+{
+    if (timeline) timeline->base_tsc = params.tsops->timestamp();
+}
+
+/* p99 of the timeline merged over all workers and intervals [@from, @to) */
+static
+double timeline_p99(size_t from, size_t to)
+{
+    uint64_t count[TL_BINS] = { 0 };
+    uint64_t total = 0, sum = 0, at;
+    size_t w, s;
+    int b;
+
+    if (to > timeline->nslots) to = timeline->nslots;
+    for (w = 0; w < params.jobs; w++) {
+	for (s = from; s < to; s++) {
+	    const uint32_t* bins = timeline->bins + (w * timeline->nslots + s) * TL_BINS;
+	    for (b = 0; b < TL_BINS; b++) count[b] += bins[b];
 	}
-	sw_stop(&sw);
-
-	presult->total_warmup_clock = sw.elapsed_sum;
-	presult->total_warmup_count = iter_warmup;
+    }
+    for (b = 0; b < TL_BINS; b++) total += count[b];
+    if (total == 0) return -1.0;
+    at = total - total / 100;
+    for (b = 0; b < TL_BINS; b++) {
+	sum += count[b];
+	if (sum >= at) return tl_bin_mid(b);
+    }
+    return -1.0;
+}
 
-	prn("[%d] Warmup done - took %d us\n", tinfo->thread_num, sw_get_usec(&sw));
-	sw_reset(&sw, tsops);
+static
+size_t timeline_slot(uint64_t tsc)
+{
+    return (tsc - timeline->base_tsc) / timeline->interval_clk;
+}
 
-	if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_before_run);
+/*
+ * stops the antagonist and works out the time to recover of each cycle:
+ * from the release until the end of the first interval whose p99 is back
+ * within recover_pct of the p99 before the first onset.
+ */
+static
+void antagonist_stop(pid_t pid)
+{
+    struct recover_result* rr = &recover_result;
+    const double limit_scale = 1.0 + params.recover_pct / 100.0;
+    size_t s, first, end;
+    double p99;
+    int c;
+
+    if (pid > 0) {
+	kill(pid, SIGKILL);
+	waitpid(pid, NULL, 0);
+	antag_child = -1;
+    }
+    rr->cycles = antag_log->cycles;
+    rr->peak_kib = antag_log->peak_kib;
+    rr->baseline_p99_ns = -1.0;
+    if (antag_log->onset_tsc[0]) {
+	rr->baseline_p99_ns = timeline_p99(0, timeline_slot(antag_log->onset_tsc[0]));
+    }
+    for (c = 0; c < rr->cycles; c++) {
+	rr->peak_p99_ns[c] = -1.0;
+	rr->recover_ms[c] = -1;
+	if (!antag_log->onset_tsc[c] || !antag_log->release_tsc[c]) continue;
+	for (s = timeline_slot(antag_log->onset_tsc[c]); s <= timeline_slot(antag_log->release_tsc[c]); s++) {
+	    p99 = timeline_p99(s, s + 1);
+	    if (p99 > rr->peak_p99_ns[c]) rr->peak_p99_ns[c] = p99;
+	}
+	if (rr->baseline_p99_ns < 0) continue;
+	/* look until the next onset, or the end of the run */
+	first = timeline_slot(antag_log->release_tsc[c]) + 1;
+	end = (c + 1 < RECOVER_MAX_CYCLES && antag_log->onset_tsc[c + 1]) ?
+	    timeline_slot(antag_log->onset_tsc[c + 1]) : timeline->nslots;
+	for (s = first; s < end; s++) {
+	    p99 = timeline_p99(s, s + 1);
+	    if (p99 >= 0 && p99 <= rr->baseline_p99_ns * limit_scale) {
+		rr->recover_ms[c] = (int64_t)((timeline->base_tsc + (s + 1) * timeline->interval_clk -
+			    antag_log->release_tsc[c]) / freq_khz);
+		break;
+	    }
+	}
     }
+}
 
-    //out_warmup_interrupted:
-    thread_sync(TS_WARMUP_DONE);
-    /* main thread collects warmup stats between the two sync points */
-    thread_sync(TS_MAIN_BM_START);
-    prn("[%d] Starting main benchmark\n", tinfo->thread_num);
+/* allocates the timeline and the antagonist log, shared with worker processes */
+static
+int antagonist_alloc(void)
+{
+    const size_t nslots = (size_t)params.duration_sec * 1000 / TIMELINE_MS + 1;
+    const size_t size = sizeof(struct timeline) + nslots * params.jobs * TL_BINS * sizeof(uint32_t);
+
+    timeline = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    antag_log = mmap(NULL, sizeof(*antag_log), PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+    if (timeline == MAP_FAILED || antag_log == MAP_FAILED) {
+	timeline = NULL;
+	return -1;
+    }
+    timeline->nslots = nslots;
+    timeline->interval_clk = (uint64_t)TIMELINE_MS * freq_khz;
+    return 0;
+}
 
-    tenk = 0;
+#ifndef MADV_FREE
+#define MADV_FREE 8
+#endif
 
-    done_tsc = (uint64_t)p->duration_sec * freq_khz * 1000;
-    if (do_memstat) alarm_arm(tinfo->thread_num - 1, tsops->timestamp() + (done_tsc / 2), mem_info_oneshot, &mem_ctx);
-    done_tsc += sw_start(&sw);
-	
-    while ((now = tsops->timestamp()) < done_tsc) {
-	alarm_check(now);
-	for (i = 0; i < 10000; ++i) {
-	    a_addr = calc_address(buf, pattern->get_next(ctx));
-	    a_addr += p->get_offset(&rand_ctx_offset);
-	    is_write = (roll_dice(&rand_ctx_action) % 1024) < rat_scaled ? 0 : 1;
-	    if (is_write && p->write_needs_read) is_write = 2;
+/* units of the whole working set of the shared map */
+static
+size_t churn_num_units(void)
+{
+    return ((uint64_t)params.setsize_mib << 20) >> params.unit_shift;
+}
 
-	    latency_ns = access->exercise(a_addr, is_write);
+static
+__attribute__((cold))
+int churn_prepare(void)
+{
+    const size_t n = churn_num_units();
 
-	    access->record(stats, latency_ns, is_write);
-#ifndef _WIN32
-	    if (params.threshold > 0) mark_long_latency(latency_ns);
-#endif
-	    if (p->delay > 10) sys_delay(p->delay);
-	}
-	tenk++;
-    	if (control.interrupted) break;
-    }
-    sw_stop(&sw);
+    churn_bits = calloc((n + CHURN_WORD_BITS - 1) / CHURN_WORD_BITS, sizeof(unsigned long));
+    return churn_bits ? 0 : -1;
+}
 
-    if (do_memstat) sys_stat_mem_update(&mem_ctx, &mem_info_after_run);
+static
+void churn_mark(size_t first, size_t count)
+{
+    size_t u;
 
-    presult->total_bench_clock = sw.elapsed_sum;
-    presult->total_bench_count = tenk * 10000;
+    for (u = first; u < first + count; u++) {
+	__atomic_fetch_or(&churn_bits[u / CHURN_WORD_BITS], 1UL << (u % CHURN_WORD_BITS),
+		__ATOMIC_RELAXED);
+    }
+}
 
-    prn("[%d] Benchmark done - took %0.3f sec for %d page access\n"
-        "  (Average %0.3f usec per page access)\n", tinfo->thread_num,
-	(float)sw_get_usec(&sw)/1000000.0f, tenk*10000,
-	(float)sw_get_usec(&sw)/(tenk*10000));
+/* performs one churn operation on the range. 0 on success */
+static
+int churn_op(char* addr, size_t len, int op, uint64_t seed)
+{
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | hugepage_map_flags(params.hugepage);
+    const int prot = PROT_READ | (params.ratio < 100 ? PROT_WRITE : 0);
+    void* p;
+
+    switch (op) {
+    case CHURN_DONTNEED:
+	return madvise(addr, len, MADV_DONTNEED);
+    case CHURN_FREE:
+	return madvise(addr, len, MADV_FREE);
+    case CHURN_REMAP:
+	if (mmap(addr, len, PROT_READ|PROT_WRITE, flags | MAP_FIXED, -1, 0) == MAP_FAILED) return -1;
+	return hugepage_advise(addr, len, params.hugepage);
+    case CHURN_MREMAP:
+	/* the data moves in with its page tables, nothing is left to refault */
+	p = mmap(NULL, len, PROT_READ|PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED) return -1;
+	hugepage_advise(p, len, params.hugepage);
+	if (params.content) content_fill(p, len);
+	else fill_garbage(p, len, seed);
+	if (mremap(p, len, len, MREMAP_MAYMOVE | MREMAP_FIXED, addr) == MAP_FAILED) {
+	    munmap(p, len);
+	    return -1;
+	}
+	return 0;
+    case CHURN_MPROTECT:
+	/* the workers keep their access. only the NX bit of the ptes changes */
+	if (mprotect(addr, len, prot | PROT_EXEC)) return -1;
+	return mprotect(addr, len, prot);
+    }
+    return -1;
+}
 
-    pattern->free_pattern(ctx);
+/*
+ * churn agent thread. Runs the enabled operations round robin at the
+ * given rate on random ranges of the working set, for the main run.
+ */
+static
+void* churn_thread(void* arg)
+{
+    char* buf = arg;
+    const size_t unit = (size_t)1 << params.unit_shift;
+    const size_t ws = (uint64_t)params.setsize_mib << 20;
+    const uint64_t interval = (uint64_t)freq_khz * 1000 / params.churn_rate;
+    struct churn_result* cr = &churn_result;
+    size_t len = ((size_t)params.churn_kib << 10) & ~(unit - 1);
+    size_t nranges, first;
+    uint64_t start, done, now, next, clk, seed = 0;
+    int64_t tlb;
+    int op = 0, b;
+
+    if (len < unit) len = unit;
+    if (len > ws) len = ws;
+    nranges = ws / len;
+
+    tlb = sys_tlb_shootdowns();
+    start = next = params.tsops->timestamp();
+    done = start + (uint64_t)params.duration_sec * freq_khz * 1000;
+    while (!control.interrupted && (now = params.tsops->timestamp()) < done) {
+	if (now < next) {
+	    if (next - now >= freq_khz / 20) usleep((next - now) * 1000 / freq_khz);
+	    continue;
+	}
+	/* don't make up for more than a second of lag in a burst */
+	next = (now - next > interval * params.churn_rate) ? now + interval : next + interval;
+
+	while (!(params.churn_ops & (1 << op))) op = (op + 1) % CHURN_NR_OPS;
+	first = (size_t)(roll_dice(&seed) % nranges) * (len / unit);
+	__atomic_add_fetch(&churn_seq, 1, __ATOMIC_RELEASE);
+	now = params.tsops->timestamp();
+	if (churn_op(buf + first * unit, len, op, seed)) {
+	    if (cr->failures++ == 0) perror("churn operation failed");
+	} else {
+	    cr->ops[op]++;
+	    if (op != CHURN_MREMAP && op != CHURN_MPROTECT) churn_mark(first, len / unit);
+	}
+	clk = params.tsops->timestamp() - now;
+	__atomic_add_fetch(&churn_seq, 1, __ATOMIC_RELEASE);
+	cr->clock[op] += clk;
+	if (clk > cr->clock_max[op]) cr->clock_max[op] = clk;
+	clk = clk * 1000 / freq_khz;	// us
+	b = clk ? 64 - __builtin_clzll(clk) : 0;
+	cr->lat_bins[op][b < CHURN_LAT_BINS ? b : CHURN_LAT_BINS - 1]++;
+	op = (op + 1) % CHURN_NR_OPS;
+    }
+    cr->run_clock = params.tsops->timestamp() - start;
+    cr->tlb_shootdowns = (tlb >= 0) ? sys_tlb_shootdowns() - tlb : -1;
+    return NULL;
+}
 
+/* the dirty writeback agent samples the dirty state every WB_SAMPLE_MS */
+static
+void* wb_sample_thread(void* arg)
+{
+    struct writeback_result* wr = &writeback_result;
+    const uint64_t sample_clk = (uint64_t)WB_SAMPLE_MS * freq_khz;
+    uint64_t start, done, now, next;
+    const int max_samples = params.duration_sec * (1000 / WB_SAMPLE_MS) + 1;
+    int64_t dirty, writeback, thresh, bg_thresh;
+    int throttling;
+
+    wr->thresh_kib = wr->bg_thresh_kib = -1;
+    wr->samples = calloc(max_samples, sizeof(struct wb_sample));
+    if (!wr->samples) perror("writeback agent calloc failed");
+    start = next = params.tsops->timestamp();
+    done = start + (uint64_t)params.duration_sec * freq_khz * 1000;
+    while (!control.interrupted && (now = params.tsops->timestamp()) < done) {
+	if (now < next) {
+	    usleep((next - now) * 1000 / freq_khz);
+	    continue;
+	}
+	next = (next + sample_clk <= now) ? now + sample_clk : next + sample_clk;
+	if (sys_dirty_state(&dirty, &writeback, &thresh, &bg_thresh)) continue;
+
+	throttling = (thresh > 0 && dirty + writeback >= (thresh + bg_thresh) / 2);
+	__atomic_store_n(&wb_throttling, throttling, __ATOMIC_RELAXED);
+	if (wr->thresh_kib < 0) {
+	    wr->thresh_kib = thresh;
+	    wr->bg_thresh_kib = bg_thresh;
+	}
+	wr->throttle_samples += throttling;
+	if (wr->samples && wr->nsamples < max_samples) {
+	    struct wb_sample* ws = &wr->samples[wr->nsamples++];
+	    ws->ms = (now - start) / freq_khz;
+	    ws->dirty_kib = dirty;
+	    ws->writeback_kib = writeback;
+	}
+    }
+    __atomic_store_n(&wb_throttling, 0, __ATOMIC_RELAXED);
     return NULL;
 }
 
+/* and a second thread syncs the map every sync_ms, counted from the end of
+ * the previous sync as a storage engine would checkpoint */
+static
+void* wb_sync_thread(void* arg)
+{
+    char* buf = arg;
+    struct writeback_result* wr = &writeback_result;
+    const uint64_t sync_clk = (uint64_t)params.sync_ms * freq_khz;
+    uint64_t done, now, next, clk;
+    int fd = -1, ret;
+
+    if (params.sync_mode == SYNC_FDATASYNC) {
+	fd = open(get_backing_info()->path, O_RDWR);
+	if (fd == -1) {
+	    perror("writeback agent open failed");
+	    wr->failures++;
+	    return NULL;
+	}
+    }
+    next = params.tsops->timestamp() + sync_clk;
+    done = next - sync_clk + (uint64_t)params.duration_sec * freq_khz * 1000;
+    while (!control.interrupted && (now = params.tsops->timestamp()) < done) {
+	if (now < next) {
+	    usleep((next - now) * 1000 / freq_khz);
+	    continue;
+	}
+	clk = params.tsops->timestamp();
+	if (params.sync_mode == SYNC_MSYNC) ret = msync(buf, (size_t)params.mapsize_mib << 20, MS_SYNC);
+	else ret = fdatasync(fd);
+	clk = params.tsops->timestamp() - clk;
+	if (ret) {
+	    if (wr->failures++ == 0) perror("writeback agent sync failed");
+	} else {
+	    wr->syncs++;
+	    wr->sync_clock += clk;
+	    if (clk > wr->sync_clock_max) wr->sync_clock_max = clk;
+	}
+	next = params.tsops->timestamp() + sync_clk;
+    }
+    if (fd != -1) close(fd);
+    return NULL;
+}
+#endif
 
-#define handle_error_en(en, msg) \
-    do { errno = en; perror(msg); exit(EXIT_FAILURE); } while (0)
+#ifdef PMB_THREAD
+/*
+ * releases the snapshot and reaps the child. A child that ran in place
+ * of worker 1 hands worker 1 its result.
+ */
+static
+void cow_stop(struct thread_info* tinfo)
+{
+    int status, i;
+
+    if (cow_pipe != -1) close(cow_pipe);
+    if (cow_result.pid <= 0) return;
+    /* ctrl-c reaches the child too. it winds up the run and exits */
+    while ((i = waitpid(cow_result.pid, &status, 0)) == -1 && errno == EINTR);
+    if (i == -1) {
+	perror("cow waitpid");
+	return;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+	prn("COW child exited abnormally\n");
+	return;
+    }
+    if (params.cow == COW_CHILD) {
+	for (i = 0; i <= num_access_class; i++) {
+	    memcpy(access_class_plane(control.stats, i), access_class_plane(cow_child->stats, i), PAGE_SIZE);
+	}
+	tinfo[0].result = cow_child->result;
+	mem_info_middle_run = cow_child->mem_info[0];
+	mem_info_after_run = cow_child->mem_info[1];
+    } else if (params.cow == COW_BOTH) {
+	cow_result.child = cow_child->result;
+    }
+}
 
-#define handle_error(msg) \
-    do { perror(msg); exit(EXIT_FAILURE); } while (0)
+/* per-thread map for the private and mix topologies */
+static
+char* alloc_private_map(void)
+{
+    const size_t map_num_pfn = (size_t)params.mapsize_mib * 256;
+    int permissions = PROT_READ;
+    char* pmap;
+
+    if (params.ratio < 100) permissions |= PROT_WRITE;
+    pmap = params.backing->map(map_num_pfn * PAGE_SIZE, permissions);
+    if (pmap == NULL) exit(EXIT_FAILURE);
+    return pmap;
+}
 
-#ifdef PMB_THREAD
 /*
  * For multi-threaded bm, we have 1 control thread and n worker threads.
  * The control thread (perform_benchmark_mt) does not participate in 
@@ -836,8 +4821,15 @@ perform_benchmark_mt(char *buf, char *stats)
 #ifdef PMB_NUMA
     struct affy_node* iter;
 #endif
+#ifndef _WIN32
+    pthread_t churn_tid;
+    pthread_t wb_tid[2];
+#endif
+
+    static pthread_barrier_t barrier;
 
-    pthread_barrier_init(&control.barrier, NULL, num_threads + 1);
+    pthread_barrier_init(&barrier, NULL, num_threads + 1);
+    control.barrier = &barrier;
     control.stats = stats;
 
     s = pthread_attr_init(&attr);
@@ -864,6 +4856,8 @@ perform_benchmark_mt(char *buf, char *stats)
 	    for (j = 0; j < iter->nthreads; j++) {
 		tinfo[i].thread_num = i + 1;
 		tinfo[i].map = iter->buf;
+		tinfo[i].init_index = j;
+		tinfo[i].init_count = iter->nthreads;
 		reset_result(&tinfo[i].result);
 
 		s = pthread_create(&tinfo[i].thread_id, &attr,
@@ -878,6 +4872,16 @@ perform_benchmark_mt(char *buf, char *stats)
     	tinfo[i].thread_num = i + 1;
     	reset_result(&tinfo[i].result);
 	tinfo[i].map = buf;
+	tinfo[i].init_index = i;
+	tinfo[i].init_count = num_threads;
+	if (params.topology == TOPO_PRIVATE || params.topology == TOPO_MIX) {
+	    tinfo[i].pmap = alloc_private_map();
+	    if (params.topology == TOPO_PRIVATE) {
+		tinfo[i].map = tinfo[i].pmap;
+		tinfo[i].init_index = 0;
+		tinfo[i].init_count = 1;
+	    }
+	}
 
     	s = pthread_create(&tinfo[i].thread_id, &attr,
     			&main_bm_thread, &tinfo[i]);
@@ -887,9 +4891,17 @@ perform_benchmark_mt(char *buf, char *stats)
     s = pthread_attr_destroy(&attr);
     if (s != 0) handle_error_en(s, "pthread_attr_destroy");
 
+    /* the workers initialize the maps before anything else */
+    if (params.init_garbage) thread_sync(TS_INIT_DONE);
+
     /* sync on warmup finish */
     thread_sync(TS_WARMUP_DONE);
 
+    if (map_sample_needed()) map_sample(tinfo[0].map, &map_sample_before_run);
+#ifndef _WIN32
+    if (params.bufpool) bufpool_stat_reset();
+#endif
+
     /* check again for ctrl-c interruption */
     if (control.interrupted) {
 	// the benchmark is interrupted during warmup, we just bail the program..
@@ -897,25 +4909,216 @@ perform_benchmark_mt(char *buf, char *stats)
 	exit(EXIT_FAILURE);
     }
 
+#ifndef _WIN32
+    if (params.evict_mode != EVICT_NONE) {
+	prn("Evicting %d%% of the working set (%s)\n", params.evict_pct,
+		evict_mode_name(params.evict_mode));
+	evict_round(tinfo[0].map);
+    }
+#endif
+
     // release the hounds - synchronize all threads to start main bm
+#ifndef _WIN32
+    timeline_start();
+#endif
     thread_sync(TS_MAIN_BM_START);
 
+#ifndef _WIN32
+    if (churn_bits) {
+	s = pthread_create(&churn_tid, NULL, churn_thread, tinfo[0].map);
+	if (s != 0) handle_error_en(s, "pthread_create");
+    }
+    if (params.sync_ms) {
+	s = pthread_create(&wb_tid[0], NULL, wb_sample_thread, NULL);
+	if (s != 0) handle_error_en(s, "pthread_create");
+	if (params.sync_mode != SYNC_NONE) {
+	    s = pthread_create(&wb_tid[1], NULL, wb_sync_thread, tinfo[0].map);
+	    if (s != 0) handle_error_en(s, "pthread_create");
+	}
+    }
+    if (params.evict_mode != EVICT_NONE && params.evict_interval_sec > 0) {
+	evict_periodic(tinfo[0].map);
+    }
+#endif
+
     /* join workers to finish */
     for (i = 0; i < num_threads; i++) {
 	s = pthread_join(tinfo[i].thread_id, &res);
 	if (s != 0) handle_error_en(s, "pthread_join");
     }
+#ifndef _WIN32
+    if (churn_bits) {
+	s = pthread_join(churn_tid, &res);
+	if (s != 0) handle_error_en(s, "pthread_join");
+    }
+    if (params.sync_ms) {
+	for (i = 0; i < (params.sync_mode != SYNC_NONE ? 2 : 1); i++) {
+	    s = pthread_join(wb_tid[i], &res);
+	    if (s != 0) handle_error_en(s, "pthread_join");
+	}
+    }
+    if (params.cow != COW_NONE) cow_stop(tinfo);
+#endif
+    /* before the private maps go, tinfo[0].map is one of them */
+    if (map_sample_needed()) map_sample(tinfo[0].map, &map_sample_after_run);
+
+    for (i = 0; i < num_threads; i++) {
+	if (tinfo[i].pmap) {
+	    params.backing->unmap(tinfo[i].pmap, (size_t)params.mapsize_mib << 20);
+	}
+    }
     prn("All threads joined\n");
 
     // finish collapses per-thread stats into one
     if (num_threads > 1) {
-	params.access->finish(control.stats, num_threads);
+	for (i = 0; i <= num_access_class; i++) {
+	    params.access->finish(access_class_plane(control.stats, i), num_threads);
+	}
+    }
+
+    if (control.interrupted) { 
+	prn("Benchmark interrupted during run - partial report will be generated\n"); 
+    }
+}
+
+#ifndef _WIN32
+/*
+ * Multi-process bm (--procs). Each worker is a forked process with its own
+ * address space and its own map. The barrier, results and histograms live
+ * in shared mappings so the control process coordinates and aggregates
+ * them the same way as in the mt case.
+ */
+struct mp_shared {
+    pthread_barrier_t barrier;
+    int map_failed;			// a worker couldn't create its map
+    sys_mem_item mem_info[4];		// snapshots taken by worker 1
+    struct map_sample map_sample_before_run;
+    struct map_sample map_sample_after_run;
+};
+
+static
+void bm_process(struct thread_info* tinfo, struct mp_shared* shared)
+{
+    const size_t map_num_pfn = (size_t)params.mapsize_mib * 256;
+    int permissions = PROT_READ;
+
+    if (params.ratio < 100) permissions |= PROT_WRITE;
+    tinfo->map = params.backing->map(map_num_pfn * PAGE_SIZE, permissions);
+    if (tinfo->map == NULL) {
+	/* let the control process know, then get through the sync points */
+	shared->map_failed = 1;
+	if (params.init_garbage) thread_sync(TS_INIT_DONE);
+	thread_sync(TS_WARMUP_DONE);
+	thread_sync(TS_MAIN_BM_START);
+	return;
+    }
+    tinfo->init_index = 0;
+    tinfo->init_count = 1;
+    main_bm_thread(tinfo);
+
+    if (tinfo->thread_num == 1) {
+	if (map_sample_needed()) map_sample(tinfo->map, &shared->map_sample_after_run);
+	shared->map_sample_before_run = map_sample_before_run;
+	shared->mem_info[0] = mem_info_before_warmup;
+	shared->mem_info[1] = mem_info_before_run;
+	shared->mem_info[2] = mem_info_middle_run;
+	shared->mem_info[3] = mem_info_after_run;
+    }
+    params.backing->unmap(tinfo->map, map_num_pfn * PAGE_SIZE);
+}
+
+void perform_benchmark_mp(char *stats)
+{
+    const int num_procs = params.procs;
+    struct thread_info *tinfo;
+    struct mp_shared* shared;
+    pthread_barrierattr_t attr;
+    pid_t* pids;
+    int i, status;
+
+    shared = mmap(NULL, sizeof(*shared), PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) handle_error("mp shared mmap");
+    tinfo = mmap(NULL, num_procs * sizeof(struct thread_info), PROT_READ | PROT_WRITE,
+	    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (tinfo == MAP_FAILED) handle_error("mp tinfo mmap");
+    pids = calloc(num_procs, sizeof(pid_t));
+    if (pids == NULL) handle_error("calloc");
+
+    pthread_barrierattr_init(&attr);
+    pthread_barrierattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_barrier_init(&shared->barrier, &attr, num_procs + 1);
+    pthread_barrierattr_destroy(&attr);
+    control.barrier = &shared->barrier;
+    control.stats = stats;
+
+    fflush(stdout);
+    for (i = 0; i < num_procs; i++) {
+	tinfo[i].thread_num = i + 1;
+	reset_result(&tinfo[i].result);
+
+	pids[i] = fork();
+	if (pids[i] == -1) handle_error("fork");
+	if (pids[i] == 0) {
+	    bm_process(&tinfo[i], shared);
+	    fflush(stdout);
+	    _exit(0);
+	}
+    }
+
+    if (params.init_garbage) thread_sync(TS_INIT_DONE);
+
+    /* sync on warmup finish */
+    thread_sync(TS_WARMUP_DONE);
+
+    if (shared->map_failed || control.interrupted) {
+	if (shared->map_failed) prn("A worker process failed to create its map\n");
+	else prn("Benchmark terminated during warmup - report will not be generated\n");
+	for (i = 0; i < num_procs; i++) kill(pids[i], SIGKILL);
+	exit(EXIT_FAILURE);
+    }
+
+    // release the hounds - synchronize all processes to start main bm
+    timeline_start();
+    thread_sync(TS_MAIN_BM_START);
+
+    for (i = 0; i < num_procs; i++) {
+	if (waitpid(pids[i], &status, 0) == -1) handle_error("waitpid");
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+	    prn("Worker process %d exited abnormally\n", i + 1);
+	}
+    }
+    prn("All processes joined\n");
+
+    mem_info_before_warmup = shared->mem_info[0];
+    mem_info_before_run = shared->mem_info[1];
+    mem_info_middle_run = shared->mem_info[2];
+    mem_info_after_run = shared->mem_info[3];
+    map_sample_before_run = shared->map_sample_before_run;
+    map_sample_after_run = shared->map_sample_after_run;
+
+    /* the rest of the code frees control.tinfo */
+    control.tinfo = calloc(num_procs, sizeof(struct thread_info));
+    if (control.tinfo == NULL) handle_error("calloc");
+    memcpy(control.tinfo, tinfo, num_procs * sizeof(struct thread_info));
+
+    pthread_barrier_destroy(&shared->barrier);
+    munmap(tinfo, num_procs * sizeof(struct thread_info));
+    munmap(shared, sizeof(*shared));
+    free(pids);
+
+    // finish collapses per-process stats into one
+    if (num_procs > 1) {
+	for (i = 0; i <= num_access_class; i++) {
+	    params.access->finish(access_class_plane(control.stats, i), num_procs);
+	}
     }
 
     if (control.interrupted) { 
 	prn("Benchmark interrupted during run - partial report will be generated\n"); 
     }
 }
+#endif
 #else 
 extern void perform_benchmark_st(char *buf, char *stats) _code;
 void
@@ -927,6 +5130,7 @@ perform_benchmark_st(char *buf, char *stats)
     if (tinfo == NULL) exit(EXIT_FAILURE);
     tinfo->thread_num = 1;
     tinfo->map = buf;
+    tinfo->init_count = 1;
     reset_result(&tinfo->result);
 
     control.tinfo = tinfo;
@@ -934,6 +5138,8 @@ perform_benchmark_st(char *buf, char *stats)
     control.interrupted = 0;
 
     main_bm_thread((void*)tinfo);
+
+    if (map_sample_needed()) map_sample(buf, &map_sample_after_run);
 }
 #endif
 
@@ -1067,9 +5273,14 @@ extern void print_xml_report_post_unmap(const char* path);
 int main(int argc, char** argv)
 {
     size_t map_num_pfn; 
+    size_t stats_size;
     int ret;
+    int run_failed = 0;
 
     char *buf, *stats;
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    pid_t antag_pid = -1;
+#endif
 #ifdef XALLOC
     printf("Sorry, this version does not support XALLOC!\n");
     return 1;
@@ -1077,6 +5288,8 @@ int main(int argc, char** argv)
 #endif
     set_default_params(&params);
     params_parsing(argc, argv);
+    // 1 page per thread for each access class plane
+    stats_size = (size_t)PAGE_SIZE * params.jobs * (1 + num_access_class);
     disable_core_dump();
 
 //test_parse_numa_option();
@@ -1099,9 +5312,35 @@ int main(int argc, char** argv)
     }
     perfc_ops.init_base_freq(&perfc_ops);
 #else
-    if (sysconf(_SC_PAGESIZE) != 4096) {
-	prn("ERROR: system page size is not 4K.\n");
-    	return 1;
+    {
+	/* base page unit follows the system page size */
+	long pgsz = sysconf(_SC_PAGESIZE);
+	if (pgsz < 4096 || (pgsz & (pgsz - 1))) {
+	    prn("ERROR: unsupported system page size %ld.\n", pgsz);
+	    return 1;
+	}
+	if (!params.unit_huge) params.unit_shift = __builtin_ctzl(pgsz);
+    }
+    if (params.hugepage != HUGEPAGE_DEFAULT || params.unit_huge) {
+	sys_stat_mem_ext_enable(SYS_MEM_GRP_THP);
+    }
+    if (map_is_shmem(&params)) sys_stat_mem_ext_enable(SYS_MEM_GRP_SHMEM);
+    if (params.sync_ms) sys_stat_mem_ext_enable(SYS_MEM_GRP_DIRTY);
+
+    /* the fragments stay outside of the sandbox, and the map is made around them */
+    if (params.frag_mib) {
+	sys_stat_mem_ext_enable(SYS_MEM_GRP_THP | SYS_MEM_GRP_COMPACT);
+	if (fragment_precondition()) return 1;
+    }
+
+    /* enter the sandbox before anything gets charged */
+    if (params.cgroup) {
+	if (sys_cgroup_create(params.cgroup_parent, params.cg_max_mib,
+		    params.cg_high_mib, params.cg_swap_max_mib)) {
+	    prn("ERROR: failed to set up the cgroup sandbox.\n");
+	    return 1;
+	}
+	sys_stat_mem_ext_enable(SYS_MEM_GRP_CGROUP);
     }
 #endif
     rdtsc_ops.init_base_freq(&rdtsc_ops);
@@ -1109,6 +5348,10 @@ int main(int argc, char** argv)
 
     freq_khz = params.tsops->base_freq_khz;
 
+#ifdef PMB_NUMA
+    if (params.numa_matrix_mib) numa_matrix_run();
+#endif
+
     map_num_pfn = params.mapsize_mib * 256;
 
 #ifdef XALLOC
@@ -1149,7 +5392,7 @@ int main(int argc, char** argv)
 	    return 1;
 	}
 
-	stats = VirtualAlloc(NULL, PAGE_SIZE * params.jobs, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+	stats = VirtualAlloc(NULL, stats_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
 	if (stats == NULL) {
 	    ret = GetLastError();
 	    prn("stats VirtualAlloc failed. Error:%d\n", ret);
@@ -1164,7 +5407,7 @@ int main(int argc, char** argv)
 
 	    // memory for histogram. 
 	    // 1 page per thread; read and write statistics get 2k each
-	    stats = mmap(NULL, (size_t)(PAGE_SIZE * params.jobs), 
+	    stats = mmap(NULL, stats_size, 
 		    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); 
 	    if (stats == MAP_FAILED) {
 		perror("stats mmap failed");
@@ -1174,7 +5417,7 @@ int main(int argc, char** argv)
 #ifndef MPOL_LOCAL
 #define MPOL_LOCAL 4
 #endif
-	    r = mbind(stats, PAGE_SIZE * params.jobs, MPOL_LOCAL, NULL, 0, 0);
+	    r = mbind(stats, stats_size, MPOL_LOCAL, NULL, 0, 0);
 	    if (r) {
 		perror("stats mbind() failed");
 		return 1;
@@ -1186,50 +5429,48 @@ int main(int argc, char** argv)
 	    int permissions = PROT_READ;
 	    if (params.ratio < 100) permissions |= PROT_WRITE; 
 
-	    buf = mmap(NULL, map_num_pfn * PAGE_SIZE, permissions, 
-		    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-	    if (buf == MAP_FAILED) {
-		perror("buf mmap failed");
-		return 1;
+	    if (params.bufpool) {
+		/* the working set is in the pool's file, not in a map */
+		if (bufpool_init(((uint64_t)params.setsize_mib << 20) >> params.unit_shift,
+			    params.jobs)) return 1;
+		buf = NULL;
+	    } else {
+		if (params.regions) buf = regions_map(map_num_pfn * PAGE_SIZE, permissions);
+		else buf = params.backing->map(map_num_pfn * PAGE_SIZE, permissions);
+		if (buf == NULL) return 1;
+#ifdef PMB_NUMA
+		if (params.mempolicy != MEMPOL_NONE && sys_numa_set_policy(buf,
+			    map_num_pfn * PAGE_SIZE, params.mempolicy, params.mempol_nodes)) return 1;
+#endif
+
+		/* an attached warm state is initialized, and warmed up if asked */
+		if (params.backing == &persist_backing && get_backing_info()->warm) {
+		    params.init_garbage = 0;
+		    if (get_backing_info()->skip_warmup) params.cold = 1;
+		}
+	    }
+
+	    /* with procs the worker processes map their own. the map made
+	     * here only prepares the backing (e.g., fills the file) */
+	    if (params.procs) {
+		if (params.backing->unmap(buf, map_num_pfn * PAGE_SIZE)) return 1;
+		buf = NULL;
 	    }
 
 	    // memory for histogram. 
 	    // 1 page per thread; read and write statistics get 2k each
-	    stats = mmap(NULL, (size_t)(PAGE_SIZE * params.jobs), 
-		    PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); 
+	    // shared with the worker processes in procs mode
+	    stats = mmap(NULL, stats_size, PROT_READ | PROT_WRITE,
+		    (params.procs ? MAP_SHARED : MAP_PRIVATE) | MAP_ANONYMOUS, -1, 0); 
 	    if (stats == MAP_FAILED) {
 		perror("stats mmap failed");
 		return 1;
 	    }
 	}
 #endif
-	//XXX fill in garbage 
-	//PMB_NUMA - main thread shouldn't be touching the map..
-	//FIXME .. for now don't allow init when affinityset is set
-	if (params.init_garbage) {
-	    if (buf == NULL) { 
-		prn("Fixme: can't init the map when affinityset is set. proceeding without initializing");
-	    } else {
-		prn("Initializing memory map...\n");
-		int i, j;
-		uint64_t state = 0x0ddfadedbeefd00d;
-		uint32_t val;
-		struct stopwatch sw_init;
-		sw_reset(&sw_init, params.tsops);
-		sw_start(&sw_init);
-		for (i = 0; i < map_num_pfn; i++) {
-		    for (j = 0; j < PAGE_SIZE; j+=4) {
-			state = state * 6364136223846793005ull + 1442695040888963407ull;
-			val = (uint32_t)(state >> 33);
-			buf[i*PAGE_SIZE + j] = val;
-		    }
-		}
-		sw_stop(&sw_init);
-		prn("Initialization took %0.4f ms\n", ((float)sw_get_usec(&sw_init))/1000.0);
-	    }
-	}
+	// the map is initialized by the workers, see init_thread_maps()
 #ifdef _WIN32
-	else prn("WARNING: uninitialized memory causes side effect on" 
+	if (!params.init_garbage) prn("WARNING: uninitialized memory causes side effect on" 
 		" OS with memory compression and deduplication.\n");
 #endif
     }
@@ -1239,13 +5480,51 @@ int main(int argc, char** argv)
     install_ctrlc_handler();
 #ifndef _WIN32
     trace_marker_init();
+    if (params.mlock_pct && mlock_prepare()) {
+	printf("failed to prepare the mlock set\n");
+	goto report_no_unmap;
+    }
+#endif
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    if (params.churn_rate && churn_prepare()) {
+	printf("failed to prepare the churn agent\n");
+	goto report_no_unmap;
+    }
+    if (params.cow != COW_NONE && cow_prepare()) {
+	printf("failed to prepare the cow snapshot\n");
+	goto report_no_unmap;
+    }
+    /* last, so that no failure above leaves it waiting */
+    if (params.antag_shape != ANTAG_NONE) {
+	if (antagonist_alloc()) {
+	    perror("antagonist timeline mmap failed");
+	    goto report_no_unmap;
+	}
+	antag_pid = antagonist_start();
+	if (antag_pid == -1) goto report_no_unmap;
+    }
 #endif
 
 #ifdef PMB_THREAD
+#ifndef _WIN32
+    if (params.procs) perform_benchmark_mp(stats);
+    else
+#endif
     perform_benchmark_mt(buf, stats);
 #else
     perform_benchmark_st(buf, stats);
 #endif
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    if (params.antag_shape != ANTAG_NONE) antagonist_stop(antag_pid);
+#endif
+#ifndef _WIN32
+    if (params.frag_mib) fragment_finish();
+#endif
+#ifdef PMB_NUMA
+    if (params.mempolicy != MEMPOL_NONE) {
+	sys_numa_placement(buf, (size_t)params.setsize_mib << 20, &numa_placement);
+    }
+#endif
 
     print_con_report(stats, &params);
 
@@ -1298,16 +5577,21 @@ int main(int argc, char** argv)
 	    }
 	} else 
 #endif
-	{
-	    ret = munmap(buf, map_num_pfn * PAGE_SIZE);
-
-	    if (ret) {
-		perror("munmap failed");
-		goto report_no_unmap;
+	if (params.bufpool) {
+	    /* a frame that failed its io measured nothing */
+	    if (bufpool_failed()) {
+		printf("bufpool io failed during the run. results are invalid\n");
+		run_failed = 1;
 	    }
+	    bufpool_exit();
+	}
+	if (buf) {
+	    if (params.regions) ret = regions_unmap();
+	    else ret = params.backing->unmap(buf, map_num_pfn * PAGE_SIZE);
+	    if (ret) goto report_no_unmap;
 	}
 
-	ret = munmap(stats, (size_t)(PAGE_SIZE * params.jobs));
+	ret = munmap(stats, stats_size);
 	if (ret) {
 	    perror("stats munmap failed");
 	    goto report_no_unmap;
@@ -1320,6 +5604,9 @@ int main(int argc, char** argv)
 
     if (params.xml_path) print_xml_report_post_unmap(params.xml_path);
 
+#ifndef _WIN32
+    if (params.frag_mib) fragment_release();
+#endif
     sys_stat_mem_exit(&mem_ctx);
 
 #ifdef XALLOC
@@ -1334,7 +5621,7 @@ int main(int argc, char** argv)
 #endif
     remove_ctrlc_handler();
 
-    return 0;
+    return run_failed;
 
 report_no_unmap:
 
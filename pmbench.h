@@ -36,6 +36,9 @@
 #include <inttypes.h>
 #include "access.h"
 #include "pattern.h"
+#include "backing.h"
+#include "content.h"
+#include "bufpool.h"
 
 #define PAGE_SHIFT (12)
 #define PAGE_SIZE (1<<PAGE_SHIFT)
@@ -95,10 +98,55 @@ typedef struct parameters {
     int quiet;	    	// no output until done
     int cold;	    	// don't perform warm up exercise before benchmark
     struct sys_timestamp* tsops;// timestamp ops (rdtsc_ops or perfc_ops)
-    int jobs;		// number of worker threads
+    int jobs;		// number of worker threads (or processes with procs)
+    int procs;		// number of worker processes. 0 = threads in one process
     int init_garbage;
+    const struct content_profile* content;	// page contents (--content). NULL = garbage
     int threshold;
     int write_needs_read;// use write_after_read access method
+    map_backing* backing;	// what the benchmark map is made of
+    int map_shared;	// MAP_SHARED instead of MAP_PRIVATE
+    int hugepage;	// HUGEPAGE_* mode
+    int unit_huge;	// pattern draws huge pages instead of base pages
+    int unit_shift;	// log2 of the pattern unit size in bytes
+    int evict_mode;	// EVICT_* mode of explicit working set eviction
+    int evict_pct;	// percentage of the working set to evict
+    int evict_interval_sec;	// evict every this many seconds. 0 = once before the run
+    int topology;	// TOPO_* sharing topology of the worker maps
+    int mix_pct;	// percentage of accesses to the shared map with TOPO_MIX
+    int pager_threads;	// number of userfaultfd pager threads
+    int resident_mib;	// resident limit of the userfaultfd pager. 0 = unlimited
+    int mlock_pct;	// percentage of the working set to mlock. 0 = none
+    int mlock_mode;	// MLOCK_* choice of the locked units
+    int cgroup;		// run inside a cgroup v2 sandbox
+    char* cgroup_parent;	// where the sandbox is created. NULL = hierarchy root
+    int cg_max_mib;	// memory.max of the sandbox. -1 = leave alone
+    int cg_high_mib;	// memory.high
+    int cg_swap_max_mib;	// memory.swap.max
+    int antag_shape;	// ANTAG_* footprint schedule of the pressure antagonist
+    int antag_mib;	// peak footprint of the antagonist
+    int antag_period_sec;	// length of one pressure cycle
+    int recover_pct;	// latency counts as recovered within this % of baseline p99
+    int churn_rate;	// churn operations per second. 0 = no churn
+    int churn_kib;	// size of the range of one churn operation
+    int churn_ops;	// mask of CHURN_* operations, used round robin
+    int fault_mode;	// FAULT_* first touch fault storm instead of the timed run
+    int fault_kib;	// range of one populate call
+    int regions;	// number of separately mapped regions of the map. 0 = one map
+    int region_mode;	// REGION_* how the regions are kept from merging
+    int prefetch_depth;	// lookahead of the prefetch helper in draws. 0 = no helper
+    int prefetch_hint;	// PFHINT_* madvise hint for the map
+    int sync_mode;	// SYNC_* cadence of the dirty writeback agent
+    int sync_ms;	// sync period. 0 = no writeback agent
+    int cow;		// COW_* side of the fork that runs the timed loop. COW_NONE = no fork
+    int frag_mib;	// region fragmenting memory before the run. 0 = no preconditioning
+    int frag_pin_pct;	// percentage of its freed pages to refill with mlocked pages
+    int frag_unmov_pct;	// percentage of its freed pages to refill with pipe buffers
+    const struct bufpool_config* bufpool;	// buffer pool instead of the map (--bufpool). NULL = map
+    int grain;		// bytes per access. 0 = one word, GRAIN_PAGE = the whole page
+    int stream;		// sequential whole page sweeps instead of the pattern (--stream)
+    int mlp;		// independent accesses per batch (--mlp). 0 = one access at a time
+    int mlp_update;	// batches are read-modify-write updates (GUPS) instead of loads
 #ifdef XALLOC
     int xalloc_mib;	// positive xalloc_mib indicates we use xalloc instead of mmap
     char* xalloc_path;	// xalloc backend file pathname
@@ -108,6 +156,9 @@ typedef struct parameters {
     char *xml_path;
 #ifdef PMB_NUMA
     struct affy_node* affy_head;
+    int mempolicy;	// MEMPOL_* policy of the map
+    struct bitmask* mempol_nodes;	// its nodes. NULL = all
+    int numa_matrix_mib;	// buffer of each cell of the latency matrix. 0 = no matrix
 #endif
 } parameters;
 
@@ -115,6 +166,280 @@ extern parameters params;
 
 extern uint32_t freq_khz;
 
+/* sharing topology of the worker maps (--topology) */
+enum {
+    TOPO_SHARED = 0,	// all workers draw over the whole working set of one map
+    TOPO_PARTITION,	// each worker draws over a disjoint slice of the working set
+    TOPO_PRIVATE,	// each worker has a private map
+    TOPO_MIX,		// mix_pct% of accesses to the shared map, the rest to a private one
+};
+
+extern const char* topology_name(int topology);
+
+/*
+ * Access classes split the latency histograms by the kind of access.
+ * Each class has its own histogram plane of one page per worker, following
+ * plane 0, which counts all accesses.
+ */
+#define MAX_ACCESS_CLASS 8
+
+extern int num_access_class;
+extern const char* access_class_name[MAX_ACCESS_CLASS + 1];
+extern char* access_class_plane(char* stats, int cls);
+
+/* explicit working set eviction (--evict) */
+enum {
+    EVICT_NONE = 0,
+    EVICT_PAGEOUT,	// madvise(MADV_PAGEOUT) - reclaim right away
+    EVICT_COLD,		// madvise(MADV_COLD) - deactivate, reclaim under pressure
+};
+
+extern const char* evict_mode_name(int mode);
+
+/* resident floor (--mlock) */
+enum {
+    MLOCK_HOT = 0,	// the units the pattern draws most often
+    MLOCK_RANGE,	// the leading units of the working set
+};
+
+extern const char* mlock_mode_name(int mode);
+
+/*
+ * pressure antagonist (--antagonist). Each cycle is quiet for a while, then
+ * the antagonist's footprint grows and is released at the end of the cycle.
+ */
+enum {
+    ANTAG_NONE = 0,
+    ANTAG_SQUARE,	// full footprint for the second half of the cycle
+    ANTAG_RAMP,		// grows linearly over the second half of the cycle
+    ANTAG_SPIKE,	// full footprint for the last tenth of the cycle
+};
+
+extern const char* antagonist_shape_name(int shape);
+
+#define RECOVER_MAX_CYCLES 64
+
+struct recover_result {
+    int cycles;			// pressure cycles released during the run
+    double baseline_p99_ns;	// p99 before the first onset
+    double peak_p99_ns[RECOVER_MAX_CYCLES];	// worst interval p99 under pressure
+    int64_t recover_ms[RECOVER_MAX_CYCLES];	// release to recovery. -1 if never
+    int64_t peak_kib;		// antagonist footprint reached
+};
+
+extern struct recover_result recover_result;
+
+/* VMA churn agent (--churn) */
+enum {
+    CHURN_DONTNEED = 0,	// madvise(MADV_DONTNEED)
+    CHURN_FREE,		// madvise(MADV_FREE)
+    CHURN_REMAP,	// mmap(MAP_FIXED) a fresh anonymous range over it
+    CHURN_MREMAP,	// mremap a filled range over it, as realloc moving data
+    CHURN_MPROTECT,	// mprotect PROT_EXEC on and off again, flushing the TLBs only
+    CHURN_NR_OPS,
+};
+
+extern const char* churn_op_name(int op);
+
+#define CHURN_LAT_BINS 24	// log2 us bins of operation latency. bin 0 is below 1 us
+
+struct churn_result {
+    uint64_t ops[CHURN_NR_OPS];		// operations performed
+    uint64_t clock[CHURN_NR_OPS];	// time spent in them
+    uint64_t clock_max[CHURN_NR_OPS];
+    uint64_t lat_bins[CHURN_NR_OPS][CHURN_LAT_BINS];
+    int failures;			// failed system calls
+    uint64_t run_clock;			// time the agent ran
+    int64_t tlb_shootdowns;		// TLB shootdown interrupts while it ran. -1 if unknown
+};
+
+extern struct churn_result churn_result;
+
+/* dirty writeback agent (--sync) */
+enum {
+    SYNC_NONE = 0,	// only watch the dirty state
+    SYNC_MSYNC,		// msync(MS_SYNC) the map
+    SYNC_FDATASYNC,	// fdatasync the backing file
+};
+
+extern const char* sync_mode_name(int mode);
+
+#define WB_SAMPLE_MS 100	// the agent samples the dirty state this often
+#define WB_STALL_NS 10000	// accesses slower than this are checked for a sleep
+
+struct wb_sample {
+    uint32_t ms;		// since the start of the run
+    int32_t dirty_kib;		// Dirty
+    int32_t writeback_kib;	// Writeback
+};
+
+struct writeback_result {
+    int nsamples;
+    struct wb_sample* samples;	// one per WB_SAMPLE_MS of the run
+    int64_t thresh_kib;		// dirty threshold at the start. -1 if unknown
+    int64_t bg_thresh_kib;	// background threshold
+    int throttle_samples;	// samples at or above the freerun ceiling
+    uint64_t syncs;		// msync or fdatasync calls
+    uint64_t sync_clock;	// time spent in them
+    uint64_t sync_clock_max;
+    int failures;
+};
+
+extern struct writeback_result writeback_result;
+
+/* copy-on-write snapshot (--cow). which side of the fork runs the timed loop */
+enum {
+    COW_NONE = 0,
+    COW_PARENT,		// the parent. the child holds the snapshot until the end
+    COW_CHILD,		// the child, in place of worker 1
+    COW_BOTH,		// both. the child is reported on its own
+};
+
+extern const char* cow_side_name(int side);
+
+/* memory level parallelism (--mlp). worker 1 measures the throughput at
+ * each power of two batch size up to MLP_MAX before the run */
+#define MLP_MAX 64
+#define MLP_PROBE_MS 200
+#define MLP_SATURATE_PCT 90	// saturated at the first batch size reaching this much of the peak
+
+struct mlp_result {
+    int levels;
+    int k[8];
+    double rate[8];		// accesses per second while in batches
+    double batch_ns[8];		// mean time of a batch
+    int saturation_k;
+};
+
+extern struct mlp_result mlp_result;
+extern double get_mlp_rate(int jobid);	// accesses/s of the run. -1 for aggregate
+
+#define GRAIN_PAGE (-1)	// --granularity=page. resolved to the base page size
+#define STREAM_CHUNK 64		// pages checked for residency at a time by the sweep
+
+/* memory fragmentation preconditioning (--fragment) */
+struct fragment_result {
+    int64_t kept_kib;		// pages of the region left in place
+    int64_t pinned_kib;		// of which mlocked
+    int64_t unmovable_kib;	// pipe buffers allocated into the freed pages
+    int pipes;
+    int failures;		// failed madvise, mlock or pipe calls
+    int64_t blocks_before;	// free blocks of huge page size before/after preconditioning.
+    int64_t blocks_after;	// -1 if unknown
+    /* /proc/vmstat deltas from the preconditioning to the end of the run */
+    int64_t thp_fault_alloc;
+    int64_t thp_fault_fallback;
+    int64_t compact_stall;
+    int64_t compact_fail;
+    int64_t compact_success;
+};
+
+extern struct fragment_result fragment_result;
+
+#ifdef PMB_NUMA
+/* memory policy of the map (--mempolicy) */
+enum {
+    MEMPOL_NONE = 0,	// the process policy, or the affinity sets' nodes
+    MEMPOL_INTERLEAVE,	// round robin over the nodes
+    MEMPOL_PREFERRED,	// the node, or others when it is full
+    MEMPOL_LOCAL,	// the node of the CPU that first touches the page
+    MEMPOL_REMOTE,	// bound to the node, by default the farthest one
+};
+
+extern const char* mempolicy_name(int policy);
+
+#define NUMA_MAX_NODES 64
+
+/* pages of the map on each node at the end of the run */
+struct numa_placement {
+    int nnodes;
+    int64_t pages[NUMA_MAX_NODES];
+    int64_t absent;		// not present, e.g., swapped out
+    int failures;
+};
+
+extern struct numa_placement numa_placement;
+
+/* node-to-node latency matrix (--numa-matrix) */
+struct numa_matrix_result {
+    int ncpu_nodes;		// rows, nodes with CPUs
+    int nmem_nodes;		// columns, nodes with memory
+    int cpu_node[NUMA_MAX_NODES];
+    int mem_node[NUMA_MAX_NODES];
+    int distance[NUMA_MAX_NODES][NUMA_MAX_NODES];
+    double mem_ns[NUMA_MAX_NODES][NUMA_MAX_NODES];	// dependent load of a resident page
+    double swapin_ns[NUMA_MAX_NODES][NUMA_MAX_NODES];	// of a swapped out page. -1 if none got out
+    int swapped_pct[NUMA_MAX_NODES][NUMA_MAX_NODES];	// of the buffer swapped out before
+    int thp_pct;		// of the memory access buffers, the lowest over the cells
+    int64_t llc_kib;		// last level cache size. <= 0 if unknown
+};
+
+extern struct numa_matrix_result numa_matrix_result;
+#endif
+
+/* many-VMA map (--regions) */
+enum {
+    REGION_GUARD = 0,	// an inaccessible guard page between regions
+    REGION_PROT,	// adjacent regions, every other one also PROT_EXEC
+};
+
+extern const char* region_mode_name(int mode);
+
+struct region_info {
+    size_t count;	// regions made
+    size_t bytes;	// size of each region (the last one may be smaller)
+    int64_t vmas;	// vmas in the span of the regions, guards included
+};
+
+extern const struct region_info* get_region_info(void);	// sampled on each call
+
+/* lookahead prefetch (--prefetch) */
+enum {
+    PFHINT_NONE = 0,
+    PFHINT_NORMAL,	// madvise(MADV_NORMAL)
+    PFHINT_RANDOM,	// madvise(MADV_RANDOM)
+    PFHINT_SEQUENTIAL,	// madvise(MADV_SEQUENTIAL)
+};
+
+extern const char* prefetch_hint_name(int hint);
+
+#define PREFETCH_PHASE_MS 1000	// prefetch is on and off for this long in turn
+
+/* first touch fault storm (--fault) */
+enum {
+    FAULT_NONE = 0,
+    FAULT_COLD,			// access each page of the slice
+    FAULT_POPULATE,		// mmap(MAP_POPULATE) over the slice
+    FAULT_POPULATE_READ,	// madvise(MADV_POPULATE_READ)
+    FAULT_POPULATE_WRITE,	// madvise(MADV_POPULATE_WRITE)
+};
+
+extern const char* fault_mode_name(int mode);
+
+struct evict_result {
+    int rounds;			// number of eviction rounds performed
+    int failures;		// number of failed madvise calls
+    uint64_t advised_pages;	// total base pages advised over all rounds
+    uint64_t total_clock;	// time spent advising
+    int64_t resident_before;	// working set resident pages before/after the first round.
+    int64_t resident_after;	// -1 if unknown
+    int64_t ws_pages;		// working set size in base pages
+};
+
+extern struct evict_result evict_result;
+
+/* smaps of the map sampled by the control thread around the main run */
+struct map_sample {
+    int64_t huge_kib;	// backed by huge pages
+    int64_t rss_kib;	// resident
+    int64_t swap_kib;	// swapped out. for shmem maps this is the map's ShmemSwapped
+};
+
+extern struct map_sample map_sample_before_run;
+extern struct map_sample map_sample_after_run;
+
+extern int map_is_shmem(const parameters* p);
+
 /* benchmark result processing */
 struct bench_result {
     uint64_t total_bench_clock;
@@ -123,11 +448,39 @@ struct bench_result {
     uint64_t total_warmup_count;
     uint64_t total_numgen_clock;	// pattern generation overhead
     uint64_t total_numgen_count;
+    uint64_t total_init_clock;		// map initialization (-i)
+    uint64_t total_init_bytes;
+    uint64_t total_locked_bytes;	// mlocked by this worker (--mlock)
+    int lock_failures;
+    int fault_failures;			// failed populate calls (--fault)
+    uint64_t total_prefetch_issued;	// MADV_WILLNEED calls made (--prefetch)
+    uint64_t total_prefetch_useless;	// of which the unit was already resident
+    uint64_t total_prefetch_late;	// draws the worker reached before the helper
+    uint64_t total_stream_passes;	// completed sweeps of the worker's slice (--stream)
+    uint64_t total_stream_bytes[2];	// [0] pages not resident when the sweep got to them, [1] resident
+    uint64_t total_stream_ns[2];	// time spent accessing them
+    uint64_t total_mlp_batches;		// batches issued (--mlp). total_bench_count has the accesses
+    uint64_t total_mlp_ns;		// time spent in the batches
     int stat_major_fault_clock;
     int stat_minor_fault_clock;
 };
 
 extern struct bench_result* get_result(int jobid);
+extern double get_init_throughput(int jobid);	// MiB/s. -1 for aggregate
+extern double get_fault_rate(int jobid);	// faults/s of the fault storm. -1 for aggregate
+extern double get_stream_throughput(int jobid);	// MiB/s of the sweeps. -1 for aggregate
+
+/* the fork of the copy-on-write snapshot (--cow) */
+struct cow_result {
+    int pid;			// the child. -1 if the fork failed
+    uint64_t fork_clock;	// time fork() took in the parent
+    int64_t pte_kib;		// page tables of the process at the fork. -1 if unknown
+    int64_t rss_kib;		// map resident at the fork. -1 if unknown
+    struct bench_result child;	// the child's worker result with COW_BOTH
+    char* child_stats;		// its histogram planes, one page per class
+};
+
+extern struct cow_result cow_result;
 
 /* mean_us must do float conversion first to avoid truncation error */
 #define mean_us(name) \
@@ -46,11 +46,14 @@
 #include "argp.h"
 #else
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <argp.h>
 #include <sys/utsname.h>
 #include <time.h>
 #include <uuid/uuid.h>
+#include <dirent.h>
+#include <signal.h>
 #endif
 
 #include "system.h"
@@ -945,10 +948,17 @@ int64_t sys_stat_mem_get_delta(const sys_mem_item* before, const sys_mem_item* a
     }
 }
 #else
+static int cgroup_open(const char* file);
+
 int sys_stat_mem_init(sys_mem_ctx* ctx)
 {
     int r1, r2;
 
+    ctx->fd_cg_stat = cgroup_open("memory.stat");
+    ctx->fd_cg_events = cgroup_open("memory.events");
+    ctx->fd_cg_current = cgroup_open("memory.current");
+    ctx->fd_cg_swap = cgroup_open("memory.swap.current");
+
     r1 = open("/proc/meminfo", O_RDONLY);
     r2 = open("/proc/vmstat", O_RDONLY);
 
@@ -965,50 +975,558 @@ int sys_stat_mem_init(sys_mem_ctx* ctx)
 }
 
 /*
- * returns parsed out integer value from a meminfo line
- * @buf points to the start of the 28-byte lengh meminfo line
+ * returns the value of @key in a meminfo or vmstat buffer, 0 if not found.
+ * @key must include the separator, e.g., "Cached:" or "pgpgin ".
+ * The key is matched at the start of a line only, so that "Cached:"
+ * does not match "SwapCached:".
  */
-static inline
-int meminfo_get_line(const char* buf) {
-    const char* pos = strchr(buf, ':');
-    return atoi(pos + 1);
+static
+int64_t proc_get_value(const char* buf, const char* key)
+{
+    const char* pos = buf;
+    size_t len = strlen(key);
+
+    while (pos) {
+	if (!strncmp(pos, key, len)) return atoll(pos + len);
+	pos = strchr(pos, '\n');
+	if (pos) pos++;
+    }
+    return 0;
 }
 
-int sys_stat_mem_update(sys_mem_ctx* ctx, sys_mem_item* info)
+/*
+ * extended counters table. name is what we print, key is what we look up.
+ * cgroup files count bytes; shift converts them to KiB.
+ * An empty key reads a single value file.
+ */
+enum { EXT_MEMINFO = 0, EXT_VMSTAT, EXT_CG_STAT, EXT_CG_EVENTS, EXT_CG_CURRENT, EXT_CG_SWAP, EXT_NR_SRC };
+static const struct sys_mem_ext_desc {
+    const char* name;
+    const char* key;
+    int src;
+    int group;
+    int shift;
+} ext_desc[] = {
+    { "AnonHugePages(K)", "AnonHugePages:", EXT_MEMINFO, SYS_MEM_GRP_THP },
+    { "HugePages_Total", "HugePages_Total:", EXT_MEMINFO, SYS_MEM_GRP_THP },
+    { "HugePages_Free", "HugePages_Free:", EXT_MEMINFO, SYS_MEM_GRP_THP },
+    { "thp_fault_alloc", "thp_fault_alloc ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_fault_fallback", "thp_fault_fallback ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_collapse_alloc", "thp_collapse_alloc ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_split_page", "thp_split_page ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_split_pmd", "thp_split_pmd ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_deferred_split", "thp_deferred_split_page ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_swpout", "thp_swpout ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "thp_swpout_fallback", "thp_swpout_fallback ", EXT_VMSTAT, SYS_MEM_GRP_THP },
+    { "Shmem(K)", "Shmem:", EXT_MEMINFO, SYS_MEM_GRP_SHMEM },
+    { "ShmemHugePages(K)", "ShmemHugePages:", EXT_MEMINFO, SYS_MEM_GRP_SHMEM },
+    { "SwapCached(K)", "SwapCached:", EXT_MEMINFO, SYS_MEM_GRP_SHMEM },
+    { "SwapFree(K)", "SwapFree:", EXT_MEMINFO, SYS_MEM_GRP_SHMEM },
+    { "cg.current(K)", "", EXT_CG_CURRENT, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.swap(K)", "", EXT_CG_SWAP, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.anon(K)", "anon ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.file(K)", "file ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.swapcached(K)", "swapcached ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.zswapped(K)", "zswapped ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP, 10 },
+    { "cg.pgmajfault", "pgmajfault ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP },
+    { "cg.pswpin", "pswpin ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP },
+    { "cg.pswpout", "pswpout ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP },
+    { "cg.refault_anon", "workingset_refault_anon ", EXT_CG_STAT, SYS_MEM_GRP_CGROUP },
+    { "cg.events.high", "high ", EXT_CG_EVENTS, SYS_MEM_GRP_CGROUP },
+    { "cg.events.max", "max ", EXT_CG_EVENTS, SYS_MEM_GRP_CGROUP },
+    { "cg.events.oom", "oom ", EXT_CG_EVENTS, SYS_MEM_GRP_CGROUP },
+    { "cg.events.oom_kill", "oom_kill ", EXT_CG_EVENTS, SYS_MEM_GRP_CGROUP },
+    { "Dirty(K)", "Dirty:", EXT_MEMINFO, SYS_MEM_GRP_DIRTY },
+    { "Writeback(K)", "Writeback:", EXT_MEMINFO, SYS_MEM_GRP_DIRTY },
+    { "dirty_threshold", "nr_dirty_threshold ", EXT_VMSTAT, SYS_MEM_GRP_DIRTY },
+    { "dirty_bg_threshold", "nr_dirty_background_threshold ", EXT_VMSTAT, SYS_MEM_GRP_DIRTY },
+    { "nr_dirtied", "nr_dirtied ", EXT_VMSTAT, SYS_MEM_GRP_DIRTY },
+    { "nr_written", "nr_written ", EXT_VMSTAT, SYS_MEM_GRP_DIRTY },
+    { "compact_stall", "compact_stall ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { "compact_fail", "compact_fail ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { "compact_success", "compact_success ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { "compact_migrate_scan", "compact_migrate_scanned ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { "compact_free_scan", "compact_free_scanned ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { "thp_fallback_charge", "thp_fault_fallback_charge ", EXT_VMSTAT, SYS_MEM_GRP_COMPACT },
+    { 0 }
+};
+
+static int ext_groups = 0;
+
+void sys_stat_mem_ext_enable(int groups)
+{
+    ext_groups |= groups;
+}
+
+int sys_stat_mem_ext_count(void)
+{
+    return sizeof(ext_desc)/sizeof(ext_desc[0]) - 1;
+}
+
+int sys_stat_mem_ext_is_enabled(int i)
+{
+    return (ext_desc[i].group & ext_groups) != 0;
+}
+
+const char* sys_stat_mem_ext_name(int i)
+{
+    return ext_desc[i].name;
+}
+
+/*
+ * prints enabled extended counters, one row per counter and one column per
+ * snapshot. The last column is the delta between the first and last snapshot.
+ */
+void sys_stat_mem_ext_print(int nitems, const char* labels[], const sys_mem_item* items[])
+{
+    int i, j;
+
+    printf("%-20s", "");
+    for (j = 0; j < nitems; j++) printf(" %12s", labels[j]);
+    printf(" %12s\n", "(delta)");
+    for (i = 0; ext_desc[i].name; i++) {
+	if (!sys_stat_mem_ext_is_enabled(i)) continue;
+	printf("%-20s", ext_desc[i].name);
+	for (j = 0; j < nitems; j++) printf(" %12"PRId64, items[j]->ext[i]);
+	printf(" %12"PRId64"\n", items[nitems-1]->ext[i] - items[0]->ext[i]);
+    }
+}
+
+/*
+ * returns the value of @key (e.g., "AnonHugePages:") for the vma that
+ * contains @addr in /proc/self/smaps, -1 if not found.
+ * This walks page tables in the kernel. Don't call it during measurement.
+ */
+int64_t sys_smaps_get(const void* addr, const char* key)
+{
+    FILE* fp;
+    char line[256];
+    unsigned long lo, hi;
+    int in_vma = 0;
+    int64_t ret = -1;
+    size_t len = strlen(key);
+
+    fp = fopen("/proc/self/smaps", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	if (sscanf(line, "%lx-%lx ", &lo, &hi) == 2 && strchr(line, '-') < strchr(line, ' ')) {
+	    if (in_vma) break;
+	    in_vma = ((uintptr_t)addr >= lo && (uintptr_t)addr < hi);
+	    continue;
+	}
+	if (in_vma && !strncmp(line, key, len)) {
+	    ret = atoll(line + len);
+	    break;
+	}
+    }
+    fclose(fp);
+    return ret;
+}
+
+/* returns the value of @key (e.g., "VmPTE:") in /proc/self/status, -1 if not found */
+int64_t sys_status_get(const char* key)
+{
+    FILE* fp;
+    char line[256];
+    int64_t ret = -1;
+    size_t len = strlen(key);
+
+    fp = fopen("/proc/self/status", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	if (!strncmp(line, key, len)) {
+	    ret = atoll(line + len);
+	    break;
+	}
+    }
+    fclose(fp);
+    return ret;
+}
+
+/* returns the value of @key (e.g., "compact_stall ") in /proc/vmstat, -1 on failure */
+int64_t sys_vmstat_get(const char* key)
+{
+    char buf[16384];
+    ssize_t n;
+    int fd;
+
+    fd = open("/proc/vmstat", O_RDONLY);
+    if (fd == -1) return -1;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = 0;
+    return proc_get_value(buf, key);
+}
+
+/*
+ * free blocks of at least 2^@order pages in /proc/buddyinfo, over all
+ * zones, counted in blocks of 2^@order pages. -1 on failure
+ */
+int64_t sys_free_blocks(int order)
+{
+    FILE* fp;
+    char line[512];
+    char* pos;
+    char* end;
+    int64_t ret = 0;
+    long long v;
+    int o;
+
+    fp = fopen("/proc/buddyinfo", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	/* "Node 0, zone   Normal  c0 c1 ..." */
+	pos = strstr(line, "zone");
+	if (!pos) continue;
+	pos += strspn(pos + 4, " ") + 4;
+	pos += strcspn(pos, " ");
+	for (o = 0; ; o++, pos = end) {
+	    v = strtoll(pos, &end, 10);
+	    if (end == pos) break;
+	    if (o >= order) ret += v << (o - order);
+	}
+    }
+    fclose(fp);
+    return ret;
+}
+
+/*
+ * TLB shootdown interrupts received, summed over the cpus, from the "TLB:"
+ * line of /proc/interrupts. -1 if there is none (e.g., not x86)
+ */
+int64_t sys_tlb_shootdowns(void)
+{
+    FILE* fp;
+    char line[4096];
+    char* pos;
+    char* end;
+    int64_t ret = -1;
+    long long v;
+
+    fp = fopen("/proc/interrupts", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	pos = line + strspn(line, " ");
+	if (strncmp(pos, "TLB:", 4)) continue;
+	/* per cpu counts up to the description */
+	ret = 0;
+	for (pos += 4; ; pos = end) {
+	    v = strtoll(pos, &end, 10);
+	    if (end == pos) break;
+	    ret += v;
+	}
+	break;
+    }
+    fclose(fp);
+    return ret;
+}
+
+/* number of vmas of the process overlapping [lo, hi). -1 on failure */
+int64_t sys_vma_count(const void* lo, const void* hi)
+{
+    FILE* fp;
+    char line[4096];
+    unsigned long start, end;
+    int64_t count = 0;
+
+    fp = fopen("/proc/self/maps", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	if (sscanf(line, "%lx-%lx ", &start, &end) != 2) continue;
+	if (lo || hi) {
+	    if (end <= (uintptr_t)lo || start >= (uintptr_t)hi) continue;
+	}
+	count++;
+    }
+    fclose(fp);
+    return count;
+}
+
+/*
+ * global dirty page state. thresholds are what the kernel computed last,
+ * in KiB. The writers are throttled once dirty + writeback pages reach
+ * the midpoint of the two thresholds (the freerun ceiling).
+ */
+int sys_dirty_state(int64_t* dirty_kib, int64_t* writeback_kib,
+	int64_t* thresh_kib, int64_t* bg_thresh_kib)
+{
+    char buf[16384];
+    const int64_t page_kib = sysconf(_SC_PAGESIZE) >> 10;
+    ssize_t n;
+    int fd;
+
+    if (dirty_kib || writeback_kib) {
+	fd = open("/proc/meminfo", O_RDONLY);
+	if (fd == -1) return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0) return -1;
+	buf[n] = 0;
+	if (dirty_kib) *dirty_kib = proc_get_value(buf, "Dirty:");
+	if (writeback_kib) *writeback_kib = proc_get_value(buf, "Writeback:");
+    }
+    if (thresh_kib || bg_thresh_kib) {
+	fd = open("/proc/vmstat", O_RDONLY);
+	if (fd == -1) return -1;
+	n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (n <= 0) return -1;
+	buf[n] = 0;
+	if (thresh_kib) *thresh_kib = proc_get_value(buf, "nr_dirty_threshold ") * page_kib;
+	if (bg_thresh_kib) *bg_thresh_kib = proc_get_value(buf, "nr_dirty_background_threshold ") * page_kib;
+    }
+    return 0;
+}
+
+static char cg_path[512];	// the sandbox cgroup. empty without sandbox
+static char cg_origin[512];	// cgroup the process came from
+static pid_t cg_owner;
+
+static
+int cgroup_write(const char* dir, const char* file, const char* val)
+{
+    char path[640];
+    int fd, ret = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    fd = open(path, O_WRONLY);
+    if (fd == -1) return -1;
+    if (write(fd, val, strlen(val)) == -1) ret = -1;
+    close(fd);
+    return ret;
+}
+
+static
+int cgroup_open(const char* file)
+{
+    char path[640];
+
+    if (!cg_path[0]) return -1;
+    snprintf(path, sizeof(path), "%s/%s", cg_path, file);
+    return open(path, O_RDONLY);
+}
+
+/* finds the cgroup2 mount point and the cgroup of the process in it */
+static
+int cgroup_locate(char* mnt, size_t mlen, char* cur, size_t clen)
+{
+    FILE* fp;
+    char line[1024], dev[256], dir[512], type[64];
+    int found = 0;
+
+    fp = fopen("/proc/self/mounts", "r");
+    if (!fp) return -1;
+    while (fgets(line, sizeof(line), fp)) {
+	if (sscanf(line, "%255s %511s %63s", dev, dir, type) == 3 && !strcmp(type, "cgroup2")) {
+	    snprintf(mnt, mlen, "%s", dir);
+	    found = 1;
+	    break;
+	}
+    }
+    fclose(fp);
+    if (!found) return -1;
+
+    fp = fopen("/proc/self/cgroup", "r");
+    if (!fp) return -1;
+    found = 0;
+    while (fgets(line, sizeof(line), fp)) {
+	if (!strncmp(line, "0::", 3)) {
+	    line[strcspn(line, "\n")] = '\0';
+	    found = (snprintf(cur, clen, "%s%s", mnt, line + 3) < (int)clen);
+	    break;
+	}
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
+static
+int cgroup_set_limit(const char* file, int mib)
+{
+    char val[32];
+
+    if (mib < 0) return 0;
+    snprintf(val, sizeof(val), "%"PRIu64, (uint64_t)mib << 20);
+    if (cgroup_write(cg_path, file, val)) {
+	fprintf(stderr, "cgroup: can't set %s: %s\n", file, strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+static
+void sys_cgroup_destroy(void)
+{
+    char pid[16];
+
+    if (!cg_path[0] || getpid() != cg_owner) return;
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    if (cgroup_write(cg_origin, "cgroup.procs", pid)) {
+	fprintf(stderr, "cgroup: can't move back to %s: %s\n", cg_origin, strerror(errno));
+    }
+    if (rmdir(cg_path)) fprintf(stderr, "cgroup: can't remove %s: %s\n", cg_path, strerror(errno));
+    cg_path[0] = '\0';
+}
+
+/*
+ * a run that was killed (OOM, or a second ctrl-c) leaves its cgroup behind.
+ * those of processes that are gone are removed. rmdir fails on populated ones
+ */
+static
+void cgroup_remove_stale(const char* parent)
+{
+    DIR* dir;
+    struct dirent* de;
+    char path[1024];
+    int pid;
+
+    dir = opendir(parent);
+    if (!dir) return;
+    while ((de = readdir(dir))) {
+	if (sscanf(de->d_name, "pmbench.%d", &pid) != 1 || pid <= 0) continue;
+	if (!kill(pid, 0) || errno != ESRCH) continue;
+	snprintf(path, sizeof(path), "%s/%s", parent, de->d_name);
+	if (!rmdir(path)) fprintf(stderr, "cgroup: removed stale %s\n", path);
+    }
+    closedir(dir);
+}
+
+int sys_cgroup_create(const char* parent, int max_mib, int high_mib, int swap_max_mib)
+{
+    char mnt[512], ctl[640], pid[16];
+
+    if (cgroup_locate(mnt, sizeof(mnt), cg_origin, sizeof(cg_origin))) {
+	fprintf(stderr, "cgroup: no cgroup v2 hierarchy found\n");
+	return -1;
+    }
+    if (!parent) parent = mnt;
+    cgroup_remove_stale(parent);
+    if (snprintf(cg_path, sizeof(cg_path), "%s/pmbench.%d", parent, (int)getpid()) >= sizeof(cg_path) ||
+	    mkdir(cg_path, 0755)) {
+	fprintf(stderr, "cgroup: can't create %s: %s\n", cg_path, strerror(errno));
+	cg_path[0] = '\0';
+	return -1;
+    }
+    cg_owner = getpid();
+    atexit(sys_cgroup_destroy);
+
+    /* the parent must hand the memory controller down */
+    snprintf(ctl, sizeof(ctl), "%s/memory.max", cg_path);
+    if (access(ctl, F_OK)) {
+	cgroup_write(parent, "cgroup.subtree_control", "+memory");
+	if (access(ctl, F_OK)) {
+	    fprintf(stderr, "cgroup: memory controller is not available under %s\n", parent);
+	    return -1;
+	}
+    }
+    if (cgroup_set_limit("memory.max", max_mib) ||
+	    cgroup_set_limit("memory.high", high_mib) ||
+	    cgroup_set_limit("memory.swap.max", swap_max_mib)) return -1;
+    /* an OOM kill takes the whole run, not one worker of it (4.19+) */
+    if (cgroup_write(cg_path, "memory.oom.group", "1")) {
+	fprintf(stderr, "cgroup: can't set memory.oom.group: %s\n", strerror(errno));
+    }
+
+    snprintf(pid, sizeof(pid), "%d", (int)getpid());
+    if (cgroup_write(cg_path, "cgroup.procs", pid)) {
+	fprintf(stderr, "cgroup: can't move into %s: %s\n", cg_path, strerror(errno));
+	return -1;
+    }
+    return 0;
+}
+
+const char* sys_cgroup_path(void)
+{
+    return cg_path[0] ? cg_path : NULL;
+}
+
+/*
+ * returns @key of a cgroup file (e.g., "oom_kill " of "memory.events"),
+ * or the value of a single value file with NULL @key.
+ */
+int64_t sys_cgroup_get(const char* file, const char* key)
 {
-#define BUF_SIZE 2048
-    static const int linelen = 28; // meminfo line length
+    char buf[4096];
+    int fd, n;
 
+    fd = cgroup_open(file);
+    if (fd == -1) return -1;
+    n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) return -1;
+    buf[n] = '\0';
+    if (!key) return strncmp(buf, "max", 3) ? atoll(buf) : -1;
+    return strstr(buf, key) ? proc_get_value(buf, key) : -1;
+}
+
+static
+void cgroup_print_limit(const char* tag, const char* file)
+{
+    int64_t v = sys_cgroup_get(file, NULL);
+
+    if (v < 0) printf("%s: max\n", tag);
+    else printf("%s: %"PRId64" MiB\n", tag, v >> 20);
+}
+
+void sys_cgroup_print(void)
+{
+    int64_t peak = sys_cgroup_get("memory.peak", NULL);
+
+    printf("cgroup         : %s\n", cg_path);
+    cgroup_print_limit("memory.max     ", "memory.max");
+    cgroup_print_limit("memory.high    ", "memory.high");
+    cgroup_print_limit("memory.swap.max", "memory.swap.max");
+    if (peak >= 0) printf("memory.peak    : %"PRId64" MiB\n", peak >> 20);
+    printf("events         : high %"PRId64", max %"PRId64", oom %"PRId64", oom_kill %"PRId64"\n",
+	    sys_cgroup_get("memory.events", "high "), sys_cgroup_get("memory.events", "max "),
+	    sys_cgroup_get("memory.events", "oom "), sys_cgroup_get("memory.events", "oom_kill "));
+}
+
+int sys_stat_mem_update(sys_mem_ctx* ctx, sys_mem_item* info)
+{
+#define BUF_SIZE 16384
     static char buf_meminfo[BUF_SIZE];
     static char buf_vmstat[BUF_SIZE];
-    char* pos;
-    int n;
+    static char buf_cg[EXT_NR_SRC - EXT_CG_STAT][BUF_SIZE];
+    const char* src[EXT_NR_SRC];
+    int fd_cg[EXT_NR_SRC] = { -1, -1, ctx->fd_cg_stat, ctx->fd_cg_events,
+	ctx->fd_cg_current, ctx->fd_cg_swap };
+    int n, i;
 
-    n = pread(ctx->fd_meminfo, buf_meminfo, BUF_SIZE, 0);
+    n = pread(ctx->fd_meminfo, buf_meminfo, BUF_SIZE - 1, 0);
     if (n == -1) return -1;
-    n = pread(ctx->fd_vmstat, buf_vmstat, BUF_SIZE, 0);
+    buf_meminfo[n] = '\0';
+    n = pread(ctx->fd_vmstat, buf_vmstat, BUF_SIZE - 1, 0);
     if (n == -1) return -1;
+    buf_vmstat[n] = '\0';
     
     // meminfo
-    pos = buf_meminfo;
-    info->total_kib = meminfo_get_line(pos); pos += linelen;
-    info->free_kib = meminfo_get_line(pos); pos += linelen;
-    info->buffer_kib = meminfo_get_line(pos); pos += linelen;
-    info->cache_kib = meminfo_get_line(pos); pos += 2*linelen;
-    info->active_kib = meminfo_get_line(pos); pos += linelen;
-    info->inactive_kib = meminfo_get_line(pos);
+    info->total_kib = proc_get_value(buf_meminfo, "MemTotal:");
+    info->free_kib = proc_get_value(buf_meminfo, "MemFree:");
+    info->buffer_kib = proc_get_value(buf_meminfo, "Buffers:");
+    info->cache_kib = proc_get_value(buf_meminfo, "Cached:");
+    info->active_kib = proc_get_value(buf_meminfo, "Active:");
+    info->inactive_kib = proc_get_value(buf_meminfo, "Inactive:");
 
     // vmstat
-    pos = strstr(buf_vmstat, "pgpgin");
-    info->pgpgin = atoll(pos + 7);
-    pos = strchr(pos + 7, '\n') + 1;
-    info->pgpgout = atoll(pos + 8);
-    pos = strchr(pos + 8, '\n') + 1;
-    info->pswpin = atoll(pos + 7);
-    pos = strchr(pos + 7, '\n') + 1;
-    info->pswpout = atoll(pos + 8);
-    pos = strstr(pos + 8, "pgmajfault");
-    info->pgmajfault = atoll(pos + 11);
+    info->pgpgin = proc_get_value(buf_vmstat, "pgpgin ");
+    info->pgpgout = proc_get_value(buf_vmstat, "pgpgout ");
+    info->pswpin = proc_get_value(buf_vmstat, "pswpin ");
+    info->pswpout = proc_get_value(buf_vmstat, "pswpout ");
+    info->pgmajfault = proc_get_value(buf_vmstat, "pgmajfault ");
+
+    src[EXT_MEMINFO] = buf_meminfo;
+    src[EXT_VMSTAT] = buf_vmstat;
+    for (i = EXT_CG_STAT; i < EXT_NR_SRC; i++) {
+	char* b = buf_cg[i - EXT_CG_STAT];
+	n = (fd_cg[i] == -1) ? -1 : pread(fd_cg[i], b, BUF_SIZE - 1, 0);
+	b[n < 0 ? 0 : n] = '\0';
+	src[i] = b;
+    }
+    for (i = 0; ext_desc[i].name; i++) {
+	info->ext[i] = proc_get_value(src[ext_desc[i].src], ext_desc[i].key) >> ext_desc[i].shift;
+    }
     
     info->recorded = 1;
     return 0;
@@ -1017,6 +1535,10 @@ int sys_stat_mem_update(sys_mem_ctx* ctx, sys_mem_item* info)
 
 int sys_stat_mem_exit(sys_mem_ctx* ctx)
 {
+    if (ctx->fd_cg_stat != -1) close(ctx->fd_cg_stat);
+    if (ctx->fd_cg_events != -1) close(ctx->fd_cg_events);
+    if (ctx->fd_cg_current != -1) close(ctx->fd_cg_current);
+    if (ctx->fd_cg_swap != -1) close(ctx->fd_cg_swap);
     close(ctx->fd_meminfo);
     close(ctx->fd_vmstat);
     return 0;
@@ -1503,11 +2025,12 @@ int alloc_affy_buffers(struct affy_node* head, size_t num_pfn)
 
     for (iter = head; iter != NULL; iter = iter->next) {
 	buf = mmap(NULL, num_pfn * PAGE_SIZE, permissions, 
-		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		MAP_PRIVATE | MAP_ANONYMOUS | hugepage_map_flags(params.hugepage), -1, 0);
 	if (buf == MAP_FAILED) {
 	    perror("buf mmap failed");
 	    return 1;
 	}
+	if (hugepage_advise(buf, num_pfn * PAGE_SIZE, params.hugepage)) return 1;
 	nodemask_zero(&mask);
 	copy_bitmask_to_nodemask(iter->nodemask, &mask);
 	ret = mbind(buf, num_pfn * PAGE_SIZE, MPOL_BIND, &mask.n[0], 
@@ -1539,6 +2062,84 @@ int free_affy_buffers(struct affy_node* head, size_t num_pfn)
     return 0;
 }
 
+#ifndef MPOL_LOCAL
+#define MPOL_LOCAL 4
+#endif
+
+/*
+ * set the memory policy of a map before it is touched.
+ * nodes is the node list of interleave (NULL = all), or the single node of preferred and remote.
+ */
+int sys_numa_set_policy(char* buf, size_t len, int policy, struct bitmask* nodes)
+{
+    unsigned long maxnode = numa_num_possible_nodes();
+    nodemask_t mask;
+    int mode;
+
+    nodemask_zero(&mask);
+    copy_bitmask_to_nodemask(nodes ? nodes : numa_all_nodes_ptr, &mask);
+
+    switch (policy) {
+    case MEMPOL_INTERLEAVE: mode = MPOL_INTERLEAVE; break;
+    case MEMPOL_PREFERRED: mode = MPOL_PREFERRED; break;
+    case MEMPOL_LOCAL: mode = MPOL_LOCAL; break;
+    case MEMPOL_REMOTE: mode = MPOL_BIND; break;
+    default: return 0;
+    }
+    if (mode == MPOL_LOCAL) {
+	if (mbind(buf, len, mode, NULL, 0, 0)) {
+	    perror("map mbind failed");
+	    return 1;
+	}
+    } else if (mbind(buf, len, mode, &mask.n[0], maxnode, 0)) {
+	perror("map mbind failed");
+	return 1;
+    }
+    return 0;
+}
+
+/* the node with memory at the largest distance from node 'from' */
+int sys_numa_farthest_node(int from)
+{
+    int node, far = from, dist = 0;
+
+    for (node = 0; node <= numa_max_node(); node++) {
+	if (!numa_bitmask_isbitset(numa_all_nodes_ptr, node)) continue;
+	if (numa_distance(from, node) > dist) {
+	    dist = numa_distance(from, node);
+	    far = node;
+	}
+    }
+    return far;
+}
+
+/* counts the pages of a map on each node */
+void sys_numa_placement(char* buf, size_t len, struct numa_placement* pl)
+{
+    const long pgsz = sysconf(_SC_PAGESIZE);
+    const size_t npages = len / pgsz;
+    void* pages[1024];
+    int status[1024];
+    size_t i, j, n;
+
+    memset(pl, 0, sizeof(*pl));
+    pl->nnodes = numa_max_node() + 1;
+    if (pl->nnodes > NUMA_MAX_NODES) pl->nnodes = NUMA_MAX_NODES;
+
+    for (i = 0; i < npages; i += n) {
+	n = (npages - i < 1024) ? npages - i : 1024;
+	for (j = 0; j < n; j++) pages[j] = buf + (i + j) * pgsz;
+	if (numa_move_pages(0, n, pages, NULL, status, 0)) {
+	    if (pl->failures++ == 0) perror("move_pages query failed");
+	    continue;
+	}
+	for (j = 0; j < n; j++) {
+	    if (status[j] >= 0 && status[j] < pl->nnodes) pl->pages[status[j]]++;
+	    else pl->absent++;
+	}
+    }
+}
+
 void sys_print_affinitysets(struct affy_node* head)
 {
     int thr_id = 1;
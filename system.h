@@ -242,6 +242,12 @@ extern int print_cache_info() __attribute__((cold));
 typedef struct sys_mem_ctx {
     int fd_meminfo;	// /proc/meminfo
     int fd_vmstat;	// /proc/vmstat
+#ifndef _WIN32
+    int fd_cg_stat;	// memory.stat of the cgroup sandbox. -1 without sandbox
+    int fd_cg_events;	// memory.events
+    int fd_cg_current;	// memory.current
+    int fd_cg_swap;	// memory.swap.current
+#endif
 } sys_mem_ctx;
 
 #ifdef _WIN32
@@ -252,7 +258,19 @@ typedef struct sys_mem_item {
 extern int sys_get_os_version_value(int i);
 extern char * sys_get_time_info_string(int i);
 #else
-/* currently 16 * 4 bytes = 64 bytes, meaning 64 entries per 4K page */
+/*
+ * Extended counters are optional meminfo/vmstat values grouped by feature.
+ * All of them are sampled at each snapshot, but only the enabled groups
+ * are reported.
+ */
+#define SYS_MEM_GRP_THP		(1 << 0)    // AnonHugePages, HugePages_*, thp_*
+#define SYS_MEM_GRP_SHMEM	(1 << 1)    // Shmem, ShmemHugePages, SwapCached, SwapFree
+#define SYS_MEM_GRP_CGROUP	(1 << 2)    // memory.current/stat/events of the cgroup sandbox
+#define SYS_MEM_GRP_DIRTY	(1 << 3)    // Dirty, Writeback, dirty thresholds, nr_dirtied/written
+#define SYS_MEM_GRP_COMPACT	(1 << 4)    // compact_*, thp_fault_fallback_charge
+
+#define SYS_MEM_EXT_MAX 48
+
 typedef struct sys_mem_item {
     int total_kib;	// meminfo->MemTotal
     int free_kib;	// meminfo->MemFree
@@ -265,8 +283,36 @@ typedef struct sys_mem_item {
     int64_t pswpin;	// vmstat->pswpin;
     int64_t pswpout;	// vmstat->pswpout;
     int64_t pgmajfault; // vmstat->pgmajfault;
+    int64_t ext[SYS_MEM_EXT_MAX];   // extended counters
     int recorded;
 } sys_mem_item;
+
+extern void sys_stat_mem_ext_enable(int groups);
+extern int sys_stat_mem_ext_count(void);
+extern int sys_stat_mem_ext_is_enabled(int i);
+extern const char* sys_stat_mem_ext_name(int i);
+extern void sys_stat_mem_ext_print(int nitems, const char* labels[], const sys_mem_item* items[]) __attribute__((cold));
+extern int64_t sys_smaps_get(const void* addr, const char* key);
+extern int64_t sys_vma_count(const void* lo, const void* hi);	// NULLs count all
+extern int64_t sys_status_get(const char* key);
+extern int64_t sys_tlb_shootdowns(void);	// -1 if unavailable
+extern int64_t sys_vmstat_get(const char* key);
+extern int64_t sys_free_blocks(int order);	// free blocks of 2^order pages. -1 on failure
+extern int sys_dirty_state(int64_t* dirty_kib, int64_t* writeback_kib,
+	int64_t* thresh_kib, int64_t* bg_thresh_kib);	// 0 on success. NULLs are skipped
+
+/*
+ * cgroup v2 sandbox. sys_cgroup_create() makes a child cgroup under @parent
+ * (NULL for the root of the cgroup2 hierarchy), writes the limits given in
+ * MiB (negative leaves a limit alone) and moves the process in. The process
+ * moves back and the child is removed at exit. Children left by runs that
+ * were killed are removed first, and memory.oom.group is set so an OOM kill
+ * ends the whole run.
+ */
+extern int sys_cgroup_create(const char* parent, int max_mib, int high_mib, int swap_max_mib);
+extern const char* sys_cgroup_path(void);	// NULL without sandbox
+extern int64_t sys_cgroup_get(const char* file, const char* key);	// -1 if unavailable or "max"
+extern void sys_cgroup_print(void) __attribute__((cold));
 extern char * sys_get_os_version_string(int i);
 extern int sys_get_time_info_value(int i);
 #endif
@@ -322,6 +368,10 @@ extern void sys_print_affinitysets(struct affy_node* head);
 extern int populate_new_affinity_set(struct affy_node** head, const char* arg);
 extern int alloc_affy_buffers(struct affy_node* head, size_t num_pfn);
 extern int free_affy_buffers(struct affy_node* head, size_t num_pfn);
+struct numa_placement;
+extern int sys_numa_set_policy(char* buf, size_t len, int policy, struct bitmask* nodes);
+extern int sys_numa_farthest_node(int from);
+extern void sys_numa_placement(char* buf, size_t len, struct numa_placement* pl);
 #endif
 
 #endif
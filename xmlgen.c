@@ -9,6 +9,7 @@
 
 #include "system.h"
 #include "pmbench.h"
+#include "pager.h"
 
 xmlDoc* xdoc = NULL;
 static const char xmloutput_version[] = "0.1";
@@ -75,12 +76,20 @@ xmlNodePtr makeParamsNode(const parameters *p, xmlNodePtr signaturenode)
     xmlNewChild(paramsnode, NULL, BAD_CAST "cold", unsignedIntToXmlChar(p->cold));
 #ifdef PMB_THREAD
     xmlNewChild(paramsnode, NULL, BAD_CAST "jobs", unsignedIntToXmlChar(p->jobs));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "procs", unsignedIntToXmlChar(p->procs));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "topology", BAD_CAST topology_name(p->topology));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "mix_pct", unsignedIntToXmlChar(p->mix_pct));
 #endif
     xmlNewChild(paramsnode, NULL, BAD_CAST "offset", signedIntToXmlChar(p->offset));
     xmlNewChild(paramsnode, NULL, BAD_CAST "ratio", signedIntToXmlChar(p->ratio));
     if (p->pattern && p->pattern->name) { xmlNewChild(paramsnode, NULL, BAD_CAST "pattern", BAD_CAST p->pattern->name); }
     if (p->access && p->access->name) { xmlNewChild(paramsnode, NULL, BAD_CAST "access", BAD_CAST p->access->name); }
     if (p->tsops && p->tsops->name) { xmlNewChild(paramsnode, NULL, BAD_CAST "tsops", BAD_CAST p->tsops->name); }
+    if (p->backing && p->backing->name) { xmlNewChild(paramsnode, NULL, BAD_CAST "backing", BAD_CAST p->backing->name); }
+    xmlNewChild(paramsnode, NULL, BAD_CAST "shared", unsignedIntToXmlChar(p->map_shared));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "hugepage", BAD_CAST hugepage_mode_name(p->hugepage));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "evict", BAD_CAST evict_mode_name(p->evict_mode));
+    xmlNewChild(paramsnode, NULL, BAD_CAST "unit_kib", unsignedIntToXmlChar(1 << (p->unit_shift - 10)));
 #ifdef XALLOC
     xmlNewChild(paramsnode, NULL, BAD_CAST "xalloc_mib", unsignedIntToXmlChar(p->xalloc_mib));
     xmlNewChild(paramsnode, NULL, BAD_CAST "xalloc_path", BAD_CAST p->xalloc_path);
@@ -207,6 +216,12 @@ xmlNodePtr makeSysMemItemNode(xmlNodePtr sysmemnode, char * name, const sys_mem_
     xmlNewChild(node, NULL, BAD_CAST "pswpin", signedIntToXmlChar(sys_stat_mem_get(info, 7)));
     xmlNewChild(node, NULL, BAD_CAST "pswpout", signedIntToXmlChar(sys_stat_mem_get(info, 8)));
     xmlNewChild(node, NULL, BAD_CAST "pgmajfault", signedIntToXmlChar(sys_stat_mem_get(info, 9)));
+    int i;
+    for (i = 0; i < sys_stat_mem_ext_count(); i++) {
+	if (!sys_stat_mem_ext_is_enabled(i)) continue;
+	xmlNodePtr extnode = xmlNewChild(node, NULL, BAD_CAST "ext_counter", signedIntToXmlChar(info->ext[i]));
+	xmlNewProp(extnode, BAD_CAST "name", BAD_CAST sys_stat_mem_ext_name(i));
+    }
 #endif
     return sysmemitemnode;
 }
@@ -232,6 +247,12 @@ xmlNodePtr makeMemItemDeltaNode(xmlNodePtr memitemnode, const sys_mem_item *befo
     xmlNewChild(deltanode, NULL, BAD_CAST "pswpin", signedIntToXmlChar(sys_stat_mem_get_delta(before, after, 7)));
     xmlNewChild(deltanode, NULL, BAD_CAST "pswpout", signedIntToXmlChar(sys_stat_mem_get_delta(before, after, 8)));
     xmlNewChild(deltanode, NULL, BAD_CAST "pgmajfault", signedIntToXmlChar(sys_stat_mem_get_delta(before, after, 9)));
+    int i;
+    for (i = 0; i < sys_stat_mem_ext_count(); i++) {
+	if (!sys_stat_mem_ext_is_enabled(i)) continue;
+	xmlNodePtr extnode = xmlNewChild(deltanode, NULL, BAD_CAST "ext_counter", signedIntToXmlChar(after->ext[i] - before->ext[i]));
+	xmlNewProp(extnode, BAD_CAST "name", BAD_CAST sys_stat_mem_ext_name(i));
+    }
 #endif
     return deltanode;
 }
@@ -307,6 +328,29 @@ void makeSysMemInfoNode(xmlNodePtr reportnode)
     postrunnode = makeSysMemItemNode(sysmeminfonode, "post-run", &mem_info_after_run);	//13
 }
 
+static
+xmlNodePtr makeBackingInfoNode(xmlNodePtr reportnode)
+{
+    const struct backing_info* bi = get_backing_info();
+    xmlNodePtr backingnode = xmlNewChild(reportnode, NULL, BAD_CAST "backing_info", NULL);
+    xmlNewProp(backingnode, BAD_CAST "name", BAD_CAST params.backing->name);
+    if (bi->path) {
+	xmlNewChild(backingnode, NULL, BAD_CAST "path", BAD_CAST bi->path);
+	xmlNewChild(backingnode, NULL, BAD_CAST "file_size", signedIntToXmlChar(bi->file_size));
+	xmlNewChild(backingnode, NULL, BAD_CAST "prepopulated", signedIntToXmlChar(bi->prepopulated));
+    }
+#ifndef _WIN32
+    if (params.backing == &persist_backing) {
+	xmlNewChild(backingnode, NULL, BAD_CAST "state", BAD_CAST bi->state);
+	xmlNewChild(backingnode, NULL, BAD_CAST "warm", signedIntToXmlChar(bi->warm));
+	xmlNewChild(backingnode, NULL, BAD_CAST "skip_warmup", signedIntToXmlChar(bi->skip_warmup));
+	xmlNewChild(backingnode, NULL, BAD_CAST "saved_time", signedIntToXmlChar(bi->saved_time));
+	xmlNewChild(backingnode, NULL, BAD_CAST "verify_clock", signedIntToXmlChar(bi->verify_clock));
+    }
+#endif
+    return backingnode;
+}
+
 static
 xmlNodePtr makeCacheInfoNode(xmlNodePtr machineinfonode, int cachetypes)
 {
@@ -409,6 +453,82 @@ print_xml_report(char* buf, const parameters* p, int is_interrupted)
 
     //result
     makeResultNode(reportnode);
+
+    //init
+    if (p->init_garbage) {
+	int i;
+	xmlNodePtr initnode = xmlNewChild(reportnode, NULL, BAD_CAST "init_info", NULL);
+	xmlNewChild(initnode, NULL, BAD_CAST "aggregate_mib_per_sec", floatToXmlChar(get_init_throughput(-1)));
+	for (i = 0; i < p->jobs; i++) {
+	    xmlNodePtr tn = xmlNewChild(initnode, NULL, BAD_CAST "init_thread", NULL);
+	    xmlNewProp(tn, BAD_CAST "thread_num", unsignedIntToXmlChar(i+1));
+	    xmlNewChild(tn, NULL, BAD_CAST "bytes", unsignedIntToXmlChar(get_result(i)->total_init_bytes));
+	    xmlNewChild(tn, NULL, BAD_CAST "clock", unsignedIntToXmlChar(get_result(i)->total_init_clock));
+	    xmlNewChild(tn, NULL, BAD_CAST "mib_per_sec", floatToXmlChar(get_init_throughput(i)));
+	}
+    }
+
+    //fault storm
+    if (p->fault_mode != FAULT_NONE) {
+	int i;
+	xmlNodePtr faultnode = xmlNewChild(reportnode, NULL, BAD_CAST "fault_info", NULL);
+	xmlNewProp(faultnode, BAD_CAST "mode", BAD_CAST fault_mode_name(p->fault_mode));
+	xmlNewChild(faultnode, NULL, BAD_CAST "range_kib", signedIntToXmlChar(p->fault_kib));
+	xmlNewChild(faultnode, NULL, BAD_CAST "aggregate_faults_per_sec", floatToXmlChar(get_fault_rate(-1)));
+	for (i = 0; i < p->jobs; i++) {
+	    xmlNodePtr tn = xmlNewChild(faultnode, NULL, BAD_CAST "fault_thread", NULL);
+	    xmlNewProp(tn, BAD_CAST "thread_num", unsignedIntToXmlChar(i+1));
+	    xmlNewChild(tn, NULL, BAD_CAST "pages", unsignedIntToXmlChar(get_result(i)->total_bench_count));
+	    xmlNewChild(tn, NULL, BAD_CAST "clock", unsignedIntToXmlChar(get_result(i)->total_bench_clock));
+	    xmlNewChild(tn, NULL, BAD_CAST "failures", signedIntToXmlChar(get_result(i)->fault_failures));
+	    xmlNewChild(tn, NULL, BAD_CAST "faults_per_sec", floatToXmlChar(get_fault_rate(i)));
+	}
+    }
+
+    //streaming
+    if (p->stream) {
+	int i;
+	xmlNodePtr streamnode = xmlNewChild(reportnode, NULL, BAD_CAST "stream_info", NULL);
+	xmlNewChild(streamnode, NULL, BAD_CAST "aggregate_mib_per_sec", floatToXmlChar(get_stream_throughput(-1)));
+	for (i = 0; i < p->jobs; i++) {
+	    const struct bench_result* r = get_result(i);
+	    xmlNodePtr tn = xmlNewChild(streamnode, NULL, BAD_CAST "stream_thread", NULL);
+	    xmlNewProp(tn, BAD_CAST "thread_num", unsignedIntToXmlChar(i+1));
+	    xmlNewChild(tn, NULL, BAD_CAST "passes", unsignedIntToXmlChar(r->total_stream_passes));
+	    xmlNewChild(tn, NULL, BAD_CAST "clock", unsignedIntToXmlChar(r->total_bench_clock));
+	    xmlNewChild(tn, NULL, BAD_CAST "resident_bytes", unsignedIntToXmlChar(r->total_stream_bytes[1]));
+	    xmlNewChild(tn, NULL, BAD_CAST "resident_ns", unsignedIntToXmlChar(r->total_stream_ns[1]));
+	    xmlNewChild(tn, NULL, BAD_CAST "nonresident_bytes", unsignedIntToXmlChar(r->total_stream_bytes[0]));
+	    xmlNewChild(tn, NULL, BAD_CAST "nonresident_ns", unsignedIntToXmlChar(r->total_stream_ns[0]));
+	    xmlNewChild(tn, NULL, BAD_CAST "mib_per_sec", floatToXmlChar(get_stream_throughput(i)));
+	}
+    }
+
+    //memory level parallelism
+    if (p->mlp) {
+	int i;
+	xmlNodePtr mlpnode = xmlNewChild(reportnode, NULL, BAD_CAST "mlp_info", NULL);
+	xmlNewProp(mlpnode, BAD_CAST "mode", BAD_CAST (p->mlp_update ? "update" : "load"));
+	xmlNewChild(mlpnode, NULL, BAD_CAST "batch", signedIntToXmlChar(p->mlp));
+	xmlNewChild(mlpnode, NULL, BAD_CAST "aggregate_per_sec", floatToXmlChar(get_mlp_rate(-1)));
+	for (i = 0; i < p->jobs; i++) {
+	    const struct bench_result* r = get_result(i);
+	    xmlNodePtr tn = xmlNewChild(mlpnode, NULL, BAD_CAST "mlp_thread", NULL);
+	    xmlNewProp(tn, BAD_CAST "thread_num", unsignedIntToXmlChar(i+1));
+	    xmlNewChild(tn, NULL, BAD_CAST "batches", unsignedIntToXmlChar(r->total_mlp_batches));
+	    xmlNewChild(tn, NULL, BAD_CAST "accesses", unsignedIntToXmlChar(r->total_bench_count));
+	    xmlNewChild(tn, NULL, BAD_CAST "batch_ns", unsignedIntToXmlChar(r->total_mlp_ns));
+	    xmlNewChild(tn, NULL, BAD_CAST "clock", unsignedIntToXmlChar(r->total_bench_clock));
+	    xmlNewChild(tn, NULL, BAD_CAST "per_sec", floatToXmlChar(get_mlp_rate(i)));
+	}
+	for (i = 0; i < mlp_result.levels; i++) {
+	    xmlNodePtr levelnode = xmlNewChild(mlpnode, NULL, BAD_CAST "sweep", NULL);
+	    xmlNewProp(levelnode, BAD_CAST "k", signedIntToXmlChar(mlp_result.k[i]));
+	    xmlNewChild(levelnode, NULL, BAD_CAST "per_sec", floatToXmlChar(mlp_result.rate[i]));
+	    xmlNewChild(levelnode, NULL, BAD_CAST "batch_ns", floatToXmlChar(mlp_result.batch_ns[i]));
+	}
+	xmlNewChild(mlpnode, NULL, BAD_CAST "saturation_k", signedIntToXmlChar(mlp_result.saturation_k));
+    }
     
     //statistics
     if (p->access == &histogram_access) {
@@ -419,6 +539,319 @@ print_xml_report(char* buf, const parameters* p, int is_interrupted)
 	if (p->ratio < 100) {
 	    makeHistogramNode(buf, 1, statisticsnode);
 	}
+	int c;
+	for (c = 1; c <= num_access_class; c++) {
+	    char* plane = access_class_plane(buf, c);
+	    xmlNodePtr classnode = xmlNewChild(reportnode, NULL, BAD_CAST "class_statistics", NULL);
+	    xmlNewProp(classnode, BAD_CAST "class", BAD_CAST access_class_name[c]);
+	    if (p->ratio > 0) makeHistogramNode(plane, 0, classnode);
+	    if (p->ratio < 100) makeHistogramNode(plane, 1, classnode);
+	}
+    }
+
+    //content
+    if (p->content) {
+	struct content_stat cs;
+	get_content_stat(&cs);
+	xmlNodePtr contentnode = xmlNewChild(reportnode, NULL, BAD_CAST "content_info", NULL);
+	xmlNewChild(contentnode, NULL, BAD_CAST "target_ratio", floatToXmlChar(p->content->ratio));
+	xmlNewChild(contentnode, NULL, BAD_CAST "target_dup_pct", floatToXmlChar(p->content->dup_pct));
+	xmlNewChild(contentnode, NULL, BAD_CAST "target_zero_pct", floatToXmlChar(p->content->zero_pct));
+	xmlNewChild(contentnode, NULL, BAD_CAST "sampled_pages", unsignedIntToXmlChar(cs.pages));
+	xmlNewChild(contentnode, NULL, BAD_CAST "dup_pages", unsignedIntToXmlChar(cs.dup_pages));
+	xmlNewChild(contentnode, NULL, BAD_CAST "zero_pages", unsignedIntToXmlChar(cs.zero_pages));
+	xmlNewChild(contentnode, NULL, BAD_CAST "deflate_ratio", floatToXmlChar(cs.ratio));
+    }
+
+    //backing
+    if (p->backing != &anon_backing) makeBackingInfoNode(reportnode);
+
+#ifndef _WIN32
+    //pager
+    if (p->backing == &uffd_backing) {
+	const struct pager_stat* ps = get_pager_stat();
+	xmlNodePtr pagernode = xmlNewChild(reportnode, NULL, BAD_CAST "pager_info", NULL);
+	xmlNewProp(pagernode, BAD_CAST "backend", BAD_CAST ps->backend);
+	xmlNewChild(pagernode, NULL, BAD_CAST "threads", signedIntToXmlChar(ps->threads));
+	xmlNewChild(pagernode, NULL, BAD_CAST "resident_limit", unsignedIntToXmlChar(ps->resident_limit));
+	xmlNewChild(pagernode, NULL, BAD_CAST "resident_peak", unsignedIntToXmlChar(ps->resident_peak));
+	xmlNewChild(pagernode, NULL, BAD_CAST "faults", unsignedIntToXmlChar(ps->faults));
+	xmlNewChild(pagernode, NULL, BAD_CAST "zero_fills", unsignedIntToXmlChar(ps->zero_fills));
+	xmlNewChild(pagernode, NULL, BAD_CAST "evictions", unsignedIntToXmlChar(ps->evictions));
+	xmlNewChild(pagernode, NULL, BAD_CAST "service_clock", unsignedIntToXmlChar(ps->service_clock));
+	xmlNewChild(pagernode, NULL, BAD_CAST "service_clock_max", unsignedIntToXmlChar(ps->service_clock_max));
+	xmlNewChild(pagernode, NULL, BAD_CAST "fetch_clock", unsignedIntToXmlChar(ps->fetch_clock));
+	xmlNewChild(pagernode, NULL, BAD_CAST "store_clock", unsignedIntToXmlChar(ps->store_clock));
+	xmlNewChild(pagernode, NULL, BAD_CAST "stored_pages", unsignedIntToXmlChar(ps->stored_pages));
+	xmlNewChild(pagernode, NULL, BAD_CAST "stored_bytes", unsignedIntToXmlChar(ps->stored_bytes));
+    }
+
+    //many-VMA map
+    if (p->regions) {
+	xmlNodePtr regionnode = xmlNewChild(reportnode, NULL, BAD_CAST "region_info", NULL);
+	xmlNewProp(regionnode, BAD_CAST "mode", BAD_CAST region_mode_name(p->region_mode));
+	const struct region_info* ri = get_region_info();
+	xmlNewChild(regionnode, NULL, BAD_CAST "requested", signedIntToXmlChar(p->regions));
+	xmlNewChild(regionnode, NULL, BAD_CAST "count", unsignedIntToXmlChar(ri->count));
+	xmlNewChild(regionnode, NULL, BAD_CAST "region_bytes", unsignedIntToXmlChar(ri->bytes));
+	xmlNewChild(regionnode, NULL, BAD_CAST "vmas_map", signedIntToXmlChar(ri->vmas));
+	xmlNewChild(regionnode, NULL, BAD_CAST "vmas_process", signedIntToXmlChar(sys_vma_count(NULL, NULL)));
+    }
+
+    //cgroup sandbox
+    if (sys_cgroup_path()) {
+	xmlNodePtr cgnode = xmlNewChild(reportnode, NULL, BAD_CAST "cgroup_info", NULL);
+	xmlNewProp(cgnode, BAD_CAST "path", BAD_CAST sys_cgroup_path());
+	xmlNewChild(cgnode, NULL, BAD_CAST "memory_max", signedIntToXmlChar(sys_cgroup_get("memory.max", NULL)));
+	xmlNewChild(cgnode, NULL, BAD_CAST "memory_high", signedIntToXmlChar(sys_cgroup_get("memory.high", NULL)));
+	xmlNewChild(cgnode, NULL, BAD_CAST "memory_swap_max", signedIntToXmlChar(sys_cgroup_get("memory.swap.max", NULL)));
+	xmlNewChild(cgnode, NULL, BAD_CAST "memory_peak", signedIntToXmlChar(sys_cgroup_get("memory.peak", NULL)));
+	xmlNewChild(cgnode, NULL, BAD_CAST "events_high", signedIntToXmlChar(sys_cgroup_get("memory.events", "high ")));
+	xmlNewChild(cgnode, NULL, BAD_CAST "events_max", signedIntToXmlChar(sys_cgroup_get("memory.events", "max ")));
+	xmlNewChild(cgnode, NULL, BAD_CAST "events_oom", signedIntToXmlChar(sys_cgroup_get("memory.events", "oom ")));
+	xmlNewChild(cgnode, NULL, BAD_CAST "events_oom_kill", signedIntToXmlChar(sys_cgroup_get("memory.events", "oom_kill ")));
+    }
+#endif
+
+    //resident floor
+    if (p->mlock_pct) {
+	uint64_t locked = 0;
+	int i, failures = 0;
+	for (i = 0; i < p->jobs; i++) {
+	    locked += get_result(i)->total_locked_bytes;
+	    failures += get_result(i)->lock_failures;
+	}
+	xmlNodePtr mlocknode = xmlNewChild(reportnode, NULL, BAD_CAST "mlock_info", NULL);
+	xmlNewProp(mlocknode, BAD_CAST "mode", BAD_CAST mlock_mode_name(p->mlock_mode));
+	xmlNewChild(mlocknode, NULL, BAD_CAST "percent", signedIntToXmlChar(p->mlock_pct));
+	xmlNewChild(mlocknode, NULL, BAD_CAST "locked_bytes", unsignedIntToXmlChar(locked));
+	xmlNewChild(mlocknode, NULL, BAD_CAST "failures", signedIntToXmlChar(failures));
+    }
+
+#ifndef _WIN32
+    //fragmentation preconditioning
+    if (p->frag_mib) {
+	const struct fragment_result* fr = &fragment_result;
+	xmlNodePtr fragnode = xmlNewChild(reportnode, NULL, BAD_CAST "fragment_info", NULL);
+	xmlNewChild(fragnode, NULL, BAD_CAST "region_mib", signedIntToXmlChar(p->frag_mib));
+	xmlNewChild(fragnode, NULL, BAD_CAST "pin_pct", signedIntToXmlChar(p->frag_pin_pct));
+	xmlNewChild(fragnode, NULL, BAD_CAST "unmovable_pct", signedIntToXmlChar(p->frag_unmov_pct));
+	xmlNewChild(fragnode, NULL, BAD_CAST "kept_kib", signedIntToXmlChar(fr->kept_kib));
+	xmlNewChild(fragnode, NULL, BAD_CAST "pinned_kib", signedIntToXmlChar(fr->pinned_kib));
+	xmlNewChild(fragnode, NULL, BAD_CAST "unmovable_kib", signedIntToXmlChar(fr->unmovable_kib));
+	xmlNewChild(fragnode, NULL, BAD_CAST "pipes", signedIntToXmlChar(fr->pipes));
+	xmlNewChild(fragnode, NULL, BAD_CAST "failures", signedIntToXmlChar(fr->failures));
+	xmlNewChild(fragnode, NULL, BAD_CAST "free_blocks_before", signedIntToXmlChar(fr->blocks_before));
+	xmlNewChild(fragnode, NULL, BAD_CAST "free_blocks_after", signedIntToXmlChar(fr->blocks_after));
+	xmlNewChild(fragnode, NULL, BAD_CAST "thp_fault_alloc", signedIntToXmlChar(fr->thp_fault_alloc));
+	xmlNewChild(fragnode, NULL, BAD_CAST "thp_fault_fallback", signedIntToXmlChar(fr->thp_fault_fallback));
+	xmlNewChild(fragnode, NULL, BAD_CAST "compact_stall", signedIntToXmlChar(fr->compact_stall));
+	xmlNewChild(fragnode, NULL, BAD_CAST "compact_fail", signedIntToXmlChar(fr->compact_fail));
+	xmlNewChild(fragnode, NULL, BAD_CAST "compact_success", signedIntToXmlChar(fr->compact_success));
+    }
+#endif
+
+#ifdef PMB_NUMA
+    //memory policy
+    if (p->mempolicy != MEMPOL_NONE) {
+	int node;
+	xmlNodePtr numanode = xmlNewChild(reportnode, NULL, BAD_CAST "numa_placement", NULL);
+	xmlNewProp(numanode, BAD_CAST "mempolicy", BAD_CAST mempolicy_name(p->mempolicy));
+	for (node = 0; node < numa_placement.nnodes; node++) {
+	    if (!numa_placement.pages[node]) continue;
+	    xmlNodePtr pagesnode = xmlNewChild(numanode, NULL, BAD_CAST "pages",
+		    signedIntToXmlChar(numa_placement.pages[node]));
+	    xmlNewProp(pagesnode, BAD_CAST "node", signedIntToXmlChar(node));
+	}
+	xmlNewChild(numanode, NULL, BAD_CAST "absent", signedIntToXmlChar(numa_placement.absent));
+    }
+
+    //node-to-node latency matrix
+    if (p->numa_matrix_mib) {
+	const struct numa_matrix_result* mr = &numa_matrix_result;
+	int row, col;
+	xmlNodePtr matrixnode = xmlNewChild(reportnode, NULL, BAD_CAST "numa_matrix", NULL);
+	xmlNewChild(matrixnode, NULL, BAD_CAST "buffer_mib", signedIntToXmlChar(p->numa_matrix_mib));
+	xmlNewChild(matrixnode, NULL, BAD_CAST "thp_pct", signedIntToXmlChar(mr->thp_pct));
+	xmlNewChild(matrixnode, NULL, BAD_CAST "llc_kib", signedIntToXmlChar(mr->llc_kib));
+	for (row = 0; row < mr->ncpu_nodes; row++) {
+	    for (col = 0; col < mr->nmem_nodes; col++) {
+		xmlNodePtr cellnode = xmlNewChild(matrixnode, NULL, BAD_CAST "cell", NULL);
+		xmlNewProp(cellnode, BAD_CAST "cpu_node", signedIntToXmlChar(mr->cpu_node[row]));
+		xmlNewProp(cellnode, BAD_CAST "mem_node", signedIntToXmlChar(mr->mem_node[col]));
+		xmlNewChild(cellnode, NULL, BAD_CAST "distance", signedIntToXmlChar(mr->distance[row][col]));
+		xmlNewChild(cellnode, NULL, BAD_CAST "mem_ns", floatToXmlChar(mr->mem_ns[row][col]));
+		xmlNewChild(cellnode, NULL, BAD_CAST "swapin_ns", floatToXmlChar(mr->swapin_ns[row][col]));
+		xmlNewChild(cellnode, NULL, BAD_CAST "swapped_pct", signedIntToXmlChar(mr->swapped_pct[row][col]));
+	    }
+	}
+    }
+#endif
+
+#if defined(PMB_THREAD) && !defined(_WIN32)
+    //pressure antagonist
+    if (p->antag_shape != ANTAG_NONE) {
+	int c;
+	xmlNodePtr antagnode = xmlNewChild(reportnode, NULL, BAD_CAST "antagonist_info", NULL);
+	xmlNewProp(antagnode, BAD_CAST "shape", BAD_CAST antagonist_shape_name(p->antag_shape));
+	xmlNewChild(antagnode, NULL, BAD_CAST "footprint_mib", signedIntToXmlChar(p->antag_mib));
+	xmlNewChild(antagnode, NULL, BAD_CAST "period_sec", signedIntToXmlChar(p->antag_period_sec));
+	xmlNewChild(antagnode, NULL, BAD_CAST "peak_kib", signedIntToXmlChar(recover_result.peak_kib));
+	xmlNewChild(antagnode, NULL, BAD_CAST "recover_pct", signedIntToXmlChar(p->recover_pct));
+	xmlNewChild(antagnode, NULL, BAD_CAST "baseline_p99_ns", floatToXmlChar(recover_result.baseline_p99_ns));
+	for (c = 0; c < recover_result.cycles; c++) {
+	    xmlNodePtr cyclenode = xmlNewChild(antagnode, NULL, BAD_CAST "cycle", NULL);
+	    xmlNewProp(cyclenode, BAD_CAST "index", signedIntToXmlChar(c + 1));
+	    xmlNewChild(cyclenode, NULL, BAD_CAST "peak_p99_ns", floatToXmlChar(recover_result.peak_p99_ns[c]));
+	    xmlNewChild(cyclenode, NULL, BAD_CAST "recover_ms", signedIntToXmlChar(recover_result.recover_ms[c]));
+	}
+    }
+
+    //dirty writeback
+    if (p->sync_ms) {
+	int i;
+	xmlNodePtr wbnode = xmlNewChild(reportnode, NULL, BAD_CAST "writeback_info", NULL);
+	xmlNewProp(wbnode, BAD_CAST "sync", BAD_CAST sync_mode_name(p->sync_mode));
+	xmlNewChild(wbnode, NULL, BAD_CAST "sync_ms", signedIntToXmlChar(p->sync_ms));
+	xmlNewChild(wbnode, NULL, BAD_CAST "syncs", unsignedIntToXmlChar(writeback_result.syncs));
+	xmlNewChild(wbnode, NULL, BAD_CAST "sync_clock", unsignedIntToXmlChar(writeback_result.sync_clock));
+	xmlNewChild(wbnode, NULL, BAD_CAST "sync_clock_max", unsignedIntToXmlChar(writeback_result.sync_clock_max));
+	xmlNewChild(wbnode, NULL, BAD_CAST "failures", signedIntToXmlChar(writeback_result.failures));
+	xmlNewChild(wbnode, NULL, BAD_CAST "thresh_kib", signedIntToXmlChar(writeback_result.thresh_kib));
+	xmlNewChild(wbnode, NULL, BAD_CAST "bg_thresh_kib", signedIntToXmlChar(writeback_result.bg_thresh_kib));
+	xmlNewChild(wbnode, NULL, BAD_CAST "throttle_samples", signedIntToXmlChar(writeback_result.throttle_samples));
+	for (i = 0; i < writeback_result.nsamples; i++) {
+	    const struct wb_sample* ws = &writeback_result.samples[i];
+	    xmlNodePtr samplenode = xmlNewChild(wbnode, NULL, BAD_CAST "dirty_sample", NULL);
+	    xmlNewProp(samplenode, BAD_CAST "ms", signedIntToXmlChar(ws->ms));
+	    xmlNewChild(samplenode, NULL, BAD_CAST "dirty_kib", signedIntToXmlChar(ws->dirty_kib));
+	    xmlNewChild(samplenode, NULL, BAD_CAST "writeback_kib", signedIntToXmlChar(ws->writeback_kib));
+	}
+    }
+
+    //copy-on-write snapshot
+    if (p->cow != COW_NONE) {
+	int c;
+	xmlNodePtr cownode = xmlNewChild(reportnode, NULL, BAD_CAST "cow_info", NULL);
+	xmlNewProp(cownode, BAD_CAST "side", BAD_CAST cow_side_name(p->cow));
+	xmlNewChild(cownode, NULL, BAD_CAST "forked", signedIntToXmlChar(cow_result.pid > 0));
+	xmlNewChild(cownode, NULL, BAD_CAST "fork_clock", unsignedIntToXmlChar(cow_result.fork_clock));
+	xmlNewChild(cownode, NULL, BAD_CAST "pte_kib", signedIntToXmlChar(cow_result.pte_kib));
+	xmlNewChild(cownode, NULL, BAD_CAST "rss_kib", signedIntToXmlChar(cow_result.rss_kib));
+	if (p->cow == COW_BOTH && cow_result.child.total_bench_count) {
+	    xmlNodePtr childnode = xmlNewChild(cownode, NULL, BAD_CAST "child", NULL);
+	    xmlNewChild(childnode, NULL, BAD_CAST "samples", unsignedIntToXmlChar(cow_result.child.total_bench_count));
+	    xmlNewChild(childnode, NULL, BAD_CAST "clock", unsignedIntToXmlChar(cow_result.child.total_bench_clock));
+	    if (p->access == &histogram_access) {
+		for (c = 0; c <= num_access_class; c++) {
+		    char* plane = access_class_plane(cow_result.child_stats, c);
+		    xmlNodePtr classnode = xmlNewChild(childnode, NULL, BAD_CAST "class_statistics", NULL);
+		    xmlNewProp(classnode, BAD_CAST "class", BAD_CAST access_class_name[c]);
+		    if (p->ratio > 0) makeHistogramNode(plane, 0, classnode);
+		    if (p->ratio < 100) makeHistogramNode(plane, 1, classnode);
+		}
+	    }
+	}
+    }
+
+    //buffer pool
+    if (p->bufpool) {
+	struct bufpool_stat bs;
+	get_bufpool_stat(&bs);
+	xmlNodePtr bpnode = xmlNewChild(reportnode, NULL, BAD_CAST "bufpool_info", NULL);
+	xmlNewProp(bpnode, BAD_CAST "policy", BAD_CAST bufpool_policy_name(p->bufpool->policy));
+	xmlNewProp(bpnode, BAD_CAST "io", BAD_CAST bufpool_io_name(bs.io));
+	xmlNewChild(bpnode, NULL, BAD_CAST "path", BAD_CAST p->bufpool->path);
+	xmlNewChild(bpnode, NULL, BAD_CAST "pool_mib", signedIntToXmlChar(p->bufpool->pool_mib));
+	xmlNewChild(bpnode, NULL, BAD_CAST "frames", unsignedIntToXmlChar(bs.frames));
+	xmlNewChild(bpnode, NULL, BAD_CAST "partitions", signedIntToXmlChar(bs.partitions));
+	xmlNewChild(bpnode, NULL, BAD_CAST "direct", signedIntToXmlChar(bs.direct));
+	xmlNewChild(bpnode, NULL, BAD_CAST "hits", unsignedIntToXmlChar(bs.hits));
+	xmlNewChild(bpnode, NULL, BAD_CAST "misses", unsignedIntToXmlChar(bs.misses));
+	xmlNewChild(bpnode, NULL, BAD_CAST "evictions", unsignedIntToXmlChar(bs.evictions));
+	xmlNewChild(bpnode, NULL, BAD_CAST "writebacks", unsignedIntToXmlChar(bs.writebacks));
+	xmlNewChild(bpnode, NULL, BAD_CAST "pin_waits", unsignedIntToXmlChar(bs.pin_waits));
+	xmlNewChild(bpnode, NULL, BAD_CAST "service_clock", unsignedIntToXmlChar(bs.service_clock));
+	xmlNewChild(bpnode, NULL, BAD_CAST "service_clock_max", unsignedIntToXmlChar(bs.service_clock_max));
+	xmlNewChild(bpnode, NULL, BAD_CAST "io_errors", unsignedIntToXmlChar(bs.io_errors));
+    }
+
+    //lookahead prefetch
+    if (p->prefetch_depth || p->prefetch_hint != PFHINT_NONE) {
+	uint64_t issued = 0, useless = 0, late = 0;
+	int i;
+	for (i = 0; i < p->jobs; i++) {
+	    issued += get_result(i)->total_prefetch_issued;
+	    useless += get_result(i)->total_prefetch_useless;
+	    late += get_result(i)->total_prefetch_late;
+	}
+	xmlNodePtr pfnode = xmlNewChild(reportnode, NULL, BAD_CAST "prefetch_info", NULL);
+	xmlNewProp(pfnode, BAD_CAST "hint", BAD_CAST prefetch_hint_name(p->prefetch_hint));
+	xmlNewChild(pfnode, NULL, BAD_CAST "depth", signedIntToXmlChar(p->prefetch_depth));
+	xmlNewChild(pfnode, NULL, BAD_CAST "phase_ms", signedIntToXmlChar(PREFETCH_PHASE_MS));
+	xmlNewChild(pfnode, NULL, BAD_CAST "issued", unsignedIntToXmlChar(issued));
+	xmlNewChild(pfnode, NULL, BAD_CAST "useless", unsignedIntToXmlChar(useless));
+	xmlNewChild(pfnode, NULL, BAD_CAST "late", unsignedIntToXmlChar(late));
+    }
+
+    //churn agent
+    if (p->churn_rate) {
+	int op, b;
+	xmlNodePtr churnnode = xmlNewChild(reportnode, NULL, BAD_CAST "churn_info", NULL);
+	xmlNewChild(churnnode, NULL, BAD_CAST "rate", signedIntToXmlChar(p->churn_rate));
+	xmlNewChild(churnnode, NULL, BAD_CAST "range_kib", signedIntToXmlChar(p->churn_kib));
+	xmlNewChild(churnnode, NULL, BAD_CAST "run_clock", unsignedIntToXmlChar(churn_result.run_clock));
+	xmlNewChild(churnnode, NULL, BAD_CAST "failures", signedIntToXmlChar(churn_result.failures));
+	xmlNewChild(churnnode, NULL, BAD_CAST "tlb_shootdowns", signedIntToXmlChar(churn_result.tlb_shootdowns));
+	for (op = 0; op < CHURN_NR_OPS; op++) {
+	    if (!(p->churn_ops & (1 << op))) continue;
+	    xmlNodePtr opnode = xmlNewChild(churnnode, NULL, BAD_CAST "churn_op", NULL);
+	    xmlNewProp(opnode, BAD_CAST "name", BAD_CAST churn_op_name(op));
+	    xmlNewChild(opnode, NULL, BAD_CAST "count", unsignedIntToXmlChar(churn_result.ops[op]));
+	    xmlNewChild(opnode, NULL, BAD_CAST "clock", unsignedIntToXmlChar(churn_result.clock[op]));
+	    xmlNewChild(opnode, NULL, BAD_CAST "clock_max", unsignedIntToXmlChar(churn_result.clock_max[op]));
+	    /* bin i counts calls below 2^i us */
+	    for (b = 0; b < CHURN_LAT_BINS; b++) {
+		if (!churn_result.lat_bins[op][b]) continue;
+		xmlNodePtr binnode = xmlNewChild(opnode, NULL, BAD_CAST "latency_bin",
+			unsignedIntToXmlChar(churn_result.lat_bins[op][b]));
+		xmlNewProp(binnode, BAD_CAST "below_us", unsignedIntToXmlChar(1ULL << b));
+	    }
+	}
+    }
+#endif
+
+    //eviction
+    if (p->evict_mode != EVICT_NONE) {
+	xmlNodePtr evictnode = xmlNewChild(reportnode, NULL, BAD_CAST "evict_info", NULL);
+	xmlNewProp(evictnode, BAD_CAST "mode", BAD_CAST evict_mode_name(p->evict_mode));
+	xmlNewChild(evictnode, NULL, BAD_CAST "percent", signedIntToXmlChar(p->evict_pct));
+	xmlNewChild(evictnode, NULL, BAD_CAST "interval_sec", signedIntToXmlChar(p->evict_interval_sec));
+	xmlNewChild(evictnode, NULL, BAD_CAST "rounds", signedIntToXmlChar(evict_result.rounds));
+	xmlNewChild(evictnode, NULL, BAD_CAST "failures", signedIntToXmlChar(evict_result.failures));
+	xmlNewChild(evictnode, NULL, BAD_CAST "advised_pages", unsignedIntToXmlChar(evict_result.advised_pages));
+	xmlNewChild(evictnode, NULL, BAD_CAST "ws_pages", signedIntToXmlChar(evict_result.ws_pages));
+	xmlNewChild(evictnode, NULL, BAD_CAST "resident_before", signedIntToXmlChar(evict_result.resident_before));
+	xmlNewChild(evictnode, NULL, BAD_CAST "resident_after", signedIntToXmlChar(evict_result.resident_after));
+    }
+
+    //shmem
+    if (map_is_shmem(p)) {
+	xmlNodePtr shmemnode = xmlNewChild(reportnode, NULL, BAD_CAST "shmem_info", NULL);
+	xmlNewProp(shmemnode, BAD_CAST "source", BAD_CAST p->backing->name);
+	xmlNewChild(shmemnode, NULL, BAD_CAST "map_rss_kib_pre_run", signedIntToXmlChar(map_sample_before_run.rss_kib));
+	xmlNewChild(shmemnode, NULL, BAD_CAST "map_rss_kib_post_run", signedIntToXmlChar(map_sample_after_run.rss_kib));
+	xmlNewChild(shmemnode, NULL, BAD_CAST "map_swapped_kib_pre_run", signedIntToXmlChar(map_sample_before_run.swap_kib));
+	xmlNewChild(shmemnode, NULL, BAD_CAST "map_swapped_kib_post_run", signedIntToXmlChar(map_sample_after_run.swap_kib));
+    }
+
+    //huge page
+    if (p->hugepage != HUGEPAGE_DEFAULT || p->unit_huge) {
+	xmlNodePtr hugenode = xmlNewChild(reportnode, NULL, BAD_CAST "hugepage_info", NULL);
+	xmlNewProp(hugenode, BAD_CAST "mode", BAD_CAST hugepage_mode_name(p->hugepage));
+	xmlNewChild(hugenode, NULL, BAD_CAST "hugepage_kib", signedIntToXmlChar(1 << (hugepage_shift(p->hugepage) - 10)));
+	xmlNewChild(hugenode, NULL, BAD_CAST "map_huge_kib_pre_run", signedIntToXmlChar(map_sample_before_run.huge_kib));
+	xmlNewChild(hugenode, NULL, BAD_CAST "map_huge_kib_post_run", signedIntToXmlChar(map_sample_after_run.huge_kib));
     }
 
     //sys_mem_info